@@ -0,0 +1,853 @@
+/**
+ * This file implements a benchmark measuring how quickly real router nodes converge.
+ *
+ * Every router of a topology directory, holding a neighbor file named after each router's
+ * label as written by topogen, is started as a node process on loopback. The routers
+ * start on their own as their neighbors come up, and from the launch of the first one the
+ * forwarding tables they print are compared to the shortest paths of the topology. The
+ * network has converged when every router has printed the expected table. The cost of a
+ * random link is then changed through the command input of the two routers it connects,
+ * and convergence is measured again. The wall-clock time, the number of datagrams sent
+ * and the rate they were sent at in both phases are written to standard output as JSON.
+ *
+ * Routers are started with the socket backend given by -io, the number of receive shards
+ * given by -shards, the transport given by -transport, the flooding given by -flood and
+ * the pacing given by -pace and the batching window given by -batch, so they can be
+ * compared.
+ *
+ * Routers listen on the ports their neighbors send to. When the neighbor files send
+ * through netem instead, the ports are taken from the files netem rewrote them from.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "lsDijkstra.h"
+#include "lsGraph.h"
+#include "lsNetwork.h"
+#include "lsPacket.h"
+
+// Default seconds a phase may take before the network is reported as not converged
+#define BENCH_TIMEOUT 60
+// Default milliseconds without a new forwarding table before a phase is over
+#define BENCH_SETTLE 1000
+// Microseconds waited for the routers' statistics
+#define BENCH_STATS_TIMEOUT 2000000
+
+struct BenchRouter
+{
+	uint16_t label;
+	char name[NAME_MAX + 1];
+	int port;
+	struct NeighborList *neighbors;
+	pid_t pid;
+	// Pipes to the standard input and from the standard output of the node
+	int in;
+	int out;
+	// Time the router reported every neighbor up, 0 if it has not
+	long long startedTime;
+	char line[256];
+	int lineLength;
+	// Table being read and the last complete one, the cost to each router by index
+	int *reading;
+	int *table;
+	int inTable;
+	// Time the last complete table was printed, 0 if none
+	long long tableTime;
+	// Expected cost to each router by index
+	int *expected;
+	long long sent;
+	long long hellos;
+	int hasStats;
+};
+
+struct BenchResult
+{
+	int converged;
+	long long convergence;
+	long long sent;
+	long long hellos;
+};
+
+/**
+ * Reads the neighbor file of every router in a directory.
+ *
+ * @param directory - directory holding the neighbor files
+ *
+ * @return - 0 if success, -1 if error
+ */
+int loadTopology(const char *directory);
+/**
+ * Takes the port each router listens on from the neighbor files of another directory.
+ *
+ * @param directory - directory holding the neighbor files the ports are read from
+ *
+ * @return - 0 if success, -1 if error
+ */
+int loadPorts(const char *directory);
+/**
+ * Calculates the cost each router should have to every other router.
+ *
+ * @return - 0 if success, -1 if error
+ */
+int computeExpected();
+/**
+ * Starts a node process for every router.
+ *
+ * @param directory - directory holding the neighbor files
+ * @param nodePath  - path of the node executable
+ *
+ * @return - 0 if success, -1 if error
+ */
+int startRouters(const char *directory, const char *nodePath);
+/**
+ * Stops every node process that was started.
+ */
+void stopRouters();
+/**
+ * Writes a line to the standard input of every node, or of a single one.
+ *
+ * @param router - router written to, NULL for every router
+ * @param line   - line being written, including the newline
+ */
+void writeRouters(struct BenchRouter *router, const char *line);
+/**
+ * Reads whatever the nodes printed, for up to a timeout.
+ *
+ * @param timeout - milliseconds to wait for output
+ *
+ * @return - 0 if success, -1 if a node exited
+ */
+int readRouters(int timeout);
+/**
+ * Handles a line printed by a node.
+ *
+ * @param router - router that printed the line
+ * @param line   - the line, without the newline
+ */
+void processLine(struct BenchRouter *router, char *line);
+/**
+ * Waits until every router has printed its expected table since the start of a phase
+ * and no router has printed another table for the settle time.
+ *
+ * @param start  - time in microseconds the phase started
+ * @param result - where the convergence time is stored
+ */
+void waitForConvergence(long long start, struct BenchResult *result);
+/**
+ * Asks every node for its statistics and adds them up.
+ *
+ * @param sent   - where the number of datagrams sent will be stored
+ * @param hellos - where the number of hellos sent will be stored
+ *
+ * @return - 0 if every node answered, -1 if not
+ */
+int collectStats(long long *sent, long long *hellos);
+/**
+ * Prints a phase's results as the members of a JSON object. The datagrams of a converged
+ * phase are also given per second, the rate the routers flooded at, which is how runs
+ * with different numbers of receive shards are compared.
+ *
+ * @param result - results of the phase
+ */
+void printResult(struct BenchResult *result);
+/**
+ * Prints a string as a JSON string.
+ *
+ * @param string - string being printed
+ */
+void printJSONString(const char *string);
+/**
+ * Parses the command line arguments and stores the results in the parameters.
+ *
+ * @param argc      - number of arguments
+ * @param argv      - argument vector
+ * @param directory - directory holding the neighbor files
+ * @param nodePath  - path of the node executable
+ * @param seed      - seed of the random number generator
+ * @param ports     - directory the listening ports are read from, NULL for the topology's
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, char **directory, char **nodePath, unsigned int *seed, char **ports);
+
+// Routers of the topology
+struct BenchRouter *routers;
+int routerCount;
+// Number of links between two routers
+int linkCount;
+// Index of the router with each label, -1 if there is none
+int routerIndex[LS_MAX_ROUTER_ID + 1];
+// Graph of the topology the expected tables are calculated from
+struct Graph *topology;
+// Longest time a phase may take and the quiet time that ends it, in microseconds
+long long timeout;
+long long settle;
+// Socket backend the nodes are started with, NULL for their default
+char *ioBackend;
+// Receive shards the nodes are started with, NULL for their default
+char *shardCount;
+// Transport between the nodes, NULL for their default
+char *transport;
+// Flooding of the nodes on a segment, NULL for their default
+char *flooding;
+// Datagrams per second the nodes send each neighbor, NULL for their default
+char *pace;
+// Longest microseconds the nodes hold a flooded packet, NULL for their default
+char *batch;
+
+int main(int argc, char **argv)
+{
+	int i, oldCost, newCost;
+	unsigned int seed;
+	char *directory, *nodePath, *ports, line[64];
+	char source[LS_ID_LENGTH], dest[LS_ID_LENGTH];
+	long long start, sent, hellos, started;
+	struct BenchRouter *router, *other;
+	struct Neighbor *neighbor;
+	struct BenchResult startup, change;
+
+	if (parseCommandLine(argc, argv, &directory, &nodePath, &seed, &ports) < 0)
+		exit(EXIT_FAILURE);
+
+	srand(seed);
+
+	if (loadTopology(directory) < 0 || (ports && loadPorts(ports) < 0) || computeExpected() < 0)
+		exit(EXIT_FAILURE);
+
+	// A node that exits closes its pipe, which must not kill the benchmark
+	signal(SIGPIPE, SIG_IGN);
+
+	// The routers start without being released, so startup is timed from the first launch
+	start = currentTime();
+	if (startRouters(directory, nodePath) < 0)
+	{
+		stopRouters();
+		exit(EXIT_FAILURE);
+	}
+
+	waitForConvergence(start, &startup);
+	if (collectStats(&startup.sent, &startup.hellos) < 0)
+		startup.sent = startup.hellos = -1;
+
+	// Time until the last router had every neighbor up, -1 if one never did
+	started = 0;
+	for (router = routers; router < routers + routerCount && started >= 0; router++)
+		started = router->startedTime ? (router->startedTime - start > started ? router->startedTime - start : started) : -1;
+
+	// Pick a random link and a new cost for it, changing it by -4 to +4 as the churn engine's walk pattern does
+	do
+	{
+		router = &routers[rand() % routerCount];
+	} while (!router->neighbors->size);
+
+	i = rand() % router->neighbors->size;
+	for (neighbor = router->neighbors->head; i > 0; neighbor = neighbor->next)
+		i--;
+
+	other = &routers[routerIndex[neighbor->label]];
+	oldCost = neighbor->cost;
+	newCost = oldCost + (rand() % 9) - 4;
+	newCost = newCost < 1 ? 1 : newCost;
+	if (newCost == oldCost)
+		newCost++;
+
+	snprintf(source, sizeof(source), "%u", router->label);
+	snprintf(dest, sizeof(dest), "%u", other->label);
+
+	// Each router of the link advertises its own direction
+	addEdge(topology, router->label, other->label, newCost, nextSequence(LS_INITIAL_SEQUENCE));
+	addEdge(topology, other->label, router->label, newCost, nextSequence(LS_INITIAL_SEQUENCE));
+	if (computeExpected() < 0)
+	{
+		stopRouters();
+		exit(EXIT_FAILURE);
+	}
+
+	// Both routers are configured with the new cost
+	change.converged = 0;
+	if (startup.converged)
+	{
+		collectStats(&sent, &hellos);
+		start = currentTime();
+
+		snprintf(line, sizeof(line), "cost %s %d\n", dest, newCost);
+		writeRouters(router, line);
+		snprintf(line, sizeof(line), "cost %s %d\n", source, newCost);
+		writeRouters(other, line);
+
+		waitForConvergence(start, &change);
+		if (collectStats(&change.sent, &change.hellos) < 0)
+			change.sent = change.hellos = -1;
+		else
+		{
+			change.sent -= sent;
+			change.hellos -= hellos;
+		}
+	}
+
+	stopRouters();
+
+	printf("{\n  \"topology\": ");
+	printJSONString(directory);
+	printf(",\n  \"routers\": %d,\n  \"links\": %d,\n  \"shards\": %d,\n  \"startup\": {", routerCount, linkCount,
+	       shardCount ? atoi(shardCount) : 1);
+	printResult(&startup);
+	if (started >= 0)
+		printf(", \"adjacencies_ms\": %.3f", started / 1000.0);
+	printf("},\n  \"change\": {\"source\": ");
+	printJSONString(source);
+	printf(", \"destination\": ");
+	printJSONString(dest);
+	printf(", \"old_cost\": %d, \"new_cost\": %d", oldCost, newCost);
+	if (startup.converged)
+	{
+		printf(", ");
+		printResult(&change);
+	}
+	printf("}\n}\n");
+
+	exit(startup.converged && change.converged ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+int loadTopology(const char *directory)
+{
+	int i, size;
+	uint16_t label;
+	char name[NAME_MAX + 1], path[PATH_MAX];
+	DIR *dir;
+	struct dirent *entry;
+	struct Neighbor *neighbor;
+	struct BenchRouter *router;
+
+	if (!(dir = opendir(directory)))
+	{
+		perror("Error");
+		return -1;
+	}
+
+	for (i = 0; i <= LS_MAX_ROUTER_ID; i++)
+		routerIndex[i] = -1;
+
+	size = 0;
+	routers = NULL;
+	routerCount = 0;
+	while ((entry = readdir(dir)))
+	{
+		strcpy(name, entry->d_name);
+		i = strlen(name) - 4;
+		if (i < 1 || strcmp(name + i, ".txt"))
+			continue;
+
+		name[i] = '\0';
+		if (!(label = parseRouterID(name)))
+			continue;
+
+		if (routerIndex[label] >= 0)
+		{
+			fprintf(stderr, "%s.txt and %s.txt are files of the same router\n", routers[routerIndex[label]].name, name);
+			closedir(dir);
+			return -1;
+		}
+
+		if (routerCount == size)
+		{
+			size = size ? 2 * size : 64;
+			if (!(routers = (struct BenchRouter *) realloc(routers, size * sizeof(struct BenchRouter))))
+			{
+				printf("Malloc failed.\n");
+				closedir(dir);
+				return -1;
+			}
+		}
+
+		router = &routers[routerCount];
+		memset(router, 0, sizeof(struct BenchRouter));
+		router->label = label;
+		strcpy(router->name, name);
+		router->port = -1;
+		router->pid = -1;
+		router->in = router->out = -1;
+		routerIndex[label] = routerCount++;
+	}
+	closedir(dir);
+
+	if (!routerCount || !(topology = newGraph(routerCount, 0)))
+	{
+		fprintf(stderr, "No neighbor files in %s\n", directory);
+		return -1;
+	}
+
+	linkCount = 0;
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		router->reading = (int *) malloc(routerCount * sizeof(int));
+		router->table = (int *) malloc(routerCount * sizeof(int));
+		router->expected = (int *) malloc(routerCount * sizeof(int));
+
+		if (!router->reading || !router->table || !router->expected || !(router->neighbors = newNeighborList()))
+		{
+			printf("Malloc failed.\n");
+			return -1;
+		}
+
+		for (i = 0; i < routerCount; i++)
+			router->table[i] = INT_MAX;
+
+		snprintf(path, PATH_MAX, "%s/%s.txt", directory, router->name);
+		if (processTextFile(path, router->neighbors) < 0)
+			return -1;
+
+		for (neighbor = router->neighbors->head; neighbor; neighbor = neighbor->next)
+		{
+			if (routerIndex[neighbor->label] < 0)
+			{
+				fprintf(stderr, "%s lists a router without a neighbor file\n", path);
+				return -1;
+			}
+
+			// A router listens on the port its neighbors send to
+			routers[routerIndex[neighbor->label]].port = neighbor->port;
+
+			addEdge(topology, router->label, neighbor->label, neighbor->cost, LS_INITIAL_SEQUENCE);
+
+			// Each link is listed in the files of both of its routers
+			if (router->label < neighbor->label)
+				linkCount++;
+		}
+	}
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		if (router->port < 0)
+		{
+			fprintf(stderr, "No neighbor file gives the port of router %s\n", router->name);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int loadPorts(const char *directory)
+{
+	char path[PATH_MAX];
+	struct NeighborList *list;
+	struct Neighbor *neighbor, *next;
+	struct BenchRouter *router;
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		if (!(list = newNeighborList()))
+		{
+			printf("Malloc failed.\n");
+			return -1;
+		}
+
+		snprintf(path, PATH_MAX, "%s/%s.txt", directory, router->name);
+		if (processTextFile(path, list) < 0)
+		{
+			free(list);
+			return -1;
+		}
+
+		for (neighbor = list->head; neighbor; neighbor = next)
+		{
+			next = neighbor->next;
+			if (routerIndex[neighbor->label] >= 0)
+				routers[routerIndex[neighbor->label]].port = neighbor->port;
+			free(neighbor);
+		}
+
+		free(list);
+	}
+
+	return 0;
+}
+
+int computeExpected()
+{
+	int i;
+	int cost[routerCount];
+	int hop[routerCount];
+	struct BenchRouter *router;
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		if (shortestPaths(topology, router->label, cost, hop) < 0)
+		{
+			printf("Malloc failed.\n");
+			return -1;
+		}
+
+		for (i = 0; i < routerCount; i++)
+			router->expected[i] = INT_MAX;
+
+		for (i = 0; i < routerCount; i++)
+			if (topology->key[i] && cost[i] != INT_MAX)
+				router->expected[routerIndex[topology->key[i]]] = cost[i];
+	}
+
+	return 0;
+}
+
+int startRouters(const char *directory, const char *nodePath)
+{
+	int in[2], out[2], argc;
+	char port[16], count[16], path[PATH_MAX];
+	char *args[20];
+	struct BenchRouter *router;
+
+	snprintf(count, sizeof(count), "%d", routerCount);
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		if (pipe(in) < 0 || pipe(out) < 0)
+		{
+			perror("Pipe failed");
+			return -1;
+		}
+
+		snprintf(port, sizeof(port), "%d", router->port);
+		snprintf(path, PATH_MAX, "%s/%s.txt", directory, router->name);
+
+		if ((router->pid = fork()) < 0)
+		{
+			perror("Fork failed");
+			return -1;
+		}
+
+		if (!router->pid)
+		{
+			dup2(in[0], STDIN_FILENO);
+			dup2(out[1], STDOUT_FILENO);
+			close(in[0]);
+			close(in[1]);
+			close(out[0]);
+			close(out[1]);
+
+			argc = 0;
+			args[argc++] = (char *) nodePath;
+			args[argc++] = router->name;
+			args[argc++] = port;
+			args[argc++] = count;
+			args[argc++] = path;
+			if (ioBackend)
+			{
+				args[argc++] = "-io";
+				args[argc++] = ioBackend;
+			}
+			if (shardCount)
+			{
+				args[argc++] = "-shards";
+				args[argc++] = shardCount;
+			}
+			if (transport)
+			{
+				args[argc++] = "-transport";
+				args[argc++] = transport;
+			}
+			if (flooding)
+			{
+				args[argc++] = "-flood";
+				args[argc++] = flooding;
+			}
+			if (pace)
+			{
+				args[argc++] = "-pace";
+				args[argc++] = pace;
+			}
+			if (batch)
+			{
+				args[argc++] = "-batch";
+				args[argc++] = batch;
+			}
+			args[argc] = NULL;
+
+			execv(nodePath, args);
+			perror("Exec failed");
+			_exit(EXIT_FAILURE);
+		}
+
+		close(in[0]);
+		close(out[1]);
+		router->in = in[1];
+		router->out = out[0];
+		fcntl(router->out, F_SETFL, O_NONBLOCK);
+		// The pipes of the routers started later must not be inherited by this one
+		fcntl(router->in, F_SETFD, FD_CLOEXEC);
+		fcntl(router->out, F_SETFD, FD_CLOEXEC);
+	}
+
+	return 0;
+}
+
+void stopRouters()
+{
+	struct BenchRouter *router;
+
+	for (router = routers; router < routers + routerCount; router++)
+		if (router->pid > 0)
+			kill(router->pid, SIGTERM);
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		if (router->pid > 0)
+			waitpid(router->pid, NULL, 0);
+		router->pid = -1;
+	}
+}
+
+void writeRouters(struct BenchRouter *router, const char *line)
+{
+	struct BenchRouter *node;
+
+	for (node = router ? router : routers; node < (router ? router + 1 : routers + routerCount); node++)
+		if (write(node->in, line, strlen(line)) < 0)
+			perror("Write failed");
+}
+
+int readRouters(int timeout)
+{
+	int i, length;
+	char buffer[4096], *c;
+	struct pollfd fds[routerCount];
+	struct BenchRouter *router;
+
+	for (i = 0; i < routerCount; i++)
+	{
+		fds[i].fd = routers[i].out;
+		fds[i].events = POLLIN;
+	}
+
+	if (poll(fds, routerCount, timeout) <= 0)
+		return 0;
+
+	for (i = 0; i < routerCount; i++)
+	{
+		if (!fds[i].revents)
+			continue;
+
+		router = &routers[i];
+
+		while ((length = read(router->out, buffer, sizeof(buffer))) > 0)
+		{
+			for (c = buffer; c < buffer + length; c++)
+			{
+				if (*c == '\n')
+				{
+					router->line[router->lineLength] = '\0';
+					processLine(router, router->line);
+					router->lineLength = 0;
+				}
+				else if (router->lineLength < (int) sizeof(router->line) - 1)
+					router->line[router->lineLength++] = *c;
+			}
+		}
+
+		if (!length)
+		{
+			fprintf(stderr, "Router %s exited\n", router->name);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void processLine(struct BenchRouter *router, char *line)
+{
+	int i, cost;
+	uint16_t label;
+	char dest[LS_ID_LENGTH + 1], forward[LS_ID_LENGTH + 1];
+
+	if (sscanf(line, "Datagrams sent: %lld, hellos sent: %lld", &router->sent, &router->hellos) == 2)
+	{
+		router->hasStats = 1;
+		return;
+	}
+
+	if (!strncmp(line, "Started with all", 16))
+	{
+		router->startedTime = currentTime();
+		return;
+	}
+
+	if (!strncmp(line, "Destination |", 13))
+	{
+		for (i = 0; i < routerCount; i++)
+			router->reading[i] = INT_MAX;
+		router->inTable = 1;
+		return;
+	}
+
+	if (!router->inTable)
+		return;
+
+	// A blank line ends the table
+	if (!line[0])
+	{
+		memcpy(router->table, router->reading, routerCount * sizeof(int));
+		router->tableTime = currentTime();
+		router->inTable = 0;
+		return;
+	}
+
+	if (sscanf(line, "%6s | %6s | %d", dest, forward, &cost) == 3 && (label = parseRouterID(dest)) && routerIndex[label] >= 0)
+		router->reading[routerIndex[label]] = cost;
+}
+
+void waitForConvergence(long long start, struct BenchResult *result)
+{
+	long long now, last;
+	struct BenchRouter *router;
+
+	result->converged = 0;
+	result->convergence = 0;
+
+	while ((now = currentTime()) - start < timeout)
+	{
+		if (readRouters(10) < 0)
+			return;
+
+		// Every router must have printed a table since the phase started, and the expected one
+		last = start;
+		for (router = routers; router < routers + routerCount; router++)
+		{
+			if (router->tableTime < start || memcmp(router->table, router->expected, routerCount * sizeof(int)))
+				break;
+			if (router->tableTime > last)
+				last = router->tableTime;
+		}
+
+		if (router < routers + routerCount)
+			continue;
+
+		// A later table would show that the network had not converged after all
+		if (now - last >= settle)
+		{
+			result->converged = 1;
+			result->convergence = last - start;
+			return;
+		}
+	}
+}
+
+int collectStats(long long *sent, long long *hellos)
+{
+	long long start;
+	struct BenchRouter *router;
+
+	for (router = routers; router < routers + routerCount; router++)
+		router->hasStats = 0;
+
+	writeRouters(NULL, "stats\n");
+
+	*sent = *hellos = 0;
+	start = currentTime();
+	for (router = routers; router < routers + routerCount; )
+	{
+		if (router->hasStats)
+		{
+			*sent += router->sent;
+			*hellos += router->hellos;
+			router++;
+		}
+		else if (currentTime() - start > BENCH_STATS_TIMEOUT || readRouters(10) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+void printResult(struct BenchResult *result)
+{
+	printf("\"converged\": %s", result->converged ? "true" : "false");
+	if (result->converged)
+		printf(", \"convergence_ms\": %.3f", result->convergence / 1000.0);
+	printf(", \"datagrams\": %lld, \"hellos\": %lld", result->sent, result->hellos);
+	if (result->converged && result->convergence > 0 && result->sent >= 0)
+		printf(", \"datagrams_per_s\": %.0f", result->sent * 1000000.0 / result->convergence);
+}
+
+void printJSONString(const char *string)
+{
+	putchar('"');
+	for (; *string; string++)
+	{
+		if (*string == '"' || *string == '\\')
+			printf("\\%c", *string);
+		else if ((unsigned char) *string < 0x20)
+			printf("\\u%04x", *string);
+		else
+			putchar(*string);
+	}
+	putchar('"');
+}
+
+int parseCommandLine(int argc, char **argv, char **directory, char **nodePath, unsigned int *seed, char **ports)
+{
+	int i;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Not enough arguments. Use format:\n"
+		                "topologyDirectory [-node path] [-seed n] [-timeout seconds] [-settle ms] [-ports directory] [-io backend] [-shards n] [-transport udp|shm] [-flood unicast|multicast] [-pace n] [-batch us]\n");
+		return -1;
+	}
+
+	*directory = argv[1];
+	*nodePath = "./node";
+	*seed = 1;
+	*ports = NULL;
+	timeout = BENCH_TIMEOUT * 1000000LL;
+	settle = BENCH_SETTLE * 1000LL;
+
+	for (i = 2; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "Missing value of %s\n", argv[i]);
+			return -1;
+		}
+
+		if (!strcmp(argv[i], "-node"))
+			*nodePath = argv[++i];
+		else if (!strcmp(argv[i], "-seed"))
+			*seed = strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-timeout"))
+			timeout = atoll(argv[++i]) * 1000000LL;
+		else if (!strcmp(argv[i], "-settle"))
+			settle = atoll(argv[++i]) * 1000LL;
+		else if (!strcmp(argv[i], "-ports"))
+			*ports = argv[++i];
+		else if (!strcmp(argv[i], "-io"))
+			ioBackend = argv[++i];
+		else if (!strcmp(argv[i], "-shards"))
+			shardCount = argv[++i];
+		else if (!strcmp(argv[i], "-transport"))
+			transport = argv[++i];
+		else if (!strcmp(argv[i], "-flood"))
+			flooding = argv[++i];
+		else if (!strcmp(argv[i], "-pace"))
+			pace = argv[++i];
+		else if (!strcmp(argv[i], "-batch"))
+			batch = argv[++i];
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
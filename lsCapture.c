@@ -0,0 +1,154 @@
+/**
+ * This file implements the capture log a router records the datagrams it receives in.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include "lsCapture.h"
+
+struct Capture *createCapture(const char *filename, uint16_t router, int graphSize)
+{
+	char header[CAPTURE_HEADER_SIZE];
+	uint32_t nmagic, nsize;
+	uint16_t nversion, nrouter;
+	struct Capture *capture = (struct Capture *) malloc(sizeof(struct Capture));
+
+	if (!capture)
+		return NULL;
+
+	if (!(capture->fp = fopen(filename, "wb")))
+	{
+		perror(filename);
+		free(capture);
+		return NULL;
+	}
+
+	capture->router = router;
+	capture->graphSize = graphSize;
+	capture->lastTime = -1;
+
+	nmagic = htonl(CAPTURE_MAGIC);
+	memcpy(header, &nmagic, 4);
+	nversion = htons(CAPTURE_VERSION);
+	memcpy(header+4, &nversion, 2);
+	nrouter = htons(router);
+	memcpy(header+6, &nrouter, 2);
+	nsize = htonl(graphSize);
+	memcpy(header+8, &nsize, 4);
+
+	if (fwrite(header, CAPTURE_HEADER_SIZE, 1, capture->fp) != 1)
+	{
+		perror(filename);
+		fclose(capture->fp);
+		free(capture);
+		return NULL;
+	}
+
+	return capture;
+}
+
+struct Capture *openCapture(const char *filename)
+{
+	char header[CAPTURE_HEADER_SIZE];
+	uint32_t nmagic, nsize;
+	uint16_t nversion, nrouter;
+	struct Capture *capture = (struct Capture *) malloc(sizeof(struct Capture));
+
+	if (!capture)
+		return NULL;
+
+	if (!(capture->fp = fopen(filename, "rb")))
+	{
+		perror(filename);
+		free(capture);
+		return NULL;
+	}
+
+	nmagic = 0;
+	nversion = 0;
+	if (fread(header, CAPTURE_HEADER_SIZE, 1, capture->fp) == 1)
+	{
+		memcpy(&nmagic, header, 4);
+		memcpy(&nversion, header+4, 2);
+	}
+
+	if (ntohl(nmagic) != CAPTURE_MAGIC || ntohs(nversion) != CAPTURE_VERSION)
+	{
+		fprintf(stderr, "%s is not a capture log\n", filename);
+		fclose(capture->fp);
+		free(capture);
+		return NULL;
+	}
+
+	memcpy(&nrouter, header+6, 2);
+	memcpy(&nsize, header+8, 4);
+	capture->router = ntohs(nrouter);
+	capture->graphSize = ntohl(nsize);
+	capture->lastTime = 0;
+
+	return capture;
+}
+
+int captureDatagram(struct Capture *capture, const char *datagram, int length, long long time)
+{
+	char record[CAPTURE_RECORD_SIZE];
+	uint32_t nelapsed;
+	uint16_t nlength;
+	long long elapsed;
+
+	// The first datagram is at time 0, and a gap too long to record is shortened
+	elapsed = capture->lastTime < 0 ? 0 : time - capture->lastTime;
+	if (elapsed > UINT32_MAX)
+		elapsed = UINT32_MAX;
+	capture->lastTime = time;
+
+	nelapsed = htonl(elapsed);
+	memcpy(record, &nelapsed, 4);
+	nlength = htons(length);
+	memcpy(record+4, &nlength, 2);
+
+	if (fwrite(record, CAPTURE_RECORD_SIZE, 1, capture->fp) != 1 || fwrite(datagram, length, 1, capture->fp) != 1)
+		return -1;
+
+	return 0;
+}
+
+int flushCapture(struct Capture *capture)
+{
+	return fflush(capture->fp) ? -1 : 0;
+}
+
+int readCaptured(struct Capture *capture, char *datagram, long long *time)
+{
+	int length;
+	char record[CAPTURE_RECORD_SIZE];
+	uint32_t nelapsed;
+	uint16_t nlength;
+
+	if (fread(record, CAPTURE_RECORD_SIZE, 1, capture->fp) != 1)
+		return 0;
+
+	memcpy(&nelapsed, record, 4);
+	memcpy(&nlength, record+4, 2);
+	length = ntohs(nlength);
+
+	if (length > LS_DATAGRAM_SIZE)
+		return -1;
+	// A record cut off by the router being killed ends the log
+	if (fread(datagram, length, 1, capture->fp) != 1)
+		return 0;
+
+	capture->lastTime += ntohl(nelapsed);
+	*time = capture->lastTime;
+
+	return length;
+}
+
+void closeCapture(struct Capture *capture)
+{
+	fclose(capture->fp);
+	free(capture);
+}
@@ -0,0 +1,107 @@
+/**
+ * This file describes the capture log a router records the datagrams it receives in,
+ * and reading the log back for replay.
+ *
+ * A log starts with a header naming the router and the size of its graph, followed by
+ * one record per datagram: the microseconds since the previous datagram, the length of
+ * the datagram and the datagram itself. Numbers are in network byte order, as in the
+ * datagrams.
+ *
+ * Header (12 bytes): Magic(4) | Version(2) | Router(2) | Graph size(4)
+ * Record (6 bytes + datagram): Microseconds since previous(4) | Length(2) | Datagram
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSCAPTURE_H
+#define _LSCAPTURE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lsPacket.h"
+
+// First bytes of a capture log
+#define CAPTURE_MAGIC 0x4C534350
+// Version of the log format
+#define CAPTURE_VERSION 1
+// Number of bytes in the header of a log
+#define CAPTURE_HEADER_SIZE 12
+// Number of bytes in the header of a record
+#define CAPTURE_RECORD_SIZE 6
+// Microseconds between flushes of a log being recorded
+#define LS_CAPTURE_FLUSH 100000
+
+struct Capture
+{
+	FILE *fp;
+	uint16_t router;
+	int graphSize;
+	// Time in microseconds of the previous datagram
+	long long lastTime;
+};
+
+/**
+ * Creates a capture log and writes its header.
+ *
+ * @param filename  - path of log
+ * @param router    - label of the recording router
+ * @param graphSize - number of routers the recording router's graph holds
+ *
+ * @return - pointer to capture, NULL if error
+ */
+struct Capture *createCapture(const char *filename, uint16_t router, int graphSize);
+
+/**
+ * Opens a capture log for reading and reads its header.
+ *
+ * @param filename - path of log
+ *
+ * @return - pointer to capture, NULL if error
+ */
+struct Capture *openCapture(const char *filename);
+
+/**
+ * Records a received datagram. The record is buffered until the log is flushed.
+ *
+ * @param capture  - capture log
+ * @param datagram - received datagram
+ * @param length   - length of datagram in bytes
+ * @param time     - time in microseconds the datagram was received
+ *
+ * @return - 0 if success, -1 if error
+ */
+int captureDatagram(struct Capture *capture, const char *datagram, int length, long long time);
+
+/**
+ * Writes the buffered records of a capture log to its file.
+ *
+ * @param capture - capture log
+ *
+ * @return - 0 if success, -1 if error
+ */
+int flushCapture(struct Capture *capture);
+
+/**
+ * Reads the next datagram from a capture log.
+ *
+ * @param capture  - capture log
+ * @param datagram - buffer of LS_DATAGRAM_SIZE bytes the datagram will be stored in
+ * @param time     - where the time in microseconds since the first datagram will be stored
+ *
+ * @return - length of datagram, 0 at the end of the log, -1 if the log is corrupt
+ */
+int readCaptured(struct Capture *capture, char *datagram, long long *time);
+
+/**
+ * Closes a capture log, writing its buffered records.
+ *
+ * @param capture - capture log
+ */
+void closeCapture(struct Capture *capture);
+
+#endif // _LSCAPTURE_H
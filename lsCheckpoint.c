@@ -0,0 +1,200 @@
+/**
+ * This file implements the checkpoint file a router saves its link-state database to.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lsCheckpoint.h"
+
+struct Checkpoint *openCheckpoint(const char *filename, uint16_t router)
+{
+	int i;
+	struct stat st;
+	struct CheckpointHeader *header;
+	struct Checkpoint *checkpoint = (struct Checkpoint *) malloc(sizeof(struct Checkpoint));
+
+	if (!checkpoint)
+		return NULL;
+
+	checkpoint->writing = -1;
+
+	if ((checkpoint->fd = open(filename, O_RDWR | O_CREAT, 0644)) < 0 || fstat(checkpoint->fd, &st) < 0)
+	{
+		perror(filename);
+		if (checkpoint->fd >= 0)
+			close(checkpoint->fd);
+		free(checkpoint);
+		return NULL;
+	}
+
+	// A file this router saved is kept as it is, so its last checkpoint can be restored
+	if (st.st_size >= sizeof(struct CheckpointHeader))
+	{
+		checkpoint->length = st.st_size;
+		checkpoint->map = mmap(NULL, checkpoint->length, PROT_READ | PROT_WRITE, MAP_SHARED, checkpoint->fd, 0);
+		header = (struct CheckpointHeader *) checkpoint->map;
+
+		if (checkpoint->map != MAP_FAILED && header->magic == CHECKPOINT_MAGIC &&
+		    header->version == CHECKPOINT_VERSION && header->router == router)
+		{
+			checkpoint->header = header;
+			return checkpoint;
+		}
+
+		fprintf(stderr, "%s is not a checkpoint of this router and version, starting it over\n", filename);
+		if (checkpoint->map != MAP_FAILED)
+			munmap(checkpoint->map, checkpoint->length);
+	}
+
+	checkpoint->length = sizeof(struct CheckpointHeader) + 2 * CHECKPOINT_CAPACITY * LS_PACKET_SIZE;
+
+	if (ftruncate(checkpoint->fd, 0) < 0 || ftruncate(checkpoint->fd, checkpoint->length) < 0 ||
+	    (checkpoint->map = mmap(NULL, checkpoint->length, PROT_READ | PROT_WRITE, MAP_SHARED, checkpoint->fd, 0)) == MAP_FAILED)
+	{
+		perror(filename);
+		close(checkpoint->fd);
+		free(checkpoint);
+		return NULL;
+	}
+
+	header = checkpoint->header = (struct CheckpointHeader *) checkpoint->map;
+	header->magic = CHECKPOINT_MAGIC;
+	header->version = CHECKPOINT_VERSION;
+	header->router = router;
+
+	for (i = 0; i < 2; i++)
+	{
+		header->slots[i].capacity = CHECKPOINT_CAPACITY;
+		header->slots[i].offset = sizeof(struct CheckpointHeader) + i * CHECKPOINT_CAPACITY * LS_PACKET_SIZE;
+	}
+
+	return checkpoint;
+}
+
+int loadCheckpoint(struct Checkpoint *checkpoint, const char **packets, int *elapsed)
+{
+	int i, latest;
+	struct CheckpointSlot *slot;
+	struct timespec ts;
+
+	latest = -1;
+
+	for (i = 0; i < 2; i++)
+	{
+		slot = &checkpoint->header->slots[i];
+
+		// A slot cut off by a crash while it was being written is passed over
+		if (!slot->generation || slot->count > slot->capacity ||
+		    slot->offset + (uint64_t) slot->count * LS_PACKET_SIZE > checkpoint->length ||
+		    slot->checksum != checksumPackets(checkpoint->map + slot->offset, slot->count))
+			continue;
+
+		if (latest < 0 || slot->generation > checkpoint->header->slots[latest].generation)
+			latest = i;
+	}
+
+	if (latest < 0)
+		return 0;
+
+	slot = &checkpoint->header->slots[latest];
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	*packets = checkpoint->map + slot->offset;
+	*elapsed = ((long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000 - slot->savedTime) / 1000000;
+	if (*elapsed < 0)
+		*elapsed = 0;
+
+	return slot->count;
+}
+
+char *beginCheckpoint(struct Checkpoint *checkpoint, int count)
+{
+	int i;
+	uint32_t capacity;
+	size_t length;
+	struct CheckpointSlot *slots = checkpoint->header->slots;
+
+	// The slot written is the one not holding the newest checkpoint
+	i = slots[0].generation > slots[1].generation ? 1 : 0;
+
+	// Marked incomplete before anything in it changes
+	__atomic_store_n(&slots[i].generation, 0, __ATOMIC_RELEASE);
+
+	if (count > slots[i].capacity)
+	{
+		capacity = 2 * slots[i].capacity > count ? 2 * slots[i].capacity : count;
+		length = checkpoint->length + (size_t) capacity * LS_PACKET_SIZE;
+
+		if (ftruncate(checkpoint->fd, length) < 0)
+			return NULL;
+
+		munmap(checkpoint->map, checkpoint->length);
+		checkpoint->map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, checkpoint->fd, 0);
+
+		if (checkpoint->map == MAP_FAILED)
+		{
+			// Mapped again at the old length, the slot keeps the space it had
+			checkpoint->map = mmap(NULL, checkpoint->length, PROT_READ | PROT_WRITE, MAP_SHARED, checkpoint->fd, 0);
+			checkpoint->header = (struct CheckpointHeader *) checkpoint->map;
+			return NULL;
+		}
+
+		checkpoint->header = (struct CheckpointHeader *) checkpoint->map;
+		slots = checkpoint->header->slots;
+		slots[i].offset = checkpoint->length;
+		slots[i].capacity = capacity;
+		checkpoint->length = length;
+	}
+
+	slots[i].count = count;
+	checkpoint->writing = i;
+
+	return checkpoint->map + slots[i].offset;
+}
+
+void commitCheckpoint(struct Checkpoint *checkpoint)
+{
+	struct CheckpointSlot *slots = checkpoint->header->slots;
+	struct CheckpointSlot *slot = &slots[checkpoint->writing];
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	slot->checksum = checksumPackets(checkpoint->map + slot->offset, slot->count);
+	slot->savedTime = (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	// The generation is stored last, so the slot is only restored once the rest is written
+	__atomic_store_n(&slot->generation, slots[1 - checkpoint->writing].generation + 1, __ATOMIC_RELEASE);
+
+	checkpoint->writing = -1;
+}
+
+uint32_t checksumPackets(const char *packets, int count)
+{
+	int i;
+	uint32_t hash = 2166136261u;
+
+	for (i = 0; i < count * LS_PACKET_SIZE; i++)
+	{
+		hash ^= (unsigned char) packets[i];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+void closeCheckpoint(struct Checkpoint *checkpoint)
+{
+	munmap(checkpoint->map, checkpoint->length);
+	close(checkpoint->fd);
+	free(checkpoint);
+}
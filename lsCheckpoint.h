@@ -0,0 +1,129 @@
+/**
+ * This file describes the checkpoint file a router saves its link-state database to, so
+ * that it can restore the database when it restarts instead of waiting for the network
+ * to flood it again.
+ *
+ * The file is mapped and holds two slots of link-state packets, written in turn. A slot is
+ * filled while the other keeps the last complete checkpoint, and only becomes the one
+ * restored once its checksum and generation are written after the packets. A router
+ * killed while saving leaves the previous checkpoint to restore. A slot too small for the
+ * database is moved to the end of the file, which grows to hold it.
+ *
+ * The header is in the host's byte order, the packets as they are sent.
+ *
+ * Header (80 bytes): Magic(4) | Version(4) | Router(2) | Unused(6) | Slot 0(32) | Slot 1(32)
+ * Slot: Generation(4) | Packets(4) | Capacity(4) | Checksum(4) | Saved time(8) | Offset(8)
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSCHECKPOINT_H
+#define _LSCHECKPOINT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lsPacket.h"
+
+// First bytes of a checkpoint file
+#define CHECKPOINT_MAGIC 0x4B43534C
+// Version of the file layout, a file of another version is not restored
+#define CHECKPOINT_VERSION 1
+// Packets a new slot holds
+#define CHECKPOINT_CAPACITY 1024
+// Microseconds between checkpoints
+#define LS_CHECKPOINT_INTERVAL 5000000
+
+struct CheckpointSlot
+{
+	// Number of the checkpoint in the slot, 0 while it is being written
+	uint32_t generation;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t checksum;
+	// Wall clock time in microseconds the checkpoint was saved
+	int64_t savedTime;
+	// Byte offset of the slot's packets in the file
+	uint64_t offset;
+};
+
+struct CheckpointHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint16_t router;
+	uint16_t unused[3];
+	struct CheckpointSlot slots[2];
+};
+
+struct Checkpoint
+{
+	int fd;
+	char *map;
+	size_t length;
+	struct CheckpointHeader *header;
+	// Slot being written, -1 if none
+	int writing;
+};
+
+/**
+ * Opens the checkpoint file of a router, creating it if it does not exist. A file of
+ * another version or router is started over.
+ *
+ * @param filename - path of file
+ * @param router   - label of local router
+ *
+ * @return - pointer to checkpoint, NULL if error
+ */
+struct Checkpoint *openCheckpoint(const char *filename, uint16_t router);
+
+/**
+ * Finds the last complete checkpoint in the file.
+ *
+ * @param checkpoint - open checkpoint
+ * @param packets    - where a pointer to the packets in the mapping will be stored
+ * @param elapsed    - where the seconds since the checkpoint was saved will be stored
+ *
+ * @return - number of packets, 0 if there is no complete checkpoint
+ */
+int loadCheckpoint(struct Checkpoint *checkpoint, const char **packets, int *elapsed);
+
+/**
+ * Starts a checkpoint in the slot not holding the last complete one, growing it if needed.
+ *
+ * @param checkpoint - open checkpoint
+ * @param count      - number of packets that will be saved
+ *
+ * @return - buffer in the mapping for count packets, NULL if error
+ */
+char *beginCheckpoint(struct Checkpoint *checkpoint, int count);
+
+/**
+ * Completes the checkpoint started last, making it the one restored.
+ *
+ * @param checkpoint - open checkpoint
+ */
+void commitCheckpoint(struct Checkpoint *checkpoint);
+
+/**
+ * Computes the checksum of the packets in a slot, the FNV-1a hash of their bytes.
+ *
+ * @param packets - packets in slot
+ * @param count   - number of packets
+ *
+ * @return - checksum
+ */
+uint32_t checksumPackets(const char *packets, int count);
+
+/**
+ * Unmaps and closes a checkpoint file.
+ *
+ * @param checkpoint - open checkpoint
+ */
+void closeCheckpoint(struct Checkpoint *checkpoint);
+
+#endif // _LSCHECKPOINT_H
@@ -0,0 +1,215 @@
+/**
+ * This file implements the churn engine a router uses to change its own links.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "lsChurn.h"
+
+struct Churn *newChurn(const char *spec)
+{
+	char *copy, *setting, *value, *save, *label, *labelSave;
+	int valid;
+	struct Churn *churn = (struct Churn *) calloc(1, sizeof(struct Churn));
+
+	if (!churn || !(copy = strdup(spec)))
+	{
+		printf("Malloc failed.\n");
+		free(churn);
+		return NULL;
+	}
+
+	churn->rate = CHURN_DYNAMIC_RATE;
+	churn->distribution = CHURN_UNIFORM;
+	churn->burst = CHURN_BURST;
+	churn->pattern = CHURN_WALK;
+	churn->fraction = 1;
+	seedChurn(churn, time(NULL) ^ getpid());
+
+	valid = 1;
+	for (setting = strtok_r(copy, ",", &save); setting && valid; setting = strtok_r(NULL, ",", &save))
+	{
+		if (!(value = strchr(setting, '=')))
+		{
+			fprintf(stderr, "Missing value of %s\n", setting);
+			valid = 0;
+			break;
+		}
+
+		*value++ = '\0';
+
+		if (!strcmp(setting, "rate"))
+			valid = (churn->rate = atof(value)) > 0;
+		else if (!strcmp(setting, "burst"))
+			valid = (churn->burst = atoi(value)) > 0;
+		else if (!strcmp(setting, "cost"))
+			valid = (churn->toggleCost = atoi(value)) > 0;
+		else if (!strcmp(setting, "fraction"))
+			valid = (churn->fraction = atof(value)) > 0 && churn->fraction <= 1;
+		else if (!strcmp(setting, "count"))
+			valid = (churn->limit = atoll(value)) >= 0;
+		else if (!strcmp(setting, "seed"))
+			seedChurn(churn, strtoull(value, NULL, 10));
+		else if (!strcmp(setting, "dist"))
+		{
+			if (!strcmp(value, "uniform"))
+				churn->distribution = CHURN_UNIFORM;
+			else if (!strcmp(value, "poisson"))
+				churn->distribution = CHURN_POISSON;
+			else if (!strcmp(value, "bursty"))
+				churn->distribution = CHURN_BURSTY;
+			else
+				valid = 0;
+		}
+		else if (!strcmp(setting, "pattern"))
+		{
+			if (!strcmp(value, "walk"))
+				churn->pattern = CHURN_WALK;
+			else if (!strcmp(value, "flap"))
+				churn->pattern = CHURN_FLAP;
+			else if (!strcmp(value, "toggle"))
+				churn->pattern = CHURN_TOGGLE;
+			else
+				valid = 0;
+		}
+		else if (!strcmp(setting, "links"))
+		{
+			free(churn->labels);
+			churn->labelCount = 0;
+			if (!(churn->labels = (uint16_t *) malloc(strlen(value) * sizeof(uint16_t))))
+			{
+				printf("Malloc failed.\n");
+				valid = 0;
+				break;
+			}
+
+			for (label = strtok_r(value, ":", &labelSave); label && valid; label = strtok_r(NULL, ":", &labelSave))
+				valid = (churn->labels[churn->labelCount++] = parseRouterID(label)) != LS_ROUTER_NONE;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown churn setting %s\n", setting);
+			valid = 0;
+			break;
+		}
+
+		if (!valid)
+			fprintf(stderr, "Invalid churn setting %s=%s\n", setting, value);
+	}
+
+	free(copy);
+
+	if (!valid)
+	{
+		free(churn->labels);
+		free(churn);
+		return NULL;
+	}
+
+	return churn;
+}
+
+void seedChurn(struct Churn *churn, uint64_t seed)
+{
+	// A zero state would only ever produce zero
+	churn->state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+double churnRandom(struct Churn *churn)
+{
+	churn->state ^= churn->state >> 12;
+	churn->state ^= churn->state << 25;
+	churn->state ^= churn->state >> 27;
+
+	// The top 53 bits fill the mantissa of a double
+	return ((churn->state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / (1ULL << 53));
+}
+
+int selectChurnLinks(struct Churn *churn, struct NeighborList *neighbors)
+{
+	int i, j, count;
+	char id[LS_ID_LENGTH];
+	struct ChurnLink swap;
+	struct Neighbor *neighbor;
+
+	if (!(churn->links = (struct ChurnLink *) malloc((neighbors->size ? neighbors->size : 1) * sizeof(struct ChurnLink))))
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	churn->linkCount = 0;
+	for (neighbor = neighbors->head; neighbor; neighbor = neighbor->next)
+	{
+		for (i = 0; i < churn->labelCount && churn->labels[i] != neighbor->label; i++)
+			;
+
+		if (churn->labels && i == churn->labelCount)
+			continue;
+
+		churn->links[churn->linkCount].peer = neighbor->label;
+		churn->links[churn->linkCount].cost = neighbor->cost;
+		churn->links[churn->linkCount++].withdrawn = 0;
+	}
+
+	for (i = 0; i < churn->labelCount; i++)
+		if (!findNeighbor(neighbors, churn->labels[i]))
+			fprintf(stderr, "Router %s is not a neighbor, its link is not churned\n", formatRouterID(churn->labels[i], id));
+
+	// A random fraction of the links is moved to the front, at least one link being churned
+	count = (int) (churn->fraction * churn->linkCount + 0.5);
+	if (count < 1)
+		count = 1;
+
+	for (i = 0; i < count && i < churn->linkCount; i++)
+	{
+		j = i + (int) (churnRandom(churn) * (churn->linkCount - i));
+		swap = churn->links[i];
+		churn->links[i] = churn->links[j];
+		churn->links[j] = swap;
+	}
+
+	if (count < churn->linkCount)
+		churn->linkCount = count;
+
+	return churn->linkCount;
+}
+
+long long nextChurnTime(struct Churn *churn, long long time)
+{
+	double mean = 1000000.0 / churn->rate;
+
+	switch (churn->distribution)
+	{
+		case CHURN_POISSON:
+			return time + (long long) (-log(1.0 - churnRandom(churn)) * mean);
+		case CHURN_BURSTY:
+			// The changes of a burst are made together, the bursts keep up the mean rate
+			if (--churn->burstLeft > 0)
+				return time;
+			churn->burstLeft = churn->burst;
+			return time + (long long) (-log(1.0 - churnRandom(churn)) * mean * churn->burst);
+		default:
+			return time + (long long) mean;
+	}
+}
+
+struct ChurnLink *pickChurnLink(struct Churn *churn)
+{
+	return &churn->links[(int) (churnRandom(churn) * churn->linkCount)];
+}
+
+void releaseChurnLink(struct Churn *churn, uint16_t peer)
+{
+	int i;
+
+	for (i = 0; i < churn->linkCount; i++)
+		if (churn->links[i].peer == peer)
+			churn->links[i].withdrawn = 0;
+}
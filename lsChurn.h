@@ -0,0 +1,162 @@
+/**
+ * This file describes the churn engine a router uses to change its own links as a load
+ * generator, and the settings it is configured with.
+ *
+ * Changes arrive at a configured rate, spread evenly, as a Poisson process, or in bursts
+ * of back to back changes with Poisson arrivals between the bursts. Each change picks one
+ * of the churned links at random and applies the pattern to it:
+ *
+ * walk   - the cost moves by -4 to +4, never below 1, as with -dynamic
+ * flap   - the link is withdrawn, and restored with its cost by the next change to it
+ * toggle - the cost alternates between its cost in the neighbor file and a second cost
+ *
+ * The random numbers come from a generator of the engine's own, so a seed replays the
+ * same changes whatever else the router draws random numbers for.
+ *
+ * Settings are a comma separated list of name=value pairs:
+ * rate=n     - changes per second
+ * dist=name  - uniform, poisson or bursty
+ * burst=n    - changes in a burst
+ * pattern=p  - walk, flap or toggle
+ * cost=n     - second cost of the toggle pattern, double the link's cost if not given
+ * links=A:B  - neighbors whose links are churned, every neighbor's if not given
+ * fraction=f - fraction of the links churned, picked at random
+ * count=n    - changes made before the engine stops, 0 for no limit
+ * seed=n     - seed of the random number generator
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSCHURN_H
+#define _LSCHURN_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lsNetwork.h"
+#include "lsPacket.h"
+
+// Distributions of the times between changes
+#define CHURN_UNIFORM 0
+#define CHURN_POISSON 1
+#define CHURN_BURSTY 2
+// Patterns of the changes made to a link
+#define CHURN_WALK 0
+#define CHURN_FLAP 1
+#define CHURN_TOGGLE 2
+// Changes per second of -dynamic, one every 5 seconds
+#define CHURN_DYNAMIC_RATE 0.2
+// Default changes in a burst
+#define CHURN_BURST 10
+// Most changes made in one tick, so received packets are still processed when the rate
+// cannot be kept up with
+#define CHURN_MAX_BATCH 256
+// Highest rate each change is printed at, faster churn is reported once per interval
+#define CHURN_PRINT_RATE 10
+// Microseconds between reports of fast churn
+#define CHURN_REPORT_INTERVAL 1000000
+
+struct ChurnLink
+{
+	uint16_t peer;
+	// Cost in the neighbor file, which the toggle pattern returns to
+	int cost;
+	// Set while the flap pattern holds the link withdrawn
+	int withdrawn;
+};
+
+struct Churn
+{
+	double rate;
+	int distribution;
+	int burst;
+	int pattern;
+	int toggleCost;
+	double fraction;
+	long long limit;
+	// Labels named by links=, NULL for every neighbor
+	uint16_t *labels;
+	int labelCount;
+	// Links picked from the neighbors
+	struct ChurnLink *links;
+	int linkCount;
+	uint64_t state;
+	// Time in microseconds of the next change, and the changes left in the current burst
+	long long next;
+	int burstLeft;
+	long long changes;
+	// Changes and time of the last report
+	long long reported;
+	long long reportTime;
+};
+
+/**
+ * Allocates a churn engine configured by a list of settings.
+ *
+ * @param spec - comma separated name=value settings, empty for the defaults of -dynamic
+ *
+ * @return - pointer to churn engine, NULL if error
+ */
+struct Churn *newChurn(const char *spec);
+
+/**
+ * Seeds the random number generator of the engine.
+ *
+ * @param churn - churn engine
+ * @param seed  - seed
+ */
+void seedChurn(struct Churn *churn, uint64_t seed);
+
+/**
+ * Draws a random number from the engine's generator, a xorshift64*.
+ *
+ * @param churn - churn engine
+ *
+ * @return - number from 0 up to but not including 1
+ */
+double churnRandom(struct Churn *churn);
+
+/**
+ * Picks the links churned from the neighbors of the router.
+ *
+ * @param churn     - churn engine
+ * @param neighbors - neighbors of local router
+ *
+ * @return - number of links picked, -1 if error
+ */
+int selectChurnLinks(struct Churn *churn, struct NeighborList *neighbors);
+
+/**
+ * Calculates the time of the change following one.
+ *
+ * @param churn - churn engine
+ * @param time  - time in microseconds of the last change
+ *
+ * @return - time in microseconds of the next change
+ */
+long long nextChurnTime(struct Churn *churn, long long time);
+
+/**
+ * Forgets that the flap pattern withdrew the link to a neighbor that went down, so the
+ * link is only restored once the neighbor is back up.
+ *
+ * @param churn - churn engine
+ * @param peer  - label of neighbor
+ */
+void releaseChurnLink(struct Churn *churn, uint16_t peer);
+
+/**
+ * Picks the link of the next change.
+ *
+ * @param churn - churn engine
+ *
+ * @return - pointer to link
+ */
+struct ChurnLink *pickChurnLink(struct Churn *churn);
+
+#endif // _LSCHURN_H
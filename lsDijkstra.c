@@ -11,6 +11,7 @@
 
 struct MinHeap *newMinHeap(int cap)
 {
+	int i;
 	struct MinHeap *heap = (struct MinHeap *) malloc(sizeof(struct MinHeap));
 
 	if (!heap)
@@ -29,6 +30,10 @@ struct MinHeap *newMinHeap(int cap)
 		return NULL;
 	}
 
+	// A position past the end of the heap marks a node that is not in it
+	for (i = 0; i < cap; i++)
+		heap->pos[i] = cap;
+
 	heap->size = 0;
 	heap->cap = cap;
 
@@ -178,24 +183,26 @@ int isEmpty(struct MinHeap *heap)
 	return heap->size == 0;
 }
 
-void dijkstra(struct Graph *graph, char source)
+int shortestPaths(struct Graph *graph, uint16_t source, int *cost, int *hop)
 {
 	int i, u, v;
 	struct HeapNode *heapNode;
 	struct AdjListNode *adjNode;
 
-	int srcI = getIndex(graph->key, graph->size, source);
-
-	int cost[graph->size];
-	char path[graph->size];
+	int srcI = getIndex(graph, source);
 
 	struct MinHeap *heap = newMinHeap(graph->size);
 
+	if (!heap)
+		return -1;
+
 	for (i = 0; i < graph->size; i++)
 	{
-		path[i] = '-';
+		hop[i] = -1;
 		cost[i] = (i == srcI) ? 0 : INT_MAX;
-		insert(heap, newHeapNode(i, cost[i]));
+		// Free indices left behind by removed routers are not part of the search
+		if (graph->key[i])
+			insert(heap, newHeapNode(i, cost[i]));
 	}
 
 	while (!isEmpty(heap))
@@ -203,18 +210,19 @@ void dijkstra(struct Graph *graph, char source)
 		heapNode = extract(heap);
 		u = heapNode->index;
 
-		if (path[u] == '-' && cost[u] > 0)
-			path[u] = graph->key[u];
+		if (hop[u] < 0 && cost[u] > 0 && cost[u] != INT_MAX)
+			hop[u] = u;
 
 		adjNode = graph->array[u].head;
 		while (adjNode)
 		{
 			v = adjNode->dest;
 
-			if (isInHeap(heap, v) && cost[u] != INT_MAX && adjNode->cost + cost[u] < cost[v])
+			if (isInHeap(heap, v) && cost[u] != INT_MAX && adjNode->cost != LS_WITHDRAW_COST &&
+			    adjNode->cost + cost[u] < cost[v])
 			{
 				cost[v] = cost[u] + adjNode->cost;
-				path[v] = path[u];
+				hop[v] = hop[u];
 
 				updateHeap(heap, v, cost[v]);
 			}
@@ -226,10 +234,33 @@ void dijkstra(struct Graph *graph, char source)
 	destroyHeap(heap);
 	graph->updated = 0;
 
+	return 0;
+}
+
+void dijkstra(struct Graph *graph, uint16_t source)
+{
+	int i;
+	int cost[graph->size];
+	int hop[graph->size];
+	char dest[LS_ID_LENGTH], forward[LS_ID_LENGTH];
+
+	if (shortestPaths(graph, source, cost, hop) < 0)
+		return;
+
 	printf("Destination | Forward to | Cost\n");
 	for (i = 0; i < graph->size; i++)
-		if (cost[i] != INT_MAX)
-			printf("%c           | %c          | %d\n", graph->key[i], path[i], cost[i]);
+	{
+		if (cost[i] == INT_MAX)
+			continue;
+
+		formatRouterID(graph->key[i], dest);
+		if (hop[i] < 0)
+			strcpy(forward, "-");
+		else
+			formatRouterID(graph->key[hop[i]], forward);
+
+		printf("%-11s | %-10s | %d\n", dest, forward, cost[i]);
+	}
 
 	printf("\n");
 }
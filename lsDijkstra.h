@@ -26,13 +26,13 @@ struct MinHeap
 	int cap;
 	int *pos;
 	struct HeapNode **array;
-} MinHeap;
+};
 
 struct HeapNode
 {
 	int index;
 	int cost;
-} HeapNode;
+};
 
 /**
  * Initialize a new MinHeap structure.
@@ -130,11 +130,25 @@ int isInHeap(struct MinHeap *heap, int index);
 int isEmpty(struct MinHeap *heap);
 
 /**
- * Computes the shortest path across a graph.
+ * Computes the shortest path from a router to every other router in a graph.
+ *
+ * @param graph  - graph being analyzed
+ * @param source - label of starting node
+ * @param cost   - array of graph->size costs where the cost of each path is stored,
+ *                 INT_MAX if the node is unreachable
+ * @param hop    - array of graph->size indices where the first node on each path after
+ *                 the source is stored, -1 for the source and unreachable nodes
+ *
+ * @return - 0 if success, -1 if error
+ */
+int shortestPaths(struct Graph *graph, uint16_t source, int *cost, int *hop);
+
+/**
+ * Computes the shortest path across a graph and prints the forwarding table.
  *
  * @param graph  - graph being analyzed
  * @param source - label of starting node
  */
-void dijkstra(struct Graph *graph, char source);
+void dijkstra(struct Graph *graph, uint16_t source);
 
 #endif // _LSDIJKSTRA_H
\ No newline at end of file
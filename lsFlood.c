@@ -0,0 +1,764 @@
+/**
+ * This file implements the functions used for reliably flooding link-state packets.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include "lsFlood.h"
+
+// Pools of the packet buffers and list entries, one for each network thread as a buffer
+// is only shared by the neighbors of the shard it was flooded to
+__thread struct Pool bufferPool = POOL_INITIALIZER(struct PacketBuffer, LS_POOL_CHUNK);
+__thread struct Pool entryPool = POOL_INITIALIZER(struct Retransmission, LS_POOL_CHUNK);
+// Datagrams per second a neighbor is sent, 0 if not paced, and the depth of its bucket
+double paceRate;
+double paceDepth;
+// Longest window a flooded packet is held for, 0 if packets are not batched
+long long batchWindow;
+// Mean time between the packets flooded by the network thread and when it last flooded one
+__thread long long floodGap;
+__thread long long floodTime;
+
+void setPacing(double rate, double depth)
+{
+	paceRate = rate;
+	paceDepth = depth < 1 ? 1 : depth;
+}
+
+void fillBucket(struct Neighbor *neighbor, long long now)
+{
+	neighbor->tokens += (now - neighbor->tokenTime) * paceRate / 1000000;
+	if (neighbor->tokens > paceDepth)
+		neighbor->tokens = paceDepth;
+	neighbor->tokenTime = now;
+}
+
+int takeToken(struct Neighbor *neighbor, long long now)
+{
+	if (!paceRate)
+		return 1;
+
+	fillBucket(neighbor, now);
+	if (neighbor->tokens < 1)
+		return 0;
+
+	neighbor->tokens--;
+
+	return 1;
+}
+
+long long getTokenTime(struct Neighbor *neighbor)
+{
+	return neighbor->tokenTime + (long long) ((1 - neighbor->tokens) * 1000000 / paceRate) + 1;
+}
+
+void setBatching(long long window)
+{
+	batchWindow = window;
+}
+
+long long getFloodWindow(long long now)
+{
+	long long gap, window;
+
+	if (!batchWindow)
+		return 0;
+
+	// A quiet time ends a storm and starts the mean again at twice the longest window, from
+	// which the next storm brings it down within a few packets
+	gap = now - floodTime;
+	if (gap >= 2 * batchWindow)
+		floodGap = 2 * batchWindow;
+	else
+		floodGap += (gap - floodGap) / 8;
+	floodTime = now;
+
+	// Holding a packet is only worth it while the next is expected within the window
+	if (floodGap >= batchWindow)
+		return 0;
+
+	window = floodGap * (LS_MAX_PACKETS - 1);
+
+	return window < batchWindow ? window : batchWindow;
+}
+
+struct PacketBuffer *takeBuffer()
+{
+	struct PacketBuffer *buffer = (struct PacketBuffer *) takeObject(&bufferPool);
+
+	if (buffer)
+	{
+		buffer->references = 1;
+		buffer->priority = PRIORITY_BULK;
+	}
+
+	return buffer;
+}
+
+void holdBuffer(struct PacketBuffer *buffer)
+{
+	buffer->references++;
+}
+
+void releaseBuffer(struct PacketBuffer *buffer)
+{
+	if (!--buffer->references)
+		giveObject(&bufferPool, buffer);
+}
+
+struct Retransmission *newRetransmission(struct PacketBuffer *buffer, long long now)
+{
+	struct Retransmission *node = (struct Retransmission *) takeObject(&entryPool);
+
+	if (!node)
+		return NULL;
+
+	holdBuffer(buffer);
+	node->buffer = buffer;
+	node->transmissions = 0;
+	node->sentTime = 0;
+	node->dueTime = now;
+	node->next = NULL;
+
+	return node;
+}
+
+void freeRetransmission(struct Retransmission *node)
+{
+	releaseBuffer(node->buffer);
+	giveObject(&entryPool, node);
+}
+
+struct Retransmission *removeLink(struct Retransmission **list, char *summary)
+{
+	struct Retransmission **link, *node;
+
+	link = list;
+
+	while ((node = *link))
+	{
+		if (isSameLink(node->buffer->packet, summary))
+		{
+			*link = node->next;
+			return node;
+		}
+		link = &node->next;
+	}
+
+	return NULL;
+}
+
+int sendDue(int fd, struct Neighbor *neighbor, struct Retransmission **list, int type, uint16_t sender, long long now, long long *next)
+{
+	int count, sent, size, max, flags, priority, paced;
+	long long timeout;
+	char datagram[LS_DATAGRAM_SIZE];
+	struct Retransmission **link, *node;
+
+	count = 0;
+	sent = 0;
+	size = getEntrySize(type);
+	max = (LS_DATAGRAM_SIZE - LS_HEADER_SIZE) / size;
+	flags = 0;
+	paced = 0;
+
+	// The list is walked once for each priority class, the urgent entries first, with the
+	// bulk entries filling the rest of their datagram
+	for (priority = LS_PRIORITIES - 1; priority >= 0 && !paced; priority--)
+	{
+		for (link = list; (node = *link); )
+		{
+			if (node->buffer->priority != priority)
+			{
+				link = &node->next;
+				continue;
+			}
+
+			if (node->dueTime > now)
+			{
+				if (node->dueTime < *next)
+					*next = node->dueTime;
+				link = &node->next;
+				continue;
+			}
+
+			// A neighbor that never answers a request does not have the packet
+			if (type == LS_TYPE_REQUEST && node->transmissions >= LS_REQUEST_ATTEMPTS)
+			{
+				*link = node->next;
+				freeRetransmission(node);
+				continue;
+			}
+
+			// A datagram is only started while the bucket has a token for it, the entries
+			// left are sent once it has
+			if (!count && !takeToken(neighbor, now))
+			{
+				if (getTokenTime(neighbor) < *next)
+					*next = getTokenTime(neighbor);
+				paced = 1;
+				break;
+			}
+
+			memcpy(datagram + LS_HEADER_SIZE + count * size, node->buffer->packet, size);
+			count++;
+			if (priority == PRIORITY_URGENT)
+				flags = LS_FLAG_URGENT;
+
+			if (type == LS_TYPE_UPDATE)
+				TRACE_PACKET(TRACE_SENT, node->buffer->packet, neighbor->label);
+
+			if (type == LS_TYPE_UPDATE && node->transmissions)
+				countMetric(METRIC_RETRANSMISSIONS, 1);
+
+			// Back off exponentially while the neighbor does not respond
+			timeout = neighbor->rto << (node->transmissions < 5 ? node->transmissions : 5);
+			node->transmissions++;
+			node->sentTime = now;
+			node->dueTime = now + (timeout < LS_MAX_RTO ? timeout : LS_MAX_RTO);
+			if (node->dueTime < *next)
+				*next = node->dueTime;
+
+			if (count == max)
+			{
+				buildHeader(datagram, type, sender, count);
+				setFlags(datagram, flags);
+				if (sendToNeighbor(fd, neighbor, datagram, LS_HEADER_SIZE + count * size) < 0)
+					return -1;
+				sent++;
+				count = 0;
+				flags = 0;
+			}
+			link = &node->next;
+		}
+	}
+
+	if (count)
+	{
+		buildHeader(datagram, type, sender, count);
+		setFlags(datagram, flags);
+		if (sendToNeighbor(fd, neighbor, datagram, LS_HEADER_SIZE + count * size) < 0)
+			return -1;
+		sent++;
+	}
+
+	return sent;
+}
+
+void floodPacket(struct NeighborList *neighbors, struct PacketBuffer *buffer, uint16_t except, uint16_t sender, int shard, long long now)
+{
+	int multicast;
+	long long window;
+	struct Neighbor *neighbor = neighbors->head;
+	struct Segment *segment;
+
+	window = getFloodWindow(now);
+
+	while (neighbor)
+	{
+		if (neighbor->label != except && neighbor->state != NEIGHBOR_DOWN && neighbor->shard == shard)
+		{
+			multicast = neighbor->segment && neighbor->segment->fd >= 0;
+			if (multicast)
+				neighbor->segment->flooding = 1;
+			queuePacket(neighbor, buffer, multicast, window, now);
+			countMetric(METRIC_PACKETS_FLOODED, 1);
+		}
+
+		neighbor = neighbor->next;
+	}
+
+	// One copy goes to each segment however many of its neighbors the packet is for
+	for (segment = neighbors->segments; segment; segment = segment->next)
+	{
+		if (!segment->flooding)
+			continue;
+
+		segment->flooding = 0;
+		segment->urgent |= buffer->priority == PRIORITY_URGENT;
+		memcpy(segment->datagram + LS_HEADER_SIZE + segment->count * LS_PACKET_SIZE, buffer->packet, LS_PACKET_SIZE);
+		if (++segment->count == LS_MAX_PACKETS)
+			sendSegment(segment, sender);
+	}
+}
+
+void queuePacket(struct Neighbor *neighbor, struct PacketBuffer *buffer, int multicast, long long window, long long now)
+{
+	struct Retransmission **link, *node;
+	long long due, send;
+
+	// A packet sent to the segment is due once the neighbor had time to acknowledge it
+	due = multicast ? now + neighbor->rto : now;
+	send = due;
+
+	// Any other is due at once, so whatever is sent to the neighbor first carries it, but
+	// only the end of its batch's window or a full datagram sends the batch
+	if (!multicast)
+	{
+		if (!neighbor->batchCount++)
+			neighbor->batchTime = now + window;
+		if (!window || neighbor->batchCount >= LS_MAX_PACKETS)
+			neighbor->batchTime = now;
+		send = neighbor->batchTime;
+	}
+
+	link = &neighbor->rxmtList;
+
+	while ((node = *link))
+	{
+		// A newer instance replaces the one still waiting to be acknowledged
+		if (isSameLink(node->buffer->packet, buffer->packet))
+		{
+			holdBuffer(buffer);
+			releaseBuffer(node->buffer);
+			node->buffer = buffer;
+			node->transmissions = multicast;
+			node->sentTime = now;
+			node->dueTime = due;
+			markDue(neighbor, send);
+			return;
+		}
+		link = &node->next;
+	}
+
+	if ((node = newRetransmission(buffer, now)))
+	{
+		node->transmissions = multicast;
+		node->sentTime = now;
+		node->dueTime = due;
+		*link = node;
+		markDue(neighbor, send);
+	}
+}
+
+int sendSegment(struct Segment *segment, uint16_t sender)
+{
+	int count = segment->count;
+
+	if (!count)
+		return 0;
+
+	buildHeader(segment->datagram, LS_TYPE_UPDATE, sender, count);
+	setFlags(segment->datagram, segment->urgent ? LS_FLAG_URGENT : 0);
+	segment->count = 0;
+	segment->urgent = 0;
+	segment->datagramsSent++;
+	countMetric(METRIC_DATAGRAMS_SENT, 1);
+
+	// Sent from the segment's own socket, which is bound to the group's interface
+	return sendPacket(segment->fd, segment->datagram, LS_HEADER_SIZE + count * LS_PACKET_SIZE, segment->group, segment->port);
+}
+
+int sendSegments(struct NeighborList *neighbors, uint16_t sender)
+{
+	int sent = 0;
+	struct Segment *segment;
+
+	for (segment = neighbors->segments; segment; segment = segment->next)
+	{
+		if (!segment->count)
+			continue;
+
+		if (sendSegment(segment, sender) < 0)
+			return -1;
+		sent++;
+	}
+
+	return sent;
+}
+
+int acknowledgePacket(struct Neighbor *neighbor, char *summary, long long now)
+{
+	struct Retransmission *node = neighbor->rxmtList;
+
+	while (node && !isSameLink(node->buffer->packet, summary))
+		node = node->next;
+
+	// An acknowledgement of an older instance leaves the newer one waiting
+	if (!node || compareSequence(getSequenceNumber(summary), getSequenceNumber(node->buffer->packet)) < 0)
+		return 0;
+
+	// Only packets sent once give an unambiguous round trip time
+	if (node->transmissions == 1)
+		updateTimeout(neighbor, now - node->sentTime);
+
+	freeRetransmission(removeLink(&neighbor->rxmtList, summary));
+
+	return 1;
+}
+
+int answerRequest(struct Neighbor *neighbor, char *packet)
+{
+	struct Retransmission *node = removeLink(&neighbor->requestList, packet);
+
+	if (!node)
+		return 0;
+
+	freeRetransmission(node);
+
+	return 1;
+}
+
+void requestPacket(struct Neighbor *neighbor, struct PacketBuffer *buffer, long long now)
+{
+	struct Retransmission *node;
+
+	// A request for a newer instance replaces the pending one
+	if ((node = removeLink(&neighbor->requestList, buffer->packet)))
+		freeRetransmission(node);
+
+	if (!(node = newRetransmission(buffer, now)))
+		return;
+
+	node->next = neighbor->requestList;
+	neighbor->requestList = node;
+	markDue(neighbor, now);
+}
+
+void initSummaryList(struct SummaryList *list)
+{
+	list->summaries = NULL;
+	list->count = 0;
+	list->size = 0;
+}
+
+int addSummary(struct SummaryList *list, const char *summary)
+{
+	int size;
+	char *summaries;
+
+	if (list->count == list->size)
+	{
+		size = list->size ? 2 * list->size : LS_MAX_SUMMARIES;
+
+		if (!(summaries = (char *) realloc(list->summaries, size * LS_SUMMARY_SIZE)))
+			return -1;
+
+		list->summaries = summaries;
+		list->size = size;
+	}
+
+	memcpy(list->summaries + list->count * LS_SUMMARY_SIZE, summary, LS_SUMMARY_SIZE);
+	list->count++;
+
+	return 0;
+}
+
+char *takeSummaries(struct SummaryList *list, int *count)
+{
+	char *summaries = list->summaries;
+
+	*count = list->count;
+	initSummaryList(list);
+
+	return summaries;
+}
+
+void freeSummaries(struct SummaryList *list)
+{
+	free(list->summaries);
+	initSummaryList(list);
+}
+
+struct Description *newDescription()
+{
+	struct Description *description = (struct Description *) malloc(sizeof(struct Description));
+
+	if (!description)
+	{
+		printf("Malloc failed.\n");
+		return NULL;
+	}
+
+	description->count = 0;
+	description->more = 0;
+	description->next = NULL;
+
+	return description;
+}
+
+int describeSummary(struct Description *description, const char *summary)
+{
+	memcpy(description->datagram + LS_HEADER_SIZE + description->count * LS_SUMMARY_SIZE, summary, LS_SUMMARY_SIZE);
+
+	return ++description->count == LS_MAX_SUMMARIES;
+}
+
+void packDescription(char *packet, struct Description *description)
+{
+	memset(packet, 0, LS_PACKET_SIZE);
+	memcpy(packet, &description, sizeof(description));
+}
+
+struct Description *unpackDescription(const char *packet)
+{
+	struct Description *description;
+
+	memcpy(&description, packet, sizeof(description));
+
+	return description;
+}
+
+void addDescription(struct Neighbor *neighbor, struct Description *description)
+{
+	description->next = NULL;
+
+	if (neighbor->descriptionTail)
+		neighbor->descriptionTail->next = description;
+	else
+		neighbor->description = description;
+
+	neighbor->descriptionTail = description;
+}
+
+int sendDescription(int fd, struct Neighbor *neighbor, uint16_t sender, long long now)
+{
+	int sent;
+	struct Description *description;
+
+	sent = 0;
+
+	// The datagrams were built in place, only their headers are written here, as whether
+	// the neighbor's description is still needed changes while ours is sent again
+	for (description = neighbor->description; description; description = description->next)
+	{
+		buildHeader(description->datagram, LS_TYPE_DESCRIPTION, sender, description->count);
+		setFlags(description->datagram, (description->more ? LS_FLAG_MORE : 0) |
+		                                (neighbor->state != NEIGHBOR_FULL ? LS_FLAG_NEED : 0));
+
+		if (sendToNeighbor(fd, neighbor, description->datagram, LS_HEADER_SIZE + description->count * LS_SUMMARY_SIZE) < 0)
+			return -1;
+
+		sent++;
+	}
+
+	// The description goes out whole, and the datagrams that follow wait until it is paid for
+	if (paceRate)
+	{
+		fillBucket(neighbor, now);
+		neighbor->tokens -= sent;
+	}
+
+	// Keep the description to send again until the neighbor's own description arrives
+	if (neighbor->state == NEIGHBOR_FULL)
+		freeDescription(neighbor);
+	else
+	{
+		neighbor->descTime = now + neighbor->rto;
+		markDue(neighbor, neighbor->descTime);
+	}
+
+	return sent;
+}
+
+void freeDescription(struct Neighbor *neighbor)
+{
+	struct Description *description;
+
+	while ((description = neighbor->description))
+	{
+		neighbor->description = description->next;
+		free(description);
+	}
+
+	neighbor->descriptionTail = NULL;
+	neighbor->descTime = 0;
+}
+
+int receiveDescription(struct Neighbor *neighbor, int flags)
+{
+	// Only a neighbor that is missing our description, such as one that restarted, is
+	// described to again, not a late copy of a description sent before ours arrived
+	if (neighbor->state == NEIGHBOR_FULL)
+		return (flags & LS_FLAG_NEED) != 0;
+
+	neighbor->state = NEIGHBOR_FULL;
+
+	// A description that has already been sent is no longer needed
+	if (neighbor->descTime)
+		freeDescription(neighbor);
+
+	return 0;
+}
+
+void queueAck(int fd, struct Neighbor *neighbor, uint16_t sender, const char *packet, long long now)
+{
+	if (!neighbor->ackCount)
+	{
+		neighbor->ackTime = now + LS_ACK_DELAY;
+		markDue(neighbor, neighbor->ackTime);
+	}
+
+	memcpy(neighbor->acks + LS_HEADER_SIZE + neighbor->ackCount * LS_SUMMARY_SIZE, packet, LS_SUMMARY_SIZE);
+	neighbor->ackCount++;
+
+	if (neighbor->ackCount == LS_MAX_SUMMARIES)
+		sendAcks(fd, neighbor, sender);
+}
+
+int sendAcks(int fd, struct Neighbor *neighbor, uint16_t sender)
+{
+	int length;
+
+	if (!neighbor->ackCount)
+		return 0;
+
+	buildHeader(neighbor->acks, LS_TYPE_ACK, sender, neighbor->ackCount);
+	length = LS_HEADER_SIZE + neighbor->ackCount * LS_SUMMARY_SIZE;
+	neighbor->ackCount = 0;
+
+	return sendToNeighbor(fd, neighbor, neighbor->acks, length);
+}
+
+int transmitPackets(int fd, struct Neighbor *neighbor, uint16_t sender, long long now)
+{
+	int sent, result;
+	long long next;
+
+	sent = 0;
+	next = LLONG_MAX;
+	// Everything held is sent now, or waits on the bucket alone
+	neighbor->batchCount = 0;
+
+	if ((result = sendDue(fd, neighbor, &neighbor->rxmtList, LS_TYPE_UPDATE, sender, now, &next)) < 0)
+		return -1;
+	sent += result;
+
+	if ((result = sendDue(fd, neighbor, &neighbor->requestList, LS_TYPE_REQUEST, sender, now, &next)) < 0)
+		return -1;
+	sent += result;
+
+	if (neighbor->state == NEIGHBOR_EXCHANGE && neighbor->descTime && neighbor->descTime <= now)
+	{
+		if ((result = sendDescription(fd, neighbor, sender, now)) < 0)
+			return -1;
+		sent += result;
+	}
+
+	if (neighbor->ackCount && neighbor->ackTime <= now)
+	{
+		if (sendAcks(fd, neighbor, sender) < 0)
+			return -1;
+		sent++;
+	}
+
+	// Whatever was not sent is due later
+	if (neighbor->ackCount && neighbor->ackTime < next)
+		next = neighbor->ackTime;
+	if (neighbor->state == NEIGHBOR_EXCHANGE && neighbor->descTime && neighbor->descTime < next)
+		next = neighbor->descTime;
+	neighbor->transmitTime = next;
+
+	return sent;
+}
+
+void updateTimeout(struct Neighbor *neighbor, long long sample)
+{
+	long long delta, rto;
+
+	// Smoothed round trip time and variation as used by TCP (RFC 6298)
+	if (!neighbor->srtt)
+	{
+		neighbor->srtt = sample;
+		neighbor->rttvar = sample / 2;
+	}
+	else
+	{
+		delta = neighbor->srtt - sample;
+		neighbor->rttvar = (3 * neighbor->rttvar + (delta < 0 ? -delta : delta)) / 4;
+		neighbor->srtt = (7 * neighbor->srtt + sample) / 8;
+	}
+
+	rto = neighbor->srtt + 4 * neighbor->rttvar;
+
+	if (rto < LS_MIN_RTO)
+		rto = LS_MIN_RTO;
+	else if (rto > LS_MAX_RTO)
+		rto = LS_MAX_RTO;
+
+	neighbor->rto = rto;
+}
+
+void markDue(struct Neighbor *neighbor, long long time)
+{
+	if (time < neighbor->transmitTime)
+		neighbor->transmitTime = time;
+}
+
+int sendToNeighbor(int fd, struct Neighbor *neighbor, const char *datagram, int length)
+{
+	int written = SHM_FULL;
+	char doorbell[LS_HEADER_SIZE];
+
+	// A neighbor on the same host is written to through its ring while it reads it. One
+	// gone quiet has its ring opened again by the next hello, if it comes back.
+	if (neighbor->sendRing && (written = writeShmRing(neighbor->sendRing, datagram, length, currentTime())) == SHM_STALE_READER)
+	{
+		closeShmRing(neighbor->sendRing);
+		neighbor->sendRing = NULL;
+	}
+
+	if (written == SHM_WAKE)
+	{
+		// A hello through the socket wakes the neighbor waiting on it, steered to its shard
+		buildHeader(doorbell, LS_TYPE_HELLO, getSenderID((char *) datagram), 0);
+		sendPacket(fd, doorbell, LS_HEADER_SIZE, neighbor->address, neighbor->port);
+	}
+	else if (written < 0 && sendPacket(fd, datagram, length, neighbor->address, neighbor->port) < 0)
+		return -1;
+
+	neighbor->datagramsSent++;
+	countMetric(METRIC_DATAGRAMS_SENT, 1);
+	if (getType((char *) datagram) == LS_TYPE_HELLO)
+		neighbor->hellosSent++;
+
+	return 0;
+}
+
+int sendHello(int fd, struct Neighbor *neighbor, uint16_t sender)
+{
+	char datagram[LS_HEADER_SIZE];
+
+	// The ring of a neighbor on the same host is looked for until the neighbor creates it
+	if (neighbor->local && !neighbor->sendRing)
+		neighbor->sendRing = openShmRing(neighbor->port, sender);
+
+	buildHeader(datagram, LS_TYPE_HELLO, sender, 0);
+
+	return sendToNeighbor(fd, neighbor, datagram, LS_HEADER_SIZE);
+}
+
+void resetNeighbor(struct Neighbor *neighbor)
+{
+	struct Retransmission *node;
+
+	while ((node = neighbor->rxmtList))
+	{
+		neighbor->rxmtList = node->next;
+		freeRetransmission(node);
+	}
+
+	while ((node = neighbor->requestList))
+	{
+		neighbor->requestList = node->next;
+		freeRetransmission(node);
+	}
+
+	freeDescription(neighbor);
+	freeSummaries(&neighbor->peerDescription);
+	freeSummaries(&neighbor->peerRequests);
+	neighbor->ackCount = 0;
+	neighbor->batchCount = 0;
+	neighbor->state = NEIGHBOR_DOWN;
+
+	// The round trip time is measured again once the neighbor comes back up
+	neighbor->srtt = 0;
+	neighbor->rttvar = 0;
+	neighbor->rto = LS_INITIAL_RTO;
+
+	neighbor->transmitTime = LLONG_MAX;
+	removeTimer(&neighbor->transmitTimer);
+}
@@ -0,0 +1,475 @@
+/**
+ * This file describes the functions used for reliably flooding link-state packets.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSFLOOD_H
+#define _LSFLOOD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lsMetrics.h"
+#include "lsNetwork.h"
+#include "lsPacket.h"
+#include "lsPool.h"
+#include "lsTrace.h"
+
+// Microseconds an acknowledgement is held before it is sent
+#define LS_ACK_DELAY 5000
+// Retransmission timeout in microseconds before a round trip time has been measured
+#define LS_INITIAL_RTO 200000
+// Smallest retransmission timeout in microseconds, leaving room for the acknowledgement delay
+#define LS_MIN_RTO (4 * LS_ACK_DELAY)
+// Largest retransmission timeout in microseconds, including backoff
+#define LS_MAX_RTO 5000000
+// Number of times a request is sent before giving up on the neighbor having the packet
+#define LS_REQUEST_ATTEMPTS 5
+// Microseconds between hellos sent to a neighbor
+#define LS_HELLO_INTERVAL 100000
+// Microseconds without hearing from a neighbor before it is considered down
+#define LS_DEAD_INTERVAL (4 * LS_HELLO_INTERVAL)
+// Longest time in microseconds a starting router waits for all of its neighbors to come up
+// before it reports being started without them
+#define LS_STARTUP_TIMEOUT 10000000
+// Packet buffers and list entries the pools grow by when they run out
+#define LS_POOL_CHUNK 1024
+
+struct PacketBuffer
+{
+	char packet[LS_PACKET_SIZE];
+	// Priority class of the packet (PRIORITY_*)
+	int priority;
+	// Holders of the buffer, which goes back to the pool when the last releases it
+	int references;
+};
+
+struct Retransmission
+{
+	// Packet or summary, shared with the entries of the other neighbors it was flooded to
+	struct PacketBuffer *buffer;
+	int transmissions;
+	long long sentTime;
+	long long dueTime;
+	struct Retransmission *next;
+};
+
+/**
+ * Sets how the datagrams sent to each neighbor are paced, by a token bucket as deep as the
+ * neighbor's receive buffer so that a flood does not overrun the buffer and get dropped.
+ * Acknowledgements and hellos are not paced.
+ *
+ * @param rate  - datagrams per second a neighbor is sent, 0 to not pace them
+ * @param depth - datagrams a neighbor's bucket holds, sent back to back after a quiet time
+ */
+void setPacing(double rate, double depth);
+
+/**
+ * Fills the bucket of a neighbor with the tokens earned at the pacing rate since it was
+ * last filled, up to its depth.
+ *
+ * @param neighbor - neighboring router
+ * @param now      - current time in microseconds
+ */
+void fillBucket(struct Neighbor *neighbor, long long now);
+
+/**
+ * Takes the token a datagram sent to a neighbor costs.
+ *
+ * @param neighbor - neighboring router
+ * @param now      - current time in microseconds
+ *
+ * @return - 1 if taken or not pacing, 0 if the bucket is empty
+ */
+int takeToken(struct Neighbor *neighbor, long long now);
+
+/**
+ * Gets the time the bucket of a neighbor next holds a token.
+ *
+ * @param neighbor - neighboring router
+ *
+ * @return - time in microseconds
+ */
+long long getTokenTime(struct Neighbor *neighbor);
+
+/**
+ * Sets the longest time flooded packets are held to batch them.
+ *
+ * @param window - longest window in microseconds, 0 to send every packet at once
+ */
+void setBatching(long long window);
+
+/**
+ * Counts a packet flooded by the network thread in the mean time between its floods,
+ * and gets the window the packet is held for to batch it with the packets that follow.
+ * While floods arrive further apart than the longest window, none would join a held
+ * packet and it is sent at once. In a storm the window grows to the time a datagram
+ * takes to fill at the rate they arrive, up to the longest window.
+ *
+ * @param now - current time in microseconds
+ *
+ * @return - window in microseconds, 0 if the packet is sent at once
+ */
+long long getFloodWindow(long long now);
+
+/**
+ * Takes a packet buffer from the network thread's pool, held once by the caller. A
+ * flooded packet is held in one buffer that the retransmission list entries of every
+ * neighbor share, so it is neither copied nor allocated per neighbor. The packet is bulk
+ * until its priority is set.
+ *
+ * @return - pointer to buffer, NULL if error
+ */
+struct PacketBuffer *takeBuffer();
+
+/**
+ * Adds a holder to a packet buffer.
+ *
+ * @param buffer - packet buffer
+ */
+void holdBuffer(struct PacketBuffer *buffer);
+
+/**
+ * Removes a holder from a packet buffer, giving it back to the pool if it was the last.
+ *
+ * @param buffer - packet buffer
+ */
+void releaseBuffer(struct PacketBuffer *buffer);
+
+/**
+ * Initializes a new retransmission list node, taken from the pool and holding a buffer.
+ *
+ * @param buffer - buffer of link-state packet awaiting acknowledgement
+ * @param now    - current time in microseconds
+ *
+ * @return - pointer to node
+ */
+struct Retransmission *newRetransmission(struct PacketBuffer *buffer, long long now);
+
+/**
+ * Gives a retransmission list node back to the pool, releasing its buffer.
+ *
+ * @param node - node removed from its list
+ */
+void freeRetransmission(struct Retransmission *node);
+
+/**
+ * Removes the entry for a link from a retransmission or request list.
+ *
+ * @param list    - list being searched
+ * @param summary - summary of a packet for the link
+ *
+ * @return - removed entry, NULL if the link is not on the list
+ */
+struct Retransmission *removeLink(struct Retransmission **list, char *summary);
+
+/**
+ * Sends the entries of a retransmission or request list that are due, the urgent ones
+ * first, in as few datagrams as possible and as many as the neighbor's bucket has tokens
+ * for. A datagram holding an urgent entry is marked urgent.
+ *
+ * @param fd       - file descriptor of socket being used
+ * @param neighbor - neighboring router
+ * @param list     - list being sent
+ * @param type     - type of datagram (LS_TYPE_UPDATE or LS_TYPE_REQUEST)
+ * @param sender   - label of local router
+ * @param now      - current time in microseconds
+ * @param next     - lowered to the earliest time an entry left on the list is due, or
+ *                   the bucket has a token for it
+ *
+ * @return - number of datagrams sent, -1 if error occurred
+ */
+int sendDue(int fd, struct Neighbor *neighbor, struct Retransmission **list, int type, uint16_t sender, long long now, long long *next);
+
+/**
+ * Queues a link-state packet on the retransmission list of every neighbor of a receive
+ * shard that is up except one, where it stays until the neighbor acknowledges it. The
+ * neighbors of other shards are flooded to by their own network threads. The packet is
+ * added to the datagram of each segment it is flooded to by multicast, which is sent
+ * once full however many neighbors share the segment.
+ *
+ * @param neighbors - list of neighboring routers
+ * @param buffer    - buffer of link-state packet being flooded
+ * @param except    - label of the neighbor the packet was received from
+ * @param sender    - label of local router
+ * @param shard     - receive shard of the neighbors flooded to
+ * @param now       - current time in microseconds
+ */
+void floodPacket(struct NeighborList *neighbors, struct PacketBuffer *buffer, uint16_t except, uint16_t sender, int shard, long long now);
+
+/**
+ * Queues a link-state packet on the retransmission list of a neighbor to be sent with the
+ * batch held for the neighbor, or only once it is due for retransmission if it has been
+ * sent to the neighbor's segment, in which case it is retransmitted to the neighbor alone.
+ * An older instance of the same link already on the list is replaced.
+ *
+ * @param neighbor  - neighboring router
+ * @param buffer    - buffer of link-state packet being sent
+ * @param multicast - 1 if the packet is sent to the neighbor's segment, 0 otherwise
+ * @param window    - microseconds the batch is held for if the packet opens it, 0 to
+ *                    send the batch right away
+ * @param now       - current time in microseconds
+ */
+void queuePacket(struct Neighbor *neighbor, struct PacketBuffer *buffer, int multicast, long long window, long long now);
+
+/**
+ * Sends the link-state packets flooded to a segment to its multicast group.
+ *
+ * @param segment - broadcast segment
+ * @param sender  - label of local router
+ *
+ * @return - 0 if successful, -1 if error occurred
+ */
+int sendSegment(struct Segment *segment, uint16_t sender);
+
+/**
+ * Sends the link-state packets flooded to every segment since they were last sent.
+ *
+ * @param neighbors - list of neighboring routers
+ * @param sender    - label of local router
+ *
+ * @return - number of datagrams sent, -1 if error occurred
+ */
+int sendSegments(struct NeighborList *neighbors, uint16_t sender);
+
+/**
+ * Removes an acknowledged link-state packet from the retransmission list of a neighbor
+ * and updates the neighbor's retransmission timeout.
+ *
+ * @param neighbor - neighboring router that sent the acknowledgement
+ * @param summary  - summary of the acknowledged packet
+ * @param now      - current time in microseconds
+ *
+ * @return - 1 if a packet was removed, 0 otherwise
+ */
+int acknowledgePacket(struct Neighbor *neighbor, char *summary, long long now);
+
+/**
+ * Removes the request for a link from the request list of a neighbor once the neighbor
+ * has sent a packet for the link.
+ *
+ * @param neighbor - neighboring router that sent the packet
+ * @param packet   - received link-state packet
+ *
+ * @return - 1 if a request was removed, 0 otherwise
+ */
+int answerRequest(struct Neighbor *neighbor, char *packet);
+
+/**
+ * Queues a request for a link-state packet on the request list of a neighbor, where it is
+ * retransmitted until the neighbor answers it.
+ *
+ * @param neighbor - neighboring router
+ * @param buffer   - buffer of summary of the packet being requested
+ * @param now      - current time in microseconds
+ */
+void requestPacket(struct Neighbor *neighbor, struct PacketBuffer *buffer, long long now);
+
+/**
+ * Initializes an empty list of packet summaries.
+ *
+ * @param list - summary list
+ */
+void initSummaryList(struct SummaryList *list);
+
+/**
+ * Adds a packet summary to a list of summaries, such as the database description received
+ * from a neighbor.
+ *
+ * @param list    - summary list
+ * @param summary - packet summary
+ *
+ * @return - 0 if successful, -1 if an error occurred
+ */
+int addSummary(struct SummaryList *list, const char *summary);
+
+/**
+ * Takes the summaries held by a list, leaving it empty.
+ *
+ * @param list  - summary list
+ * @param count - where the number of summaries will be stored
+ *
+ * @return - buffer of summaries to be freed by the caller, NULL if there were none
+ */
+char *takeSummaries(struct SummaryList *list, int *count);
+
+/**
+ * Frees the summaries held by a list, leaving it empty.
+ *
+ * @param list - summary list
+ */
+void freeSummaries(struct SummaryList *list);
+
+/**
+ * Allocates an empty datagram of a database description.
+ *
+ * @return - pointer to datagram, NULL if error
+ */
+struct Description *newDescription();
+
+/**
+ * Adds a packet summary to a datagram of a database description.
+ *
+ * @param description - datagram of the description
+ * @param summary     - packet summary
+ *
+ * @return - 1 if the datagram is now full, 0 otherwise
+ */
+int describeSummary(struct Description *description, const char *summary);
+
+/**
+ * Stores a pointer to a datagram of a database description in a queued packet, so that
+ * the datagram is handed to the network thread with one queue entry.
+ *
+ * @param packet      - buffer of LS_PACKET_SIZE bytes the pointer is stored in
+ * @param description - datagram of the description
+ */
+void packDescription(char *packet, struct Description *description);
+
+/**
+ * Gets the datagram of a database description whose pointer a queued packet holds.
+ *
+ * @param packet - queued packet
+ *
+ * @return - pointer to datagram
+ */
+struct Description *unpackDescription(const char *packet);
+
+/**
+ * Adds a datagram to the end of the database description built for a neighbor.
+ *
+ * @param neighbor    - neighboring router
+ * @param description - datagram of the description, now owned by the neighbor
+ */
+void addDescription(struct Neighbor *neighbor, struct Description *description);
+
+/**
+ * Sends the database description built for a neighbor, which summarizes every packet we
+ * have so that the neighbor requests only those it is missing or has older. It is sent
+ * whole and paid for with the tokens of the datagrams that follow, and is sent again on
+ * the retransmission timeout until the neighbor's own description is received.
+ *
+ * @param fd       - file descriptor of socket being used
+ * @param neighbor - neighboring router
+ * @param sender   - label of local router
+ * @param now      - current time in microseconds
+ *
+ * @return - number of datagrams sent, -1 if error occurred
+ */
+int sendDescription(int fd, struct Neighbor *neighbor, uint16_t sender, long long now);
+
+/**
+ * Frees the database description built for a neighbor.
+ *
+ * @param neighbor - neighboring router
+ */
+void freeDescription(struct Neighbor *neighbor);
+
+/**
+ * Completes the exchange with a neighbor after the last datagram of its database
+ * description is received.
+ *
+ * @param neighbor - neighboring router
+ * @param flags    - flags of the last datagram of the description
+ *
+ * @return - 1 if the exchange was already complete but the neighbor has not
+ *           received our description and it must be described again, 0 otherwise
+ */
+int receiveDescription(struct Neighbor *neighbor, int flags);
+
+/**
+ * Queues the acknowledgement of a received link-state packet. The acknowledgements
+ * are sent once the oldest has been held for LS_ACK_DELAY or a datagram is full.
+ *
+ * @param fd       - file descriptor of socket being used
+ * @param neighbor - neighboring router the packet was received from
+ * @param sender   - label of local router
+ * @param packet   - received link-state packet
+ * @param now      - current time in microseconds
+ */
+void queueAck(int fd, struct Neighbor *neighbor, uint16_t sender, const char *packet, long long now);
+
+/**
+ * Sends all of the acknowledgements held for a neighbor.
+ *
+ * @param fd       - file descriptor of socket being used
+ * @param neighbor - neighboring router
+ * @param sender   - label of local router
+ *
+ * @return - 0 if successful, -1 if error occurred
+ */
+int sendAcks(int fd, struct Neighbor *neighbor, uint16_t sender);
+
+/**
+ * Sends the link-state packets and requests of a neighbor that are new or due for
+ * retransmission, along with any acknowledgements that have been held long enough and
+ * the database description if it is due to be sent again. The transmit time of the
+ * neighbor is set to when the next of them is due.
+ *
+ * @param fd       - file descriptor of socket being used
+ * @param neighbor - neighboring router
+ * @param sender   - label of local router
+ * @param now      - current time in microseconds
+ *
+ * @return - number of datagrams sent, -1 if error occurred
+ */
+int transmitPackets(int fd, struct Neighbor *neighbor, uint16_t sender, long long now);
+
+/**
+ * Updates the retransmission timeout of a neighbor with a round trip time sample, so
+ * that the timeout follows the neighbor's round trip time.
+ *
+ * @param neighbor - neighboring router
+ * @param sample   - measured round trip time in microseconds
+ */
+void updateTimeout(struct Neighbor *neighbor, long long sample);
+
+/**
+ * Moves the transmit time of a neighbor earlier if something is due to be sent sooner.
+ *
+ * @param neighbor - neighboring router
+ * @param time     - time in microseconds something is due to be sent
+ */
+void markDue(struct Neighbor *neighbor, long long time);
+
+/**
+ * Sends a datagram to a neighbor and counts it in the neighbor's statistics. A neighbor
+ * on the same host is written to through its ring while the ring has room and is read,
+ * and through the socket otherwise.
+ *
+ * @param fd       - file descriptor of socket being used
+ * @param neighbor - neighboring router
+ * @param datagram - datagram being sent
+ * @param length   - length of datagram in bytes
+ *
+ * @return - 0 if successful, -1 if error occurred
+ */
+int sendToNeighbor(int fd, struct Neighbor *neighbor, const char *datagram, int length);
+
+/**
+ * Sends a hello to a neighbor, first opening the ring of a neighbor on the same host if
+ * it has created one since the last hello.
+ *
+ * @param fd       - file descriptor of socket being used
+ * @param neighbor - neighboring router
+ * @param sender   - label of local router
+ *
+ * @return - 0 if successful, -1 if error occurred
+ */
+int sendHello(int fd, struct Neighbor *neighbor, uint16_t sender);
+
+/**
+ * Marks a neighbor as down, after nothing was heard from it for the dead interval, and
+ * drops every packet, request, description and acknowledgement waiting to be sent to it,
+ * along with the summaries it sent. The databases are exchanged again once it comes up.
+ *
+ * @param neighbor - neighboring router
+ */
+void resetNeighbor(struct Neighbor *neighbor);
+
+#endif // _LSFLOOD_H
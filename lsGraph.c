@@ -11,30 +11,44 @@
 
 struct Graph *newGraph(int size, int directed)
 {
-	int i;
+	int i, slots;
 	struct Graph *graph = (struct Graph *) malloc(sizeof(struct Graph));
 
 	if (!graph)
 		return NULL;
 
-	if(!(graph->key = (char *) malloc(size * sizeof(char))))
-	{
-		free(graph);
-		return NULL;
-	}
+	// Twice as many slots as routers, rounded up to a power of two
+	for (slots = 2; slots < 2 * size; slots <<= 1)
+		;
 
-	for (i = 0; i < size; i++)
-		graph->key[i] = '\0';
+	graph->key = (uint16_t *) malloc(size * sizeof(uint16_t));
+	graph->array = (struct AdjList *) malloc(size * sizeof(struct AdjList));
+	graph->slots = (int *) malloc(slots * sizeof(int));
+	graph->freeIndices = (int *) malloc(size * sizeof(int));
 
-	if(!(graph->array = (struct AdjList *) malloc(size * sizeof(struct AdjList))))
+	if (!graph->key || !graph->array || !graph->slots || !graph->freeIndices)
 	{
 		free(graph->key);
+		free(graph->array);
+		free(graph->slots);
+		free(graph->freeIndices);
 		free(graph);
 		return NULL;
 	}
 
 	for (i = 0; i < size; i++)
+	{
+		graph->key[i] = LS_ROUTER_NONE;
 		graph->array[i].head = NULL;
+		// Lowest index on top
+		graph->freeIndices[i] = size - 1 - i;
+	}
+
+	for (i = 0; i < slots; i++)
+		graph->slots[i] = -1;
+
+	graph->slotMask = slots - 1;
+	graph->freeCount = size;
 
 	graph->size = size;
 	graph->directed = directed;
@@ -43,126 +57,297 @@ struct Graph *newGraph(int size, int directed)
 	return graph;
 }
 
-struct AdjListNode *newAdjListNode(int dest, int cost, int seqN)
+void freeGraph(struct Graph *graph)
+{
+	int i;
+	struct AdjListNode *node, *next;
+
+	for (i = 0; i < graph->size; i++)
+	{
+		for (node = graph->array[i].head; node; node = next)
+		{
+			next = node->next;
+			freeAdjListNode(node);
+		}
+	}
+
+	free(graph->key);
+	free(graph->array);
+	free(graph->slots);
+	free(graph->freeIndices);
+	free(graph);
+}
+
+struct AdjListNode *newAdjListNode(int source, int dest, int cost, int32_t seqN)
 {
 	struct AdjListNode *node = (struct AdjListNode *) malloc(sizeof(struct AdjListNode));
 
 	if (!node)
 		return NULL;
 
+	node->source = source;
 	node->dest = dest;
 	node->cost = cost;
 	node->seqN = seqN;
+	node->originTime = 0;
+	initTimer(&node->ageTimer, NULL, node);
+	node->unverified = 0;
 	node->next = NULL;
 
 	return node;
 }
 
-int updateEdge(struct Graph *graph, int source, int dest, int cost, int seqN)
+void freeAdjListNode(struct AdjListNode *node)
+{
+	removeTimer(&node->ageTimer);
+	free(node);
+}
+
+struct AdjListNode *findEdge(struct Graph *graph, int source, int dest)
 {
-	int returnVal = 0;
 	struct AdjListNode *node = graph->array[source].head;
 
-	while (node)
+	while (node && node->dest != dest)
+		node = node->next;
+
+	return node;
+}
+
+int updateEdge(struct Graph *graph, int source, int dest, int cost, int32_t seqN)
+{
+	struct AdjListNode *node = findEdge(graph, source, dest);
+
+	if (!node)
+		return -1;
+
+	// The edge from the source holds the sequence number of the source's packets
+	if (compareSequence(seqN, node->seqN) <= 0)
+		return 0;
+
+	// A refresh that leaves the cost unchanged does not need new shortest paths
+	if (node->cost != cost)
+		graph->updated = 1;
+
+	node->cost = cost;
+	node->seqN = seqN;
+	node->unverified = 0;
+
+	// If undirected graph, update the cost of the reverse edge as well while the
+	// destination router has not advertised it. Once it has, the edge keeps the cost of
+	// the destination's packets, so a packet for one direction never undoes the other
+	// router's withdrawal or revives its own withdrawn direction.
+	if (!graph->directed && (node = findEdge(graph, dest, source)) && node->seqN == LS_SEQUENCE_NONE)
+	{
+		if (node->cost != cost)
+			graph->updated = 1;
+		node->cost = cost;
+	}
+
+	return 1;
+}
+
+int addEdge(struct Graph *graph, uint16_t source, uint16_t dest, int cost, int32_t seqN)
+{
+	int srcI, destI, returnVal;
+	struct AdjListNode *node;
+
+	// Get the indices of the source and destination nodes
+	srcI = getIndex(graph, source);
+	destI = getIndex(graph, dest);
+
+	if (srcI < 0 || destI < 0)
+		return -1;
+
+	// Attempt to update existing edge
+	if ((returnVal = updateEdge(graph, srcI, destI, cost, seqN)) >= 0)
+		return returnVal;
+
+	// If no existing edge was found, add a new edge
+	if (!(node = newAdjListNode(srcI, destI, cost, seqN)))	
+		return -1;
+
+	node->next = graph->array[srcI].head;
+	graph->array[srcI].head = node;
+	graph->updated = 1;
+
+	// If undirected graph, add reverse edge as well
+	if (!graph->directed)
+	{
+		if (!(node = newAdjListNode(destI, srcI, cost, LS_SEQUENCE_NONE)))
+			return -1;
+
+		node->next = graph->array[destI].head;
+		graph->array[destI].head = node;
+	}
+
+	return 1;
+}
+
+int removeEdge(struct Graph *graph, int source, int dest)
+{
+	int returnVal = 0;
+	struct AdjListNode **link, *node;
+
+	link = &graph->array[source].head;
+
+	while ((node = *link))
 	{
 		if (node->dest == dest)
 		{
-			if ((node->seqN + 1) % 256 == seqN)
-			{
-				node->cost = cost;
-				node->seqN = seqN;
-				graph->updated = 1;
-			}
+			*link = node->next;
+			freeAdjListNode(node);
+			graph->updated = 1;
 			returnVal = 1;
 			break;
 		}
-		node = node->next;
+		link = &node->next;
 	}
 
-	// If undirected graph, find and update reverse edge as well
+	// If undirected graph, remove reverse edge as well
 	if (!graph->directed && returnVal)
 	{
-		node = graph->array[dest].head;
+		link = &graph->array[dest].head;
 
-		while (node)
+		while ((node = *link))
 		{
 			if (node->dest == source)
 			{
-				if ((node->seqN + 1) % 256 == seqN)
-				{
-					node->cost = cost;
-					node->seqN = seqN;
-				}
+				*link = node->next;
+				freeAdjListNode(node);
 				break;
 			}
-			node = node->next;
+			link = &node->next;
 		}
 	}
 	return returnVal;
 }
 
-int addEdge(struct Graph *graph, char source, char dest, int cost, int seqN)
+int withdrawEdge(struct Graph *graph, uint16_t source, uint16_t dest, int32_t seqN)
 {
 	int srcI, destI;
-	struct AdjListNode *node;
 
-	// Get the indices of the source and destination nodes
-	srcI = getIndex(graph->key, graph->size, source);
-	destI = getIndex(graph->key, graph->size, dest);
+	// A withdrawal never assigns an index, unknown routers have no edges to withdraw
+	srcI = findIndex(graph, source);
+	destI = findIndex(graph, dest);
 
 	if (srcI < 0 || destI < 0)
 		return 0;
 
-	// Attempt to update existing edge
-	if (updateEdge(graph, srcI, destI, cost, seqN))
-		return 1;
+	// The edge is kept as a tombstone so that older packets for it are still recognized
+	return updateEdge(graph, srcI, destI, LS_WITHDRAW_COST, seqN) > 0;
+}
 
-	// If no existing edge was found, add a new edge
-	if (!(node = newAdjListNode(destI, cost, seqN)))	
-		return 0;
+int removeUnreachable(struct Graph *graph, uint16_t root)
+{
+	int i, removed;
+	char kept[graph->size];
+	struct AdjListNode *node;
 
-	node->next = graph->array[srcI].head;
-	graph->array[srcI].head = node;
-	graph->updated = 1;
+	int rootI = findIndex(graph, root);
 
-	// If undirected graph, add reverse edge as well
-	if (!graph->directed)
+	for (i = 0; i < graph->size; i++)
+		kept[i] = i == rootI;
+
+	// A router stays while any record, live or withdrawn, leads from or to it. Unreachable
+	// routers still advertising a link may have sent their packets before the ones
+	// connecting them to us, and a withdrawn link is kept as a tombstone until its record
+	// ages out, so that an older packet for the link arriving late cannot revive it.
+	for (i = 0; i < graph->size; i++)
 	{
-		if (!(node = newAdjListNode(srcI, cost, seqN)))
-			return 0;
+		if (!graph->key[i] || !graph->array[i].head)
+			continue;
 
-		node->next = graph->array[destI].head;
-		graph->array[destI].head = node;
+		kept[i] = 1;
+		for (node = graph->array[i].head; node; node = node->next)
+			kept[node->dest] = 1;
 	}
 
-	return 1;
+	// Free every other router so its index can be reused
+	removed = 0;
+	for (i = 0; i < graph->size; i++)
+	{
+		if (!graph->key[i] || kept[i])
+			continue;
+
+		releaseIndex(graph, i);
+		removed++;
+	}
+
+	return removed;
 }
 
-int getIndex(char *key, int size, char label)
+int findIndex(struct Graph *graph, uint16_t label)
 {
 	int i;
 
-	for (i = 0; i < size && key[i]; i++)
+	// Router IDs are mostly handed out in sequence, so the ID itself spreads them over the slots
+	for (i = label & graph->slotMask; graph->slots[i] >= 0; i = (i + 1) & graph->slotMask)
 	{
-		if (label == key[i])
-			return i;
+		if (graph->key[graph->slots[i]] == label)
+			return graph->slots[i];
 	}
 
-	if (i < size)
+	return -1;
+}
+
+int getIndex(struct Graph *graph, uint16_t label)
+{
+	int i, index;
+
+	for (i = label & graph->slotMask; graph->slots[i] >= 0; i = (i + 1) & graph->slotMask)
 	{
-		key[i] = label;
-		return i;
+		if (graph->key[graph->slots[i]] == label)
+			return graph->slots[i];
 	}
 
-	return -1;
+	if (!graph->freeCount)
+		return -1;
+
+	// The search stopped at an empty slot, which is where the label goes
+	index = graph->freeIndices[--graph->freeCount];
+	graph->key[index] = label;
+	graph->slots[i] = index;
+
+	return index;
+}
+
+void releaseIndex(struct Graph *graph, int index)
+{
+	int i, j, home;
+
+	for (i = graph->key[index] & graph->slotMask; graph->slots[i] != index; i = (i + 1) & graph->slotMask)
+		;
+
+	// Shift back the entries after the slot that would no longer be found past the gap
+	j = i;
+	while (1)
+	{
+		j = (j + 1) & graph->slotMask;
+		if (graph->slots[j] < 0)
+			break;
+
+		home = graph->key[graph->slots[j]] & graph->slotMask;
+		if (((j - home) & graph->slotMask) >= ((j - i) & graph->slotMask))
+		{
+			graph->slots[i] = graph->slots[j];
+			i = j;
+		}
+	}
+
+	graph->slots[i] = -1;
+	graph->key[index] = LS_ROUTER_NONE;
+	graph->freeIndices[graph->freeCount++] = index;
 }
 
 int addEdgeFromPacket(struct Graph *graph, char *lsPacket)
 {
-	char source = getSourceID(lsPacket);
-	char dest = getDestinationID(lsPacket);
+	uint16_t source = getSourceID(lsPacket);
+	uint16_t dest = getDestinationID(lsPacket);
 	int cost = getCost(lsPacket);
-	int seqN = getSequenceNumber(lsPacket);
+	int32_t seqN = getSequenceNumber(lsPacket);
+
+	if (isWithdrawal(lsPacket))
+		return withdrawEdge(graph, source, dest, seqN);
 
 	return addEdge(graph, source, dest, cost, seqN);
 }
@@ -170,17 +355,25 @@ int addEdgeFromPacket(struct Graph *graph, char *lsPacket)
 void printGraph(struct Graph *graph)
 {
 	int i;
+	char label[LS_ID_LENGTH];
 	struct AdjListNode *node;
 
 	for (i = 0; i < graph->size; i++)
 	{
+		if (!graph->key[i])
+			continue;
+
 		node = graph->array[i].head;
 
-		printf("Vertex '%c' connects to:\n", graph->key[i]);
+		printf("Vertex '%s' connects to:\n", formatRouterID(graph->key[i], label));
 
 		while (node)
 		{
-			printf("\t'%c' at a cost of %d\n", graph->key[node->dest], node->cost);
+			formatRouterID(graph->key[node->dest], label);
+			if (node->cost == LS_WITHDRAW_COST)
+				printf("\t'%s' withdrawn\n", label);
+			else
+				printf("\t'%s' at a cost of %d\n", label, node->cost);
 			node = node->next;
 		}
 	}
@@ -15,28 +15,42 @@
 #include <stdlib.h>
 
 #include "lsPacket.h"
+#include "lsTimer.h"
 
 struct Graph
 {
 	int size;
 	int directed;
 	int updated;
-	char *key;
+	uint16_t *key;
 	struct AdjList *array;
-} Graph;
+	// Open addressed hash table from router ID to index, -1 marking an empty slot
+	int *slots;
+	int slotMask;
+	// Indices not assigned to a router, the next one to be assigned on top
+	int *freeIndices;
+	int freeCount;
+};
 
 struct AdjList
 {
 	struct AdjListNode *head;
-} AdjList;
+};
 
 struct AdjListNode
 {
+	int source;
 	int dest;
 	int cost;
-	int seqN;
+	int32_t seqN;
+	// Time in microseconds the source's packet for the edge had an age of 0
+	long long originTime;
+	// Flushes the source's packet for the edge when it reaches LS_MAX_AGE
+	struct Timer ageTimer;
+	// Set for a record restored from a checkpoint until a neighbor's database confirms it
+	int unverified;
 	struct AdjListNode *next;
-} AdjListNode;
+};
 
 /**
  * Allocates memory for a new graph structure.
@@ -48,16 +62,42 @@ struct AdjListNode
  */
 struct Graph *newGraph(int size, int directed);
 
+/**
+ * Frees a graph along with all of its edges.
+ *
+ * @param graph - graph being freed
+ */
+void freeGraph(struct Graph *graph);
+
 /**
  * Allocates memory for a new adjacency list node
  *
- * @param dest - index of destination node
- * @param cost - cost of traversing the edge
- * @param seqN - sequence number of last link-state packet received.
+ * @param source - index of source node
+ * @param dest   - index of destination node
+ * @param cost   - cost of traversing the edge
+ * @param seqN   - sequence number of last link-state packet received.
  *
  * @return - pointer to edge structure
  */
-struct AdjListNode *newAdjListNode(int dest, int cost, int seqN);
+struct AdjListNode *newAdjListNode(int source, int dest, int cost, int32_t seqN);
+
+/**
+ * Stops the age timer of an adjacency list node and frees it.
+ *
+ * @param node - edge being freed
+ */
+void freeAdjListNode(struct AdjListNode *node);
+
+/**
+ * Finds the edge from one node to another.
+ *
+ * @param graph  - graph being searched
+ * @param source - index of source node
+ * @param dest   - index of destination node
+ *
+ * @return - pointer to edge structure, NULL if no such edge exists
+ */
+struct AdjListNode *findEdge(struct Graph *graph, int source, int dest);
 
 /**
  * Adds or updates an edge in a graph structure.
@@ -68,12 +108,14 @@ struct AdjListNode *newAdjListNode(int dest, int cost, int seqN);
  * @param cost   - cost of traversing edge
  * @param seqN   - sequence number of link-state packet
  *
- * @return - 0 if successful, -1 if an error occurred
+ * @return - 1 if added or updated, 0 if the existing edge is as new or newer, -1 if an error occurred
  */
-int addEdge(struct Graph *graph, char source, char dest, int cost, int seqN);
+int addEdge(struct Graph *graph, uint16_t source, uint16_t dest, int cost, int32_t seqN);
 
 /**
  * Updates an existing edge if a newer sequence number is received.
+ * The sequence number is compared against the edge leaving the source. In an undirected
+ * graph the reverse edge takes the cost too, unless the destination has advertised it.
  *
  * @param graph  - graph being updated
  * @param source - index of source node
@@ -81,29 +123,83 @@ int addEdge(struct Graph *graph, char source, char dest, int cost, int seqN);
  * @param cost   - new cost of edge
  * @param seqN   - sequence number of received link-state packet
  *
- * @return - 1 if not updated, 0 if updated
+ * @return - 1 if updated, 0 if the existing edge is as new or newer, -1 if no such edge exists
+ */
+int updateEdge(struct Graph *graph, int source, int dest, int cost, int32_t seqN);
+
+/**
+ * Removes an edge from a graph structure.
+ *
+ * @param graph  - graph being modified
+ * @param source - index of source node
+ * @param dest   - index of destination node
+ *
+ * @return - 1 if removed, 0 if no such edge exists
+ */
+int removeEdge(struct Graph *graph, int source, int dest);
+
+/**
+ * Withdraws an existing edge if a newer sequence number is received.
+ * The edge is kept with a cost of LS_WITHDRAW_COST until its routers are removed.
+ *
+ * @param graph  - graph being updated
+ * @param source - node label of source
+ * @param dest   - node label of destination
+ * @param seqN   - sequence number of received link-state packet
+ *
+ * @return - 1 if withdrawn, 0 if not withdrawn
+ */
+int withdrawEdge(struct Graph *graph, uint16_t source, uint16_t dest, int32_t seqN);
+
+/**
+ * Removes every router other than the root that no link record leads from or to, once
+ * the records of its links, withdrawn ones included, have aged out. Their indices are
+ * recycled by getIndex.
+ *
+ * @param graph - graph being pruned
+ * @param root  - label of local router
+ *
+ * @return - number of routers removed
+ */
+int removeUnreachable(struct Graph *graph, uint16_t root);
+
+/**
+ * Finds the index of a router label without assigning one.
+ *
+ * @param graph - graph being searched
+ * @param label - label being searched for
+ *
+ * @return - index of label, -1 if not found
  */
-int updateEdge(struct Graph *graph, int source, int dest, int cost, int seqN);
+int findIndex(struct Graph *graph, uint16_t label);
 
 /**
  * Finds the index of a router label.
- * Assigns a label to an index if not found and room is availible.
+ * Assigns a label to a free index if not found and room is availible.
  *
- * @param key   - array of router labels
- * @param size  - size of array
+ * @param graph - graph being searched
  * @param label - label being searched for
  *
  * @return - index of label, -1 if not found and unable to assign index
  */
-int getIndex(char *key, int size, char label);
+int getIndex(struct Graph *graph, uint16_t label);
+
+/**
+ * Frees the index of a router so it can be assigned to another label.
+ * The router must have no edges left.
+ *
+ * @param graph - graph being modified
+ * @param index - index being freed
+ */
+void releaseIndex(struct Graph *graph, int index);
 
 /**
- * Processes a link state packet and adds/modifies the graph accordingly
+ * Processes a link state packet and adds/modifies/removes the edge accordingly
  *
  * @param graph - graph structure of router network
  * @param lsPacket - link-state packet received
  *
- * @return - 0 if successful, -1 if an error occurred
+ * @return - 1 if the packet was newer and applied, 0 if it was discarded, -1 if an error occurred
  */
 int addEdgeFromPacket(struct Graph *graph, char *lsPacket);
 
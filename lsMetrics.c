@@ -0,0 +1,307 @@
+/**
+ * This file implements a registry of metrics served over a UNIX domain socket.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "lsMetrics.h"
+
+struct MetricInfo
+{
+	const char *name;
+	const char *help;
+};
+
+const struct MetricInfo counterInfo[METRIC_COUNTERS] = {
+	{ "ls_datagrams_received_total", "Datagrams received from neighbors." },
+	{ "ls_datagrams_dropped_total", "Datagrams dropped as invalid or not from a neighbor." },
+	{ "ls_datagrams_sent_total", "Datagrams sent to neighbors." },
+	{ "ls_packets_received_total", "Link-state packets received in update datagrams." },
+	{ "ls_packets_refused_total", "Link-state packets refused by a full received queue." },
+	{ "ls_packets_accepted_total", "Link-state packets newer than the graph and applied to it." },
+	{ "ls_packets_rejected_total", "Link-state packets no newer than the graph and discarded." },
+	{ "ls_packets_flooded_total", "Link-state packets queued for a neighbor when flooded." },
+	{ "ls_retransmissions_total", "Link-state packets sent again to a neighbor that did not acknowledge them." },
+	{ "ls_spf_runs_total", "Shortest path calculations." },
+	{ "ls_churn_changes_total", "Changes the churn engine made to the local router's links." },
+};
+
+const struct MetricInfo gaugeInfo[METRIC_GAUGES] = {
+	{ "ls_recv_queue_depth", "Entries in the shard's received queue." },
+	{ "ls_send_queue_depth", "Entries in the shard's send queue." },
+};
+
+const struct MetricInfo histogramInfo[METRIC_HISTOGRAMS] = {
+	{ "ls_spf_duration_microseconds", "Time taken to calculate the shortest paths and print the forwarding table." },
+	{ "ls_recv_queue_wait_microseconds", "Time entries waited in the received queue." },
+	{ "ls_send_queue_wait_microseconds", "Time entries waited in the send queue." },
+};
+
+struct MetricRegistry metrics = { .lock = PTHREAD_MUTEX_INITIALIZER, .fd = -1, .seriesCount = 1 };
+
+// Shard of the calling thread, NULL if it did not register
+__thread struct MetricShard *metricShard;
+
+int registerMetricThread()
+{
+	struct MetricShard *shard;
+
+	if (metricShard)
+		return 0;
+
+	if (posix_memalign((void **) &shard, METRIC_CACHE_LINE, sizeof(struct MetricShard)))
+		return -1;
+
+	memset(shard, 0, sizeof(struct MetricShard));
+
+	pthread_mutex_lock(&metrics.lock);
+
+	if (metrics.shardCount == METRIC_MAX_THREADS)
+	{
+		pthread_mutex_unlock(&metrics.lock);
+		free(shard);
+		return -1;
+	}
+
+	// The shard is published before the count that makes readers look at it
+	metrics.shards[metrics.shardCount] = shard;
+	__atomic_store_n(&metrics.shardCount, metrics.shardCount + 1, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&metrics.lock);
+
+	metricShard = shard;
+
+	return 0;
+}
+
+void countMetric(int counter, long long amount)
+{
+	long long *value;
+
+	if (!metricShard)
+		return;
+
+	// The thread is the only writer, a plain add stored whole is enough
+	value = &metricShard->counters[counter];
+	__atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+int setGaugeSeries(int count)
+{
+	if (count < 1 || count > METRIC_MAX_SERIES)
+		return -1;
+
+	__atomic_store_n(&metrics.seriesCount, count, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+void setGauge(int gauge, int series, long long value)
+{
+	__atomic_store_n(&metrics.gauges[gauge][series].value, value, __ATOMIC_RELAXED);
+}
+
+void observeMetric(int histogram, long long value)
+{
+	long long *bucket, *sum;
+
+	if (!metricShard)
+		return;
+
+	if (value < 0)
+		value = 0;
+
+	bucket = &metricShard->buckets[histogram][getBucket(value)];
+	sum = &metricShard->sums[histogram];
+
+	__atomic_store_n(bucket, __atomic_load_n(bucket, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(sum, __atomic_load_n(sum, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+int getBucket(long long value)
+{
+	int exponent;
+
+	// Values below two powers of the sub-buckets each have their own bucket
+	if (value < 2 * METRIC_SUB_BUCKETS)
+		return value;
+
+	if (value >= 1LL << METRIC_VALUE_BITS)
+		return METRIC_BUCKETS - 1;
+
+	exponent = 63 - __builtin_clzll(value);
+
+	// The bits below the highest set bit pick one of the buckets of its power of two
+	return (exponent - METRIC_SUB_BITS) * METRIC_SUB_BUCKETS + (value >> (exponent - METRIC_SUB_BITS));
+}
+
+long long getBucketBound(int bucket)
+{
+	int exponent, mantissa;
+
+	if (bucket < 2 * METRIC_SUB_BUCKETS)
+		return bucket;
+
+	exponent = bucket / METRIC_SUB_BUCKETS + METRIC_SUB_BITS - 1;
+	mantissa = bucket % METRIC_SUB_BUCKETS + METRIC_SUB_BUCKETS;
+
+	return ((long long) (mantissa + 1) << (exponent - METRIC_SUB_BITS)) - 1;
+}
+
+void writeMetrics(FILE *fp)
+{
+	int i, j, k, shardCount, seriesCount;
+	long long value, count, sum;
+	long long buckets[METRIC_BUCKETS];
+	struct MetricShard *shard;
+
+	shardCount = __atomic_load_n(&metrics.shardCount, __ATOMIC_ACQUIRE);
+	seriesCount = __atomic_load_n(&metrics.seriesCount, __ATOMIC_RELAXED);
+
+	for (i = 0; i < METRIC_COUNTERS; i++)
+	{
+		value = 0;
+		for (j = 0; j < shardCount; j++)
+			value += __atomic_load_n(&metrics.shards[j]->counters[i], __ATOMIC_RELAXED);
+
+		fprintf(fp, "# HELP %s %s\n# TYPE %s counter\n%s %lld\n", counterInfo[i].name, counterInfo[i].help,
+		        counterInfo[i].name, counterInfo[i].name, value);
+	}
+
+	for (i = 0; i < METRIC_GAUGES; i++)
+	{
+		fprintf(fp, "# HELP %s %s\n# TYPE %s gauge\n", gaugeInfo[i].name, gaugeInfo[i].help, gaugeInfo[i].name);
+
+		for (j = 0; j < seriesCount; j++)
+		{
+			value = __atomic_load_n(&metrics.gauges[i][j].value, __ATOMIC_RELAXED);
+			fprintf(fp, "%s{shard=\"%d\"} %lld\n", gaugeInfo[i].name, j, value);
+		}
+	}
+
+	for (i = 0; i < METRIC_HISTOGRAMS; i++)
+	{
+		memset(buckets, 0, sizeof(buckets));
+		sum = 0;
+
+		for (j = 0; j < shardCount; j++)
+		{
+			shard = metrics.shards[j];
+			for (k = 0; k < METRIC_BUCKETS; k++)
+				buckets[k] += __atomic_load_n(&shard->buckets[i][k], __ATOMIC_RELAXED);
+			sum += __atomic_load_n(&shard->sums[i], __ATOMIC_RELAXED);
+		}
+
+		fprintf(fp, "# HELP %s %s\n# TYPE %s histogram\n", histogramInfo[i].name, histogramInfo[i].help, histogramInfo[i].name);
+
+		// Buckets are cumulative, only those that add to the count are written
+		count = 0;
+		for (j = 0; j < METRIC_BUCKETS; j++)
+		{
+			if (!buckets[j])
+				continue;
+
+			count += buckets[j];
+			fprintf(fp, "%s_bucket{le=\"%lld\"} %lld\n", histogramInfo[i].name, getBucketBound(j), count);
+		}
+
+		fprintf(fp, "%s_bucket{le=\"+Inf\"} %lld\n%s_sum %lld\n%s_count %lld\n", histogramInfo[i].name, count,
+		        histogramInfo[i].name, sum, histogramInfo[i].name, count);
+	}
+}
+
+int startMetricsServer(const char *path)
+{
+	int err;
+	pthread_t metrics_thread;
+	struct sockaddr_un addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		fprintf(stderr, "Metrics socket path is too long: %s\n", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	if ((metrics.fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+	{
+		perror("Error");
+		return -1;
+	}
+
+	unlink(path);
+
+	if (bind(metrics.fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(metrics.fd, 8) < 0)
+	{
+		perror("Error");
+		close(metrics.fd);
+		return -1;
+	}
+
+	if ((err = pthread_create(&metrics_thread, NULL, &metricsThread, NULL)))
+	{
+		fprintf(stderr, "Can't create Metrics Thread: [%s]\n", strerror(err));
+		close(metrics.fd);
+		return -1;
+	}
+
+	return 0;
+}
+
+void *metricsThread(void *param)
+{
+	int client, length, sent, result;
+	char request[1024];
+	char *snapshot;
+	size_t size;
+	FILE *fp;
+	struct timeval timeout;
+
+	timeout.tv_sec = 0;
+	timeout.tv_usec = METRIC_REQUEST_TIMEOUT * 1000;
+
+	while (1)
+	{
+		if ((client = accept(metrics.fd, NULL, NULL)) < 0)
+			continue;
+
+		// A client that only reads is answered once the timeout passes without a request
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		length = recv(client, request, sizeof(request) - 1, 0);
+
+		snapshot = NULL;
+		size = 0;
+
+		if (!(fp = open_memstream(&snapshot, &size)))
+		{
+			close(client);
+			continue;
+		}
+
+		if (length > 3 && !strncmp(request, "GET ", 4))
+			fprintf(fp, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n");
+		writeMetrics(fp);
+		fclose(fp);
+
+		// A client that hangs up early must not kill the router with SIGPIPE
+		for (sent = 0; sent < (int) size; sent += result)
+			if ((result = send(client, snapshot + sent, size - sent, MSG_NOSIGNAL)) <= 0)
+				break;
+
+		free(snapshot);
+		close(client);
+	}
+
+	return NULL;
+}
@@ -0,0 +1,200 @@
+/**
+ * This file describes a registry of metrics kept by a router: counters, gauges and
+ * latency histograms, served in the Prometheus text format over a UNIX domain socket.
+ *
+ * Each thread that records metrics registers once and is given its own shard of
+ * counters and histograms, aligned to a cache line, so recording takes no lock and no
+ * atomic read-modify-write and threads never share a cache line. A shard has a single
+ * writer and is read without locks when a snapshot is taken, the shards being summed,
+ * so a snapshot may miss updates made while it is taken. Metrics recorded by a thread
+ * that did not register are ignored, so programs that do not serve metrics need not
+ * register at all.
+ *
+ * Histograms bucket values logarithmically, with METRIC_SUB_BUCKETS buckets per power of
+ * two, so every recorded value is within an eighth of its bucket's bound.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSMETRICS_H
+#define _LSMETRICS_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Datagrams received from neighbors
+#define METRIC_DATAGRAMS_RECEIVED 0
+// Datagrams dropped as invalid or not from a neighbor
+#define METRIC_DATAGRAMS_DROPPED 1
+// Datagrams sent to neighbors
+#define METRIC_DATAGRAMS_SENT 2
+// Link-state packets received in update datagrams
+#define METRIC_PACKETS_RECEIVED 3
+// Link-state packets refused by a full received queue
+#define METRIC_PACKETS_REFUSED 4
+// Link-state packets newer than the graph and applied to it
+#define METRIC_PACKETS_ACCEPTED 5
+// Link-state packets no newer than the graph and discarded
+#define METRIC_PACKETS_REJECTED 6
+// Link-state packets queued for a neighbor when flooded
+#define METRIC_PACKETS_FLOODED 7
+// Link-state packets sent again to a neighbor that did not acknowledge them
+#define METRIC_RETRANSMISSIONS 8
+// Shortest path calculations
+#define METRIC_SPF_RUNS 9
+// Changes the churn engine made to the local router's links
+#define METRIC_CHURN_CHANGES 10
+// Number of counters
+#define METRIC_COUNTERS 11
+
+// Entries in the received queue, a series for each shard
+#define METRIC_RECV_QUEUE_DEPTH 0
+// Entries in the send queue, a series for each shard
+#define METRIC_SEND_QUEUE_DEPTH 1
+// Number of gauges
+#define METRIC_GAUGES 2
+
+// Microseconds taken to calculate the shortest paths and print the forwarding table
+#define METRIC_SPF_DURATION 0
+// Microseconds entries waited in the received queue
+#define METRIC_RECV_QUEUE_WAIT 1
+// Microseconds entries waited in the send queue
+#define METRIC_SEND_QUEUE_WAIT 2
+// Number of histograms
+#define METRIC_HISTOGRAMS 3
+
+// Bits of a value below its highest set bit that pick its bucket
+#define METRIC_SUB_BITS 3
+// Buckets for each power of two
+#define METRIC_SUB_BUCKETS (1 << METRIC_SUB_BITS)
+// Bits of the largest value a histogram holds, larger values are counted in the last bucket
+#define METRIC_VALUE_BITS 40
+// Buckets of a histogram
+#define METRIC_BUCKETS ((METRIC_VALUE_BITS - METRIC_SUB_BITS + 1) * METRIC_SUB_BUCKETS)
+// Most series of a gauge, one for each receive shard of the router
+#define METRIC_MAX_SERIES 64
+// Most threads that can register, the main thread and a network thread for each series
+#define METRIC_MAX_THREADS (METRIC_MAX_SERIES + 1)
+// Bytes in a cache line
+#define METRIC_CACHE_LINE 64
+// Milliseconds the metrics server waits for a request before answering without one
+#define METRIC_REQUEST_TIMEOUT 100
+
+struct MetricShard
+{
+	long long counters[METRIC_COUNTERS];
+	long long buckets[METRIC_HISTOGRAMS][METRIC_BUCKETS];
+	long long sums[METRIC_HISTOGRAMS];
+} __attribute__((aligned(METRIC_CACHE_LINE)));
+
+struct MetricGauge
+{
+	long long value;
+} __attribute__((aligned(METRIC_CACHE_LINE)));
+
+struct MetricRegistry
+{
+	// Shards of the registered threads, published by shardCount
+	struct MetricShard *shards[METRIC_MAX_THREADS];
+	int shardCount;
+	// Gauges kept for each series, written with the series as their shard label
+	struct MetricGauge gauges[METRIC_GAUGES][METRIC_MAX_SERIES];
+	int seriesCount;
+	// Taken only to register a thread
+	pthread_mutex_t lock;
+	// Socket the metrics server listens on
+	int fd;
+};
+
+/**
+ * Registers the calling thread, giving it a shard for the metrics it records. At most
+ * METRIC_MAX_THREADS threads can register.
+ *
+ * @return - 0 if success, -1 if error
+ */
+int registerMetricThread();
+
+/**
+ * Sets the number of series of every gauge, which is 1 until set.
+ *
+ * @param count - number of series, at most METRIC_MAX_SERIES
+ *
+ * @return - 0 if success, -1 if too many series
+ */
+int setGaugeSeries(int count);
+
+/**
+ * Adds to a counter of the calling thread.
+ *
+ * @param counter - counter (METRIC_*)
+ * @param amount  - amount added
+ */
+void countMetric(int counter, long long amount);
+
+/**
+ * Sets a series of a gauge. A gauge may be set by any thread.
+ *
+ * @param gauge  - gauge (METRIC_*)
+ * @param series - series of the gauge, such as the shard whose queue it measures
+ * @param value  - new value
+ */
+void setGauge(int gauge, int series, long long value);
+
+/**
+ * Records a value in a histogram of the calling thread.
+ *
+ * @param histogram - histogram (METRIC_*)
+ * @param value     - value recorded, negative values are recorded as 0
+ */
+void observeMetric(int histogram, long long value);
+
+/**
+ * Gets the histogram bucket a value is counted in.
+ *
+ * @param value - non-negative value
+ *
+ * @return - index of bucket
+ */
+int getBucket(long long value);
+
+/**
+ * Gets the largest value counted in a histogram bucket.
+ *
+ * @param bucket - index of bucket
+ *
+ * @return - upper bound of bucket
+ */
+long long getBucketBound(int bucket);
+
+/**
+ * Writes a snapshot of every metric in the Prometheus text format.
+ *
+ * @param fp - stream written to
+ */
+void writeMetrics(FILE *fp);
+
+/**
+ * Creates the UNIX domain socket of the metrics server and starts its thread. A file
+ * left at the path by an earlier server is replaced.
+ *
+ * @param path - path of socket
+ *
+ * @return - 0 if success, -1 if error
+ */
+int startMetricsServer(const char *path);
+
+/**
+ * Thread function answering every connection to the metrics server with a snapshot.
+ * A client that sends an HTTP GET request is answered with an HTTP response, any other
+ * client with the snapshot alone.
+ *
+ * @param param - unused
+ */
+void *metricsThread(void *param);
+
+#endif // _LSMETRICS_H
@@ -7,6 +7,7 @@
  * @info Project 3
  */
 
+#include "lsFlood.h"
 #include "lsNetwork.h"
 
 struct NeighborList *newNeighborList()
@@ -18,11 +19,12 @@ struct NeighborList *newNeighborList()
 
 	list->size = 0;
 	list->head = NULL;
+	list->segments = NULL;
 
 	return list;
 }
 
-struct Neighbor *newNeighbor(char label, const char *address, int port, int cost)
+struct Neighbor *newNeighbor(uint16_t label, const char *address, int port, int cost)
 {
 	struct Neighbor *node = (struct Neighbor *) malloc(sizeof(struct Neighbor));
 
@@ -33,6 +35,37 @@ struct Neighbor *newNeighbor(char label, const char *address, int port, int cost
 	strcpy(node->address, address);
 	node->port = port;
 	node->cost = cost;
+	node->state = NEIGHBOR_DOWN;
+	node->rxmtList = NULL;
+	node->requestList = NULL;
+	node->description = NULL;
+	node->descriptionTail = NULL;
+	node->descTime = 0;
+	node->ackCount = 0;
+	node->ackTime = 0;
+	node->srtt = 0;
+	node->rttvar = 0;
+	node->rto = LS_INITIAL_RTO;
+	node->transmitTime = LLONG_MAX;
+	node->tokens = 0;
+	node->tokenTime = 0;
+	node->batchCount = 0;
+	node->batchTime = 0;
+	initTimer(&node->transmitTimer, NULL, node);
+	initTimer(&node->helloTimer, NULL, node);
+	initTimer(&node->deadTimer, NULL, node);
+	initSummaryList(&node->peerDescription);
+	initSummaryList(&node->peerRequests);
+	node->datagramsSent = 0;
+	node->hellosSent = 0;
+	node->datagramsReceived = 0;
+	node->started = 0;
+	node->described = 0;
+	node->shard = 0;
+	node->local = 0;
+	node->sendRing = NULL;
+	node->segment = NULL;
+	node->next = NULL;
 
 	return node;
 }
@@ -44,67 +77,331 @@ void addToList(struct NeighborList *list, struct Neighbor *node)
 	list->size++;
 }
 
-struct FifoQueue *newFifoQueue()
+struct Neighbor *findNeighbor(struct NeighborList *list, uint16_t label)
+{
+	struct Neighbor *neighbor = list->head;
+
+	while (neighbor && neighbor->label != label)
+		neighbor = neighbor->next;
+
+	return neighbor;
+}
+
+struct Segment *addSegment(struct NeighborList *list, const char *group, int port)
 {
+	struct Segment *segment;
+
+	for (segment = list->segments; segment; segment = segment->next)
+		if (!strcmp(segment->group, group) && segment->port == port)
+			return segment;
+
+	if (!(segment = (struct Segment *) malloc(sizeof(struct Segment))))
+	{
+		printf("Malloc failed.\n");
+		return NULL;
+	}
+
+	strcpy(segment->group, group);
+	segment->port = port;
+	segment->fd = -1;
+	segment->count = 0;
+	segment->flooding = 0;
+	segment->urgent = 0;
+	segment->datagramsSent = 0;
+	segment->next = list->segments;
+	list->segments = segment;
+
+	return segment;
+}
+
+int joinSegment(struct Segment *segment, int local)
+{
+	int fd, reuse = 1;
+	struct sockaddr_in address;
+	struct ip_mreq membership;
+
+	if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+	{
+		perror("Cannot create socket");
+		return -1;
+	}
+
+	// Every router of the segment on this host binds the group's port
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(segment->port);
+	if (!inet_aton(segment->group, &address.sin_addr) || !IN_MULTICAST(ntohl(address.sin_addr.s_addr)))
+	{
+		fprintf(stderr, "Invalid multicast group %s\n", segment->group);
+		close(fd);
+		return -1;
+	}
+
+	memset(&membership, 0, sizeof(membership));
+	membership.imr_multiaddr = address.sin_addr;
+	membership.imr_interface.s_addr = htonl(local ? INADDR_LOOPBACK : INADDR_ANY);
+
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int)) < 0 ||
+	    bind(fd, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+	    setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0 ||
+	    (local && setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &membership.imr_interface, sizeof(struct in_addr)) < 0))
+	{
+		fprintf(stderr, "Cannot join group %s: %s\n", segment->group, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	segment->fd = fd;
+
+	return 0;
+}
+
+struct FifoQueue *newFifoQueue(int capacity, int reserve)
+{
+	int i;
+	unsigned int buckets;
 	struct FifoQueue *queue = (struct FifoQueue *) malloc(sizeof(struct FifoQueue));
 
 	if (!queue)
 		return NULL;
 
+	// Twice as many buckets as entries, rounded up to a power of two
+	for (buckets = 1; buckets < 2 * (unsigned int) (capacity + reserve); buckets <<= 1)
+		;
+
+	queue->nodes = (struct QueueNode *) malloc((capacity + reserve) * sizeof(struct QueueNode));
+	queue->index = (struct QueueNode **) calloc(buckets, sizeof(struct QueueNode *));
+
+	if (!queue->nodes || !queue->index)
+	{
+		free(queue->nodes);
+		free(queue->index);
+		free(queue);
+		return NULL;
+	}
+
+	queue->freeList = NULL;
+	for (i = capacity + reserve - 1; i >= 0; i--)
+	{
+		queue->nodes[i].next = queue->freeList;
+		queue->freeList = &queue->nodes[i];
+	}
+
 	queue->size = 0;
-	queue->head = NULL;
-	queue->tail = NULL;
+	queue->capacity = capacity;
+	for (i = 0; i < LS_PRIORITIES; i++)
+	{
+		queue->heads[i] = NULL;
+		queue->tails[i] = NULL;
+	}
+	queue->indexMask = buckets - 1;
+	queue->merged = 0;
+	queue->refused = 0;
+	queue->timed = 0;
+	queue->poppedTime = 0;
+	queue->poppedPriority = PRIORITY_BULK;
 
 	return queue;
 }
 
-struct QueueNode *newQueueNode(const char *packet)
+int push(struct FifoQueue *queue, int type, uint16_t peer, const char *packet, int priority)
 {
-	struct QueueNode *node = (struct QueueNode *) malloc(sizeof(struct QueueNode));
+	int mergeable;
+	unsigned long long key, opposite;
+	struct QueueNode *node, **bucket;
 
-	if (!node)
-		return NULL;
+	mergeable = getQueueKey(type, peer, packet, &key);
+	node = mergeable ? findQueued(queue, key) : NULL;
+
+	// A neighbor going down and coming up again is seen as both events in order, so the
+	// earlier of two same events is dropped and the later one queued behind the other event
+	if (node && (type == QUEUE_NEIGHBOR_UP || type == QUEUE_NEIGHBOR_DOWN))
+	{
+		getQueueKey(type == QUEUE_NEIGHBOR_UP ? QUEUE_NEIGHBOR_DOWN : QUEUE_NEIGHBOR_UP, peer, packet, &opposite);
+		if (findQueued(queue, opposite))
+		{
+			queue->merged++;
+			releaseQueued(queue, node);
+			node = NULL;
+		}
+	}
+
+	if (node)
+	{
+		queue->merged++;
+
+		// Only the newest packet for a link matters, an older one or a copy is dropped and
+		// the entry keeps the sender it was flooded from
+		if (type == QUEUE_UPDATE &&
+		    compareSequence(getSequenceNumber((char *) packet), getSequenceNumber(node->packet)) <= 0)
+			return 0;
+
+		// A newer packet is flooded as sent by its own sender, the sender of the replaced
+		// one only had that older packet and is sent the newer one
+		node->type = type;
+		node->peer = peer;
+		memcpy(node->packet, packet, LS_PACKET_SIZE);
+
+		// An urgent change no longer waits behind the bulk entries
+		if (priority > node->priority)
+		{
+			unlinkQueued(queue, node);
+			node->priority = priority;
+			linkQueued(queue, node);
+		}
+
+		return 0;
+	}
+
+	// Neighbor events are merged per neighbor, so the reserve always has room for them
+	if (!queue->freeList || (queue->size >= queue->capacity && (!mergeable || type == QUEUE_UPDATE)))
+	{
+		queue->refused++;
+		return -1;
+	}
+
+	node = queue->freeList;
+	queue->freeList = node->next;
 
+	node->type = type;
+	node->peer = peer;
+	node->priority = priority;
 	memcpy(node->packet, packet, LS_PACKET_SIZE);
+	node->queuedTime = queue->timed ? currentTime() : 0;
+	node->indexNext = NULL;
+	node->indexLink = NULL;
+
+	if (mergeable)
+	{
+		bucket = &queue->index[key & queue->indexMask];
+		node->indexNext = *bucket;
+		node->indexLink = bucket;
+		if (*bucket)
+			(*bucket)->indexLink = &node->indexNext;
+		*bucket = node;
+	}
+
+	linkQueued(queue, node);
+	queue->size++;
+
+	return 1;
+}
+
+void linkQueued(struct FifoQueue *queue, struct QueueNode *node)
+{
+	node->prev = queue->tails[node->priority];
 	node->next = NULL;
 
-	return node;
+	if (node->prev)
+		node->prev->next = node;
+	else
+		queue->heads[node->priority] = node;
+
+	queue->tails[node->priority] = node;
 }
 
-void push(struct FifoQueue *queue, const char *packet)
+void unlinkQueued(struct FifoQueue *queue, struct QueueNode *node)
 {
-	struct QueueNode *node = newQueueNode(packet);
+	if (node->prev)
+		node->prev->next = node->next;
+	else
+		queue->heads[node->priority] = node->next;
 
-	if (isEmptyQueue(queue))
+	if (node->next)
+		node->next->prev = node->prev;
+	else
+		queue->tails[node->priority] = node->prev;
+}
+
+int getQueueKey(int type, uint16_t peer, const char *packet, unsigned long long *key)
+{
+	unsigned long long id;
+
+	switch (type)
 	{
-		queue->head = node;
-		queue->tail = node;
+		case QUEUE_UPDATE:
+			id = (unsigned long long) getSourceID((char *) packet) << 16 | getDestinationID((char *) packet);
+			break;
+		case QUEUE_NEIGHBOR_UP:
+			id = 1ULL << 32 | peer;
+			break;
+		case QUEUE_NEIGHBOR_DOWN:
+			id = 5ULL << 32 | peer;
+			break;
+		case QUEUE_PEER_DESCRIPTION:
+			id = 2ULL << 32 | peer;
+			break;
+		case QUEUE_PEER_REQUESTS:
+			id = 3ULL << 32 | peer;
+			break;
+		case QUEUE_COST_CHANGE:
+			id = 4ULL << 32 | peer;
+			break;
+		default:
+			return 0;
 	}
-	else
+
+	// Multiplicative hash spreading the IDs over the high bits
+	*key = id * 0x9E3779B97F4A7C15ULL;
+	*key ^= *key >> 32;
+
+	return 1;
+}
+
+struct QueueNode *findQueued(struct FifoQueue *queue, unsigned long long key)
+{
+	unsigned long long nodeKey;
+	struct QueueNode *node = queue->index[key & queue->indexMask];
+
+	while (node)
 	{
-		queue->tail->next = node;
-		queue->tail = node;
+		if (getQueueKey(node->type, node->peer, node->packet, &nodeKey) && nodeKey == key)
+			return node;
+		node = node->indexNext;
 	}
 
-	queue->size++;
+	return NULL;
 }
 
-void pop(struct FifoQueue *queue, char *buffer)
+int pop(struct FifoQueue *queue, char *buffer, uint16_t *peer)
 {
 	if (isEmptyQueue(queue))
-		return;
+		return 0;
 
-	struct QueueNode *node = queue->head;
+	int type, priority;
+	struct QueueNode *node;
 
-	queue->head = node->next;
-	queue->size--;
+	for (priority = LS_PRIORITIES - 1; !queue->heads[priority]; priority--)
+		;
 
-	if (isEmptyQueue(queue))
-		queue->tail = NULL;
+	node = queue->heads[priority];
 
 	memcpy(buffer, node->packet, LS_PACKET_SIZE);
+	*peer = node->peer;
+	type = node->type;
+	queue->poppedTime = node->queuedTime;
+	queue->poppedPriority = priority;
+
+	releaseQueued(queue, node);
 
-	free(node);
+	return type;
+}
+
+void releaseQueued(struct FifoQueue *queue, struct QueueNode *node)
+{
+	unlinkQueued(queue, node);
+	queue->size--;
+
+	// Later entries are no longer merged into this one
+	if (node->indexLink)
+	{
+		*node->indexLink = node->indexNext;
+		if (node->indexNext)
+			node->indexNext->indexLink = node->indexLink;
+	}
+
+	node->next = queue->freeList;
+	queue->freeList = node;
 }
 
 int isEmptyQueue(struct FifoQueue *queue)
@@ -113,6 +410,41 @@ int isEmptyQueue(struct FifoQueue *queue)
 }
 
 int initializeSocket(int localPort)
+{
+	return openSocket(localPort, 0);
+}
+
+int tuneSocketBuffers(int fd)
+{
+	int size = LS_SOCKET_BUFFER;
+
+	// The forced sizes need CAP_NET_ADMIN, without it the sizes are capped by the system
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(int)) < 0 &&
+	    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(int)) < 0)
+		return -1;
+
+	if (setsockopt(fd, SOL_SOCKET, SO_SNDBUFFORCE, &size, sizeof(int)) < 0 &&
+	    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(int)) < 0)
+		return -1;
+
+	return 0;
+}
+
+int getReceiveCapacity(int fd)
+{
+	int size;
+	socklen_t length = sizeof(int);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, &length) < 0)
+	{
+		perror("Get Socket Options Failed");
+		return -1;
+	}
+
+	return size / LS_DATAGRAM_TRUESIZE;
+}
+
+int openSocket(int localPort, int reusePort)
 {
 	int fd;
 
@@ -122,6 +454,13 @@ int initializeSocket(int localPort)
 		return -1;
 	}
 
+	if ((reusePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(int)) < 0) || tuneSocketBuffers(fd) < 0)
+	{
+		perror("Set Socket Options Failed");
+		close(fd);
+		return -1;
+	}
+
 	struct sockaddr_in myaddr;
 	
 	memset((char *) &myaddr, 0, sizeof(myaddr));
@@ -137,7 +476,7 @@ int initializeSocket(int localPort)
 
 	struct timeval tv;
 	tv.tv_sec = 0;
-	tv.tv_usec = 100000;
+	tv.tv_usec = LS_TICK;
 
 	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (struct timeval *) &tv, sizeof(struct timeval)) < 0) {
 		perror("Set Socket Options Failed");
@@ -147,16 +486,73 @@ int initializeSocket(int localPort)
 	return fd;
 }
 
-int sendPacket(int fd, const char *packet, const char *destHost, int destPort)
+int initializeShards(int localPort, int *fds, int count)
+{
+	int i;
+
+	if (count == 1)
+		return (fds[0] = initializeSocket(localPort)) < 0 ? -1 : 0;
+
+	for (i = 0; i < count; i++)
+	{
+		if ((fds[i] = openSocket(localPort, 1)) < 0)
+		{
+			while (--i >= 0)
+				close(fds[i]);
+			return -1;
+		}
+	}
+
+	// The group is complete before any datagram is steered by its index
+	if (steerShards(fds[0], count) < 0)
+	{
+		for (i = 0; i < count; i++)
+			close(fds[i]);
+		return -1;
+	}
+
+	return 0;
+}
+
+int steerShards(int fd, int count)
+{
+	// Classic BPF run on the UDP payload: the sender ID in the datagram header modulo the
+	// number of shards, as getShard. A datagram too short to hold one goes to the first.
+	struct sock_filter code[] =
+	{
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 2),
+		BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, count),
+		BPF_STMT(BPF_RET | BPF_A, 0)
+	};
+	struct sock_fprog program = { sizeof(code) / sizeof(code[0]), code };
+
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0)
+	{
+		perror("Cannot steer datagrams to shards");
+		return -1;
+	}
+
+	return 0;
+}
+
+int getShard(uint16_t sender, int count)
+{
+	return sender % count;
+}
+
+int sendPacket(int fd, const char *datagram, int length, const char *destHost, int destPort)
 {
 	struct sockaddr_in destaddr;
 
+	if (threadRing && threadRing->socket == fd)
+		return sendUring(threadRing, datagram, length, destHost, destPort);
+
 	memset((char *)&destaddr, 0, sizeof(destaddr));
 	destaddr.sin_family = AF_INET;
 	inet_aton(destHost, &destaddr.sin_addr);
 	destaddr.sin_port = htons(destPort);
 
-	if (sendto(fd, packet, LS_PACKET_SIZE, 0, (struct sockaddr *)&destaddr, sizeof(destaddr)) < 0) {
+	if (sendto(fd, datagram, length, 0, (struct sockaddr *)&destaddr, sizeof(destaddr)) < 0) {
 		perror("Sendto failed");
 		return -1;
 	}
@@ -164,26 +560,13 @@ int sendPacket(int fd, const char *packet, const char *destHost, int destPort)
 	return 0;
 }
 
-int floodPacket(int fd, const char *packet, struct NeighborList *neighbors)
+long long currentTime()
 {
-	char *address;
-	int port;
-	struct Neighbor *neighbor;
-
-	neighbor = neighbors->head;
+	struct timespec ts;
 
-	while (neighbor)
-	{
-		address = neighbor->address;
-		port = neighbor->port;
-
-		if (sendPacket(fd, packet, address, port) < 0)
-			return -1;
-
-		neighbor = neighbor->next;
-	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
-	return 0;
+	return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
 int getAddress(char *buffer, const char *hostname)
@@ -211,15 +594,16 @@ int processTextFile(const char *filename, struct NeighborList *neighbors)
 		return -1;
 	}
 
-	char label;
+	uint16_t label;
 	char *address;
 	char ip[INET_ADDRSTRLEN];
 	int port, cost;
 
 	int i;
 	char line[128];
-	char *tokens[4];
-	char *token;
+	char *tokens[5];
+	char *token, *group;
+	struct Neighbor *neighbor;
 
 	while (fgets(line, 128, fp) != NULL)
 	{
@@ -227,42 +611,46 @@ int processTextFile(const char *filename, struct NeighborList *neighbors)
 		token = strtok(line, DELIM);
 		tokens[i++] = token;
 
-		while (token && i < 4)
+		while (token && i < 5)
 		{
 			token = strtok(NULL, DELIM);
 			tokens[i++] = token;
 		}
 
-		if (i < 4)
+		if (i < 4 || !tokens[3])
+			continue;
+
+		if (!(label = parseRouterID(tokens[0])))
+		{
+			fprintf(stderr, "Invalid router label %s in %s\n", tokens[0], filename);
 			continue;
+		}
 
-		label = tokens[0][0];
 		address = tokens[1];
 		port = atoi(tokens[2]);
 		cost = atoi(tokens[3]);
 
 		getAddress(ip, address);
 
-		addToList(neighbors, newNeighbor(label, ip, port, cost));
+		if (!(neighbor = newNeighbor(label, ip, port, cost)))
+		{
+			printf("Malloc failed.\n");
+			fclose(fp);
+			return -1;
+		}
+
+		// The neighbor shares the segment of the group named after it, if any
+		if (i == 5 && tokens[4] && (group = strtok(tokens[4], ":\r\n")) && (token = strtok(NULL, ":\r\n")) &&
+		    !(neighbor->segment = addSegment(neighbors, group, atoi(token))))
+		{
+			fclose(fp);
+			return -1;
+		}
+
+		addToList(neighbors, neighbor);
 	}
 
 	fclose(fp);
 
 	return 0;
-}
-
-void queueNeighbors(struct NeighborList *neighbors, struct FifoQueue *queue, char label)
-{
-	struct Neighbor *neighbor;
-	char packet[LS_PACKET_SIZE];
-
-	neighbor = neighbors->head;
-
-	while (neighbor)
-	{
-		buildLSPacket(packet, 6, 0, label, neighbor->label, neighbor->cost);
-		push(queue, packet);
-
-		neighbor = neighbor->next;
-	}
 }
\ No newline at end of file
@@ -11,47 +11,222 @@
 #define _LSNETWORK_H
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <linux/filter.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "lsDijkstra.h"
 #include "lsGraph.h"
 #include "lsPacket.h"
+#include "lsShm.h"
+#include "lsTimer.h"
+#include "lsUring.h"
 
 #define DELIM ","
 
+// Most receive shards a router's datagrams are spread over
+#define LS_MAX_SHARDS 64
+
+// Most datagrams taken from the socket of a segment in a pass of the network thread
+#define LS_SEGMENT_BATCH 256
+
+// Bytes asked for the send and receive buffers of a router's sockets
+#define LS_SOCKET_BUFFER (4 * 1024 * 1024)
+// Bytes of receive buffer a full datagram takes, with the kernel's overhead
+#define LS_DATAGRAM_TRUESIZE 2304
+
+// Microseconds the network thread waits for a datagram before servicing its timers,
+// also the length of a tick of its timer wheel
+#define LS_TICK 1000
+
+// Entries the received queue holds before it refuses link-state packets, which are then
+// left unacknowledged so that the neighbors retransmit them
+#define LS_RECV_CAPACITY 16384
+// Entries the send queue holds before the main thread waits for the network thread
+#define LS_SEND_CAPACITY 16384
+
+// Link-state packet received from the peer, or to be flooded to every neighbor except the peer
+#define QUEUE_UPDATE 1
+// Link-state packet to be sent only to the peer
+#define QUEUE_REPLY 2
+// Datagram of the description of our database built for the peer, the packet holding a
+// pointer to it that the network thread takes over
+#define QUEUE_DESCRIPTION 3
+// Last datagram of the description of our database, after which it is sent to the peer
+#define QUEUE_DESCRIPTION_END 4
+// Summary of a link-state packet to be requested from the peer
+#define QUEUE_REQUEST 5
+// The peer has come up and needs to be sent a description of our database
+#define QUEUE_NEIGHBOR_UP 6
+// Nothing has been heard from the peer for the dead interval
+#define QUEUE_NEIGHBOR_DOWN 7
+// The peer's database description has been received and is held in its neighbor entry
+#define QUEUE_PEER_DESCRIPTION 8
+// Requests from the peer have been received and are held in its neighbor entry
+#define QUEUE_PEER_REQUESTS 9
+// The cost of our link to the peer is changed to the cost in the packet
+#define QUEUE_COST_CHANGE 10
+
+// Classes of queued entries and flooded packets, urgent ones going ahead of bulk ones. A
+// change to the topology is urgent, refreshes and database exchanges are bulk.
+#define PRIORITY_BULK 0
+#define PRIORITY_URGENT 1
+#define LS_PRIORITIES 2
+
+// No datagram has been received from the neighbor within the dead interval
+#define NEIGHBOR_DOWN 0
+// Databases are being described to each other
+#define NEIGHBOR_EXCHANGE 1
+// The neighbor's database description has been received
+#define NEIGHBOR_FULL 2
+
 struct NeighborList
 {
 	int size;
 	struct Neighbor *head;
-} NeighborList;
+	// Broadcast segments shared with some of the neighbors
+	struct Segment *segments;
+};
+
+// Broadcast segment the router shares with some of its neighbors, which a flooded packet
+// reaches with one datagram sent to the segment's multicast group
+struct Segment
+{
+	char group[INET_ADDRSTRLEN];
+	int port;
+	// Socket bound to the group's port and joined to the group, -1 unless flooding by multicast
+	int fd;
+	// Link-state packets flooded since the last datagram was sent to the group
+	char datagram[LS_DATAGRAM_SIZE];
+	int count;
+	// Set while the packet being flooded is due to the group, and once an urgent packet is
+	// waiting to be sent to it
+	int flooding;
+	int urgent;
+	long long datagramsSent;
+	struct Segment *next;
+};
+
+struct SummaryList
+{
+	char *summaries;
+	int count;
+	int size;
+};
+
+// Datagram of a database description, built by the main thread with room left for the
+// header the network thread writes when it sends it
+struct Description
+{
+	char datagram[LS_DATAGRAM_SIZE];
+	int count;
+	// Set if more datagrams of the description follow
+	int more;
+	struct Description *next;
+};
 
 struct Neighbor
 {
-	char label;
+	uint16_t label;
 	char address[INET_ADDRSTRLEN];
 	int port;
 	int cost;
+	// Reliable flooding state, only used by the network thread
+	int state;
+	struct Retransmission *rxmtList;
+	struct Retransmission *requestList;
+	// Datagrams of the description of our database, in the order they are sent
+	struct Description *description;
+	struct Description *descriptionTail;
+	long long descTime;
+	char acks[LS_DATAGRAM_SIZE];
+	int ackCount;
+	long long ackTime;
+	long long srtt;
+	long long rttvar;
+	long long rto;
+	// Earliest time something is due to be sent to the neighbor, LLONG_MAX if nothing is
+	long long transmitTime;
+	// Tokens in the bucket pacing the datagrams sent to the neighbor, and the time it was
+	// last filled
+	double tokens;
+	long long tokenTime;
+	// Packets flooded to the neighbor since it was last sent to, and the time they are sent
+	// together at the latest
+	int batchCount;
+	long long batchTime;
+	struct Timer transmitTimer;
+	struct Timer helloTimer;
+	struct Timer deadTimer;
+	// Summaries received from the neighbor for the main thread, guarded by the received queue's lock
+	struct SummaryList peerDescription;
+	struct SummaryList peerRequests;
+	// Datagrams exchanged with the neighbor, counted by the network thread
+	long long datagramsSent;
+	long long hellosSent;
+	long long datagramsReceived;
+	// Set once the neighbor has come up, only used by the main thread
+	int started;
+	// Set once the neighbor's whole database description was compared with the records
+	// restored from the checkpoint, only used by the main thread
+	int described;
+	// Receive shard the neighbor's datagrams are steered to, whose network thread owns
+	// its reliable flooding state
+	int shard;
+	// Set if the neighbor is on the same host and sent to through the ring it reads, which
+	// is NULL until the neighbor has created it
+	int local;
+	struct ShmRing *sendRing;
+	// Segment shared with the neighbor, NULL if linked to it point to point
+	struct Segment *segment;
 	struct Neighbor *next;
-} Neighbor;
+};
 
 struct FifoQueue
 {
 	int size;
-	struct QueueNode *head;
-	struct QueueNode *tail;
-} FifoQueue;
+	int capacity;
+	// Entries of each priority class in the order they were queued
+	struct QueueNode *heads[LS_PRIORITIES];
+	struct QueueNode *tails[LS_PRIORITIES];
+	// Nodes are allocated up front, those not in the queue are kept on the free list
+	struct QueueNode *nodes;
+	struct QueueNode *freeList;
+	// Hash index of the entries a newer entry for the same link or neighbor is merged into
+	struct QueueNode **index;
+	unsigned int indexMask;
+	long long merged;
+	long long refused;
+	// Set to stamp every entry with the time it was queued, which costs a clock read per push
+	int timed;
+	// Time in microseconds the entry popped last was queued, 0 if the queue is not timed
+	long long poppedTime;
+	// Priority class of the entry popped last
+	int poppedPriority;
+};
 
 struct QueueNode
 {
+	int type;
+	uint16_t peer;
+	int priority;
 	char packet[LS_PACKET_SIZE];
+	// Time in microseconds the entry was queued if the queue is timed, kept when newer
+	// entries are merged into it
+	long long queuedTime;
+	struct QueueNode *prev;
 	struct QueueNode *next;
-} QueueNode;
+	struct QueueNode *indexNext;
+	struct QueueNode **indexLink;
+};
 
 /**
  * Initializes a new neighbor list structure.
@@ -70,7 +245,7 @@ struct NeighborList *newNeighborList();
  *
  * @return - pointer to list node
  */
-struct Neighbor *newNeighbor(char label, const char *address, int port, int cost);
+struct Neighbor *newNeighbor(uint16_t label, const char *address, int port, int cost);
 
 /**
  * Adds a neighbor node to a neighbor list.
@@ -81,36 +256,126 @@ struct Neighbor *newNeighbor(char label, const char *address, int port, int cost
 void addToList(struct NeighborList *list, struct Neighbor *node);
 
 /**
- * Initializes a new FIFO queue.
+ * Finds a neighbor in a neighbor list.
+ *
+ * @param list  - neighbor list
+ * @param label - label of neighboring router
+ *
+ * @return - pointer to neighbor, NULL if not a neighbor
+ */
+struct Neighbor *findNeighbor(struct NeighborList *list, uint16_t label);
+
+/**
+ * Finds the segment with a multicast group in a neighbor list, adding it if missing.
+ *
+ * @param list  - neighbor list
+ * @param group - IPv4 multicast address of the segment's group
+ * @param port  - port the group is sent to
+ *
+ * @return - pointer to segment, NULL if error
+ */
+struct Segment *addSegment(struct NeighborList *list, const char *group, int port);
+
+/**
+ * Opens the socket of a segment and joins it to the segment's group, so the datagrams
+ * flooded to the group are received on it and sent from it.
+ *
+ * @param segment - broadcast segment
+ * @param local   - 1 if the segment's routers are on this host, to join the group on the
+ *                  loopback interface, 0 to join it on the interface routed to
+ *
+ * @return - 0 if success, -1 if error
+ */
+int joinSegment(struct Segment *segment, int local);
+
+/**
+ * Initializes a new FIFO queue of bounded size. Only one link-state packet per link and
+ * one event of each kind per neighbor is held at a time, a newer one replaces it in place.
+ * Entries are popped in the order they were pushed, the urgent ones before the bulk ones.
+ *
+ * @param capacity - number of entries held before pushes are refused
+ * @param reserve  - number of additional entries kept for neighbor events
  *
  * @return - pointer to queue
  */
-struct FifoQueue *newFifoQueue();
+struct FifoQueue *newFifoQueue(int capacity, int reserve);
 
 /**
- * Initializes a new queue node.
+ * Pushes a packet into a FIFO queue. A link-state packet for a link that already has a
+ * packet queued replaces it, sender included, if newer and is dropped otherwise. A neighbor
+ * event replaces a queued event of the same kind for the same neighbor, unless the opposite
+ * event (up or down) is queued, then the queued one is dropped and the event queued after
+ * it. Every other push takes a new entry, and is refused if the queue is full. Neighbor
+ * events may use the queue's reserve.
+ * An urgent entry merged into a bulk one moves it to the back of the urgent entries.
  *
- * @param packet - packet being stored in node
+ * @param queue    - FIFO queue
+ * @param type     - type of queued packet (QUEUE_*)
+ * @param peer     - label of neighboring router the packet is from or for
+ * @param packet   - packet being pushed to queue
+ * @param priority - priority class of the entry (PRIORITY_*)
  *
- * @return - pointer to node
+ * @return - 1 if queued, 0 if merged with a queued entry, -1 if refused
  */
-struct QueueNode *newQueueNode(const char *packet);
+int push(struct FifoQueue *queue, int type, uint16_t peer, const char *packet, int priority);
 
 /**
- * Pushes a packet into a FIFO queue
+ * Links an entry at the back of the entries of its priority class.
  *
- * @param queue  - FIFO queue
- * @param packet - packet being pushed to queue
+ * @param queue - FIFO queue
+ * @param node  - entry being linked
+ */
+void linkQueued(struct FifoQueue *queue, struct QueueNode *node);
+
+/**
+ * Unlinks an entry from the entries of its priority class.
+ *
+ * @param queue - FIFO queue
+ * @param node  - entry being unlinked
+ */
+void unlinkQueued(struct FifoQueue *queue, struct QueueNode *node);
+
+/**
+ * Gets the key under which an entry is merged with a queued entry.
+ *
+ * @param type   - type of queued packet (QUEUE_*)
+ * @param peer   - label of neighboring router the packet is from or for
+ * @param packet - queued packet
+ * @param key    - where the key will be stored
+ *
+ * @return - 1 if the entry can be merged, 0 if it always takes its own entry
  */
-void push(struct FifoQueue *queue, const char *packet);
+int getQueueKey(int type, uint16_t peer, const char *packet, unsigned long long *key);
 
 /**
- * Pops a packet from a FIFO queue
+ * Finds the queued entry with a key.
+ *
+ * @param queue - FIFO queue
+ * @param key   - key of entry
+ *
+ * @return - pointer to queued entry, NULL if there is none
+ */
+struct QueueNode *findQueued(struct FifoQueue *queue, unsigned long long key);
+
+/**
+ * Pops a packet from a FIFO queue, the oldest of the highest priority class. The time
+ * the packet was queued and its class are kept in the queue's poppedTime and poppedPriority.
  *
  * @param queue  - FIFO queue
  * @param buffer - buffer where popped packet will be stored
+ * @param peer   - where the label of the neighboring router will be stored
+ *
+ * @return - type of popped packet, 0 if queue was empty
+ */
+int pop(struct FifoQueue *queue, char *buffer, uint16_t *peer);
+
+/**
+ * Removes an entry from a FIFO queue and returns it to the free list.
+ *
+ * @param queue - FIFO queue
+ * @param node  - entry being removed
  */
-void pop(struct FifoQueue *queue, char *buffer);
+void releaseQueued(struct FifoQueue *queue, struct QueueNode *node);
 
 /**
  * Check if FIFO queue is empty
@@ -132,26 +397,88 @@ int isEmptyQueue(struct FifoQueue *queue);
 int initializeSocket(int localPort);
 
 /**
- * Sends a packet to a specified destination.
+ * Enlarges the send and receive buffers of a socket to LS_SOCKET_BUFFER bytes, beyond the
+ * system's limit if the process is allowed to, so that bursts of datagrams are not dropped.
+ *
+ * @param fd - file descriptor of socket
+ *
+ * @return - 0 if success, -1 if error
+ */
+int tuneSocketBuffers(int fd);
+
+/**
+ * Gets the number of full datagrams the receive buffer of a socket holds.
+ *
+ * @param fd - file descriptor of socket
+ *
+ * @return - number of datagrams, -1 if error
+ */
+int getReceiveCapacity(int fd);
+
+/**
+ * Initializes and binds a UDP socket that can share its port with other sockets.
+ *
+ * @param localPort - port number of socket being opened
+ * @param reusePort - 1 to let other sockets bind to the port, 0 otherwise
+ *
+ * @return file descriptor for socket if success, -1 if failure
+ */
+int openSocket(int localPort, int reusePort);
+
+/**
+ * Opens the sockets of the receive shards of a router, all bound to one port. Each
+ * datagram is steered by the kernel to the socket of the shard its sender belongs to.
+ * A single shard has a socket of its own, as from initializeSocket.
+ *
+ * @param localPort - port number of sockets
+ * @param fds       - array where the file descriptors of the sockets will be stored
+ * @param count     - number of shards, at most LS_MAX_SHARDS
+ *
+ * @return - 0 if success, -1 if error
+ */
+int initializeShards(int localPort, int *fds, int count);
+
+/**
+ * Attaches the program to the port's group of sockets that steers each datagram to the
+ * socket of its sender's shard. Sockets are numbered in the order they were bound.
+ *
+ * @param fd    - any socket of the group
+ * @param count - number of sockets in the group
+ *
+ * @return - 0 if success, -1 if error
+ */
+int steerShards(int fd, int count);
+
+/**
+ * Gets the receive shard the datagrams of a sender are steered to.
+ *
+ * @param sender - ID of sending router
+ * @param count  - number of shards
+ *
+ * @return - index of shard
+ */
+int getShard(uint16_t sender, int count);
+
+/**
+ * Sends a datagram to a specified destination. A thread doing its socket work through an
+ * io_uring queues the datagram on it, to be sent when the ring is next submitted.
  *
  * @param fd       - file descriptor of socket being used
- * @param packet   - packet being sent
+ * @param datagram - datagram being sent
+ * @param length   - length of datagram in bytes
  * @param destHost - network address of destination
  * @param destPort - port number of destination
  *
  * @return - 0 if successful, -1 if error occurred
  */
-int sendPacket(int fd, const char *packet, const char *destHost, int destPort);
+int sendPacket(int fd, const char *datagram, int length, const char *destHost, int destPort);
 
 /**
- * Sends a packet to all of the neighboring routers.
- *
- * @param fd        - file descriptor of socket being used
- * @param packet    - packet being sent
- * @param neighbors - list of neighboring routers
+ * Gets the current time from a monotonic clock.
  *
+ * @return - time in microseconds
  */
-int floodPacket(int fd, const char *packet, struct NeighborList *neighbors);
+long long currentTime();
 
 /**
  * Get the IP address of a host in dot format
@@ -164,7 +491,8 @@ int floodPacket(int fd, const char *packet, struct NeighborList *neighbors);
 int getAddress(char *buffer, const char *hostname);
 
 /**
- * Reads a text file to discover the neighboring routers.
+ * Reads a text file to discover the neighboring routers. A line may end with the
+ * multicast group and port of a segment shared with the neighbor, as group:port.
  *
  * @param filename  - filename of discovery text file
  * @param neighbors - neighbor list structure
@@ -173,13 +501,4 @@ int getAddress(char *buffer, const char *hostname);
  */
 int processTextFile(const char *filename, struct NeighborList *neighbors);
 
-/**
- * Queues all of the neighboring router edges.
- *
- * @param neighbors - neighbor list
- * @param queue     - FIFO queue
- * @param label     - label of router
- */
-void queueNeighbors(struct NeighborList *neighbors, struct FifoQueue *queue, char label);
-
 #endif // _LSNETWORK_H
\ No newline at end of file
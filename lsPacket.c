@@ -7,90 +7,242 @@
  * @info Project 3
  */
 
+#include <inttypes.h>
+
 #include "lsPacket.h"
 
-void buildLSPacket(char *buffer, int hopCount, int seqNumber, char source, char destination, int cost)
+void buildLSPacket(char *buffer, int32_t seqNumber, uint16_t source, uint16_t destination, int cost)
 {
-	memset(buffer, hopCount % 256, 1);
-	memset(buffer+1, seqNumber % 256, 1);
-	memset(buffer+2, source, 1);
-	memset(buffer+3, destination, 1);
+	uint16_t nsource = htons(source);
+	memcpy(buffer, &nsource, 2);
 
-	int ncost = htonl(cost);
-	memcpy(buffer+4, &ncost, 4);
-}
+	uint16_t ndest = htons(destination);
+	memcpy(buffer+2, &ndest, 2);
 
-int getHopCount(char *lsPacket)
-{
-	char hopCount;
+	memset(buffer+4, 0, 2);
 
-	memcpy(&hopCount, lsPacket, 1);
+	uint32_t nseq = htonl((uint32_t) seqNumber);
+	memcpy(buffer+6, &nseq, 4);
 
-	return hopCount;
+	int ncost = htonl(cost);
+	memcpy(buffer+10, &ncost, 4);
 }
 
-int getSequenceNumber(char *lsPacket)
+int32_t getSequenceNumber(char *lsPacket)
 {
-	char seqNumber;
+	uint32_t seqNumber;
 
-	memcpy(&seqNumber, lsPacket+1, 1);
+	memcpy(&seqNumber, lsPacket+6, 4);
 
-	return seqNumber;
+	return (int32_t) ntohl(seqNumber);
 }
 
-char getSourceID(char *lsPacket)
+uint16_t getSourceID(char *lsPacket)
 {
-	char source;
+	uint16_t source;
 
-	memcpy(&source, lsPacket+2, 1);
+	memcpy(&source, lsPacket, 2);
 
-	return source;
+	return ntohs(source);
 }
 
-char getDestinationID(char *lsPacket)
+uint16_t getDestinationID(char *lsPacket)
 {
-	char destination;
+	uint16_t destination;
 
-	memcpy(&destination, lsPacket+3, 1);
+	memcpy(&destination, lsPacket+2, 2);
 
-	return destination;
+	return ntohs(destination);
 }
 
 int getCost(char *lsPacket)
 {
 	int cost;
 
-	memcpy(&cost, lsPacket+4, 4);
+	memcpy(&cost, lsPacket+10, 4);
 
 	return ntohl(cost);
 }
 
+int getAge(char *lsPacket)
+{
+	uint16_t age;
+
+	memcpy(&age, lsPacket+4, 2);
+
+	return ntohs(age);
+}
+
+void setAge(char *lsPacket, int age)
+{
+	uint16_t nage = htons(age < LS_MAX_AGE ? age : LS_MAX_AGE);
+
+	memcpy(lsPacket+4, &nage, 2);
+}
+
+int compareSequence(int32_t a, int32_t b)
+{
+	uint32_t diff;
+
+	if (a == b)
+		return 0;
+
+	// Both on the stick, or one on the stick and one on the circle
+	if (a < 0 || b < 0)
+		return a > b ? 1 : -1;
+
+	// Both on the circle, a is newer if it is less than half the circle ahead of b. Two
+	// numbers exactly half the circle apart are each that far ahead of the other, so the
+	// larger is taken as newer and both sides agree.
+	diff = ((uint32_t) a - (uint32_t) b) & INT32_MAX;
+
+	if (diff == 1u << 30)
+		return a > b ? 1 : -1;
+
+	return diff < (1u << 30) ? 1 : -1;
+}
+
+int32_t nextSequence(int32_t seqNumber)
+{
+	return seqNumber == INT32_MAX ? 0 : seqNumber + 1;
+}
+
+int isWithdrawal(char *lsPacket)
+{
+	return getCost(lsPacket) == LS_WITHDRAW_COST;
+}
+
 void printLSPacket(char *lsPacket)
 {
-	int hopCount, seqNumber, cost;
-	char source, destination;
+	int cost;
+	int32_t seqNumber;
+	char source[LS_ID_LENGTH], destination[LS_ID_LENGTH];
 
-	hopCount = getHopCount(lsPacket);
 	seqNumber = getSequenceNumber(lsPacket);
-	source = getSourceID(lsPacket);
-	destination = getDestinationID(lsPacket);
+	formatRouterID(getSourceID(lsPacket), source);
+	formatRouterID(getDestinationID(lsPacket), destination);
 	cost = getCost(lsPacket);
 
-	printf("Hop Count:       %d\n"
-	       "Sequence Number: %d\n"
-	       "Source ID:       %c\n"
-	       "Destination ID:  %c\n"
+	printf("Sequence Number: %" PRId32 "\n"
+	       "Source ID:       %s\n"
+	       "Destination ID:  %s\n"
+	       "Age:             %d\n"
 	       "Cost:            %d\n",
-	       hopCount, seqNumber, source, destination, cost);
+	       seqNumber, source, destination, getAge(lsPacket), cost);
 }
 
-int decrementHopCount(char *lsPacket)
+int isSameLink(char *a, char *b)
 {
-	int hopCount = getHopCount(lsPacket);
+	return getSourceID(a) == getSourceID(b) && getDestinationID(a) == getDestinationID(b);
+}
+
+void buildHeader(char *datagram, int type, uint16_t sender, int count)
+{
+	memset(datagram, type, 1);
+	memset(datagram+1, 0, 1);
 
-	hopCount--;
+	uint16_t nsender = htons(sender);
+	memcpy(datagram+2, &nsender, 2);
+
+	uint16_t ncount = htons(count);
+	memcpy(datagram+4, &ncount, 2);
+}
 
-	memset(lsPacket, hopCount, 1);
+int getType(char *datagram)
+{
+	unsigned char type;
+
+	memcpy(&type, datagram, 1);
+
+	return type;
+}
 
-	return hopCount;
-}
\ No newline at end of file
+int getFlags(char *datagram)
+{
+	unsigned char flags;
+
+	memcpy(&flags, datagram+1, 1);
+
+	return flags;
+}
+
+void setFlags(char *datagram, int flags)
+{
+	memset(datagram+1, flags, 1);
+}
+
+uint16_t getSenderID(char *datagram)
+{
+	uint16_t sender;
+
+	memcpy(&sender, datagram+2, 2);
+
+	return ntohs(sender);
+}
+
+int getCount(char *datagram)
+{
+	uint16_t count;
+
+	memcpy(&count, datagram+4, 2);
+
+	return ntohs(count);
+}
+
+int getEntrySize(int type)
+{
+	switch (type)
+	{
+		case LS_TYPE_UPDATE:
+			return LS_PACKET_SIZE;
+		case LS_TYPE_ACK:
+		case LS_TYPE_DESCRIPTION:
+		case LS_TYPE_REQUEST:
+			return LS_SUMMARY_SIZE;
+		case LS_TYPE_HELLO:
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+int isValidDatagram(char *datagram, int length)
+{
+	int size;
+
+	if (length < LS_HEADER_SIZE)
+		return 0;
+
+	if ((size = getEntrySize(getType(datagram))) < 0)
+		return 0;
+
+	return LS_HEADER_SIZE + getCount(datagram) * size <= length;
+}
+
+uint16_t parseRouterID(const char *text)
+{
+	char *end;
+	unsigned long id;
+
+	// A single letter stands for its own code, other characters are left to the formats
+	// IDs are written in
+	if (text[0] && !text[1] && isalpha((unsigned char) text[0]))
+		return (unsigned char) text[0];
+
+	id = strtoul(text, &end, 10);
+
+	if (end == text || *end || id > LS_MAX_ROUTER_ID)
+		return LS_ROUTER_NONE;
+
+	return id;
+}
+
+char *formatRouterID(uint16_t id, char *buffer)
+{
+	if (id < 128 && isalpha(id))
+		snprintf(buffer, LS_ID_LENGTH, "%c", id);
+	else
+		snprintf(buffer, LS_ID_LENGTH, "%u", id);
+
+	return buffer;
+}
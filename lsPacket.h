@@ -1,7 +1,24 @@
 /**
- * This file describes the functions used for building and modifying link-state packets.
+ * This file describes the functions used for building and modifying link-state packets
+ * and the datagrams that carry them between routers.
  * Link-State Packets have the following format:
- * Hop Count (1B) | Sequence Number (1B) | Source ID (1B) | Destination ID (1B) | Cost (4B)
+ * Source ID (2B) | Destination ID (2B) | Age (2B) | Sequence Number (4B) | Cost (4B)
+ *
+ * The first LS_SUMMARY_SIZE bytes of a packet summarize it and are used to acknowledge it.
+ * Datagrams have a header followed by a number of packets or packet summaries:
+ * Type (1B) | Flags (1B) | Sender ID (2B) | Count (2B)
+ *
+ * Router IDs are numbers from 1 to LS_MAX_ROUTER_ID. In neighbor files, on the command line
+ * and in printed tables an ID is written in decimal, except that the ID of a letter is
+ * written as that letter, so a router labelled 'A' has the ID 65.
+ *
+ * Sequence numbers form a lollipop: a router starts at LS_INITIAL_SEQUENCE and counts up
+ * through the negative numbers (the stick) until it reaches 0, after which it counts around
+ * the non-negative numbers (the circle), wrapping from INT32_MAX back to 0.
+ *
+ * The age of a packet counts the seconds since it was originated. Routers refresh their
+ * own packets well before they grow old, so a packet that reaches LS_MAX_AGE belongs to a
+ * router that is gone and is flushed.
  *
  * @author Jeffrey Bromen
  * @date 4/16/17
@@ -13,35 +30,76 @@
 #define _LSPACKET_H
 
 #include <arpa/inet.h>
+#include <ctype.h>
+#include <limits.h>
 #include <netinet/in.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 // Number of bytes in a link-state packet
-#define LS_PACKET_SIZE 8
+#define LS_PACKET_SIZE 14
+// Number of bytes in a link-state packet summary
+#define LS_SUMMARY_SIZE 10
+// Number of bytes in a datagram header
+#define LS_HEADER_SIZE 6
+// Largest datagram sent, sized to fit an Ethernet MTU without fragmenting
+#define LS_DATAGRAM_SIZE 1472
+// Most link-state packets carried by a single datagram
+#define LS_MAX_PACKETS ((LS_DATAGRAM_SIZE - LS_HEADER_SIZE) / LS_PACKET_SIZE)
+// Most link-state packet summaries carried by a single datagram
+#define LS_MAX_SUMMARIES ((LS_DATAGRAM_SIZE - LS_HEADER_SIZE) / LS_SUMMARY_SIZE)
+
+// ID that belongs to no router
+#define LS_ROUTER_NONE 0
+// Largest router ID
+#define LS_MAX_ROUTER_ID UINT16_MAX
+// Characters needed to write a router ID, including the terminator
+#define LS_ID_LENGTH 6
+
+// Datagram carrying link-state packets
+#define LS_TYPE_UPDATE 1
+// Datagram carrying summaries of the link-state packets being acknowledged
+#define LS_TYPE_ACK 2
+// Datagram carrying summaries of the link-state packets in the sender's database
+#define LS_TYPE_DESCRIPTION 3
+// Datagram carrying summaries of the link-state packets the sender wants to be sent
+#define LS_TYPE_REQUEST 4
+// Datagram without entries sent periodically to show the sender is alive
+#define LS_TYPE_HELLO 5
+
+// Flag set on every datagram of a database description except the last
+#define LS_FLAG_MORE 0x01
+// Flag set on a database description whose sender has not received the receiver's description
+#define LS_FLAG_NEED 0x02
+// Flag set on an update whose packets change the topology, which the receiver takes first
+#define LS_FLAG_URGENT 0x04
+// Sequence number that is older than every sequence number used in a packet
+#define LS_SEQUENCE_NONE INT32_MIN
+// First sequence number used by a router after it starts
+#define LS_INITIAL_SEQUENCE (INT32_MIN + 1)
+// Cost advertised in a link-state packet to withdraw the link from the network
+#define LS_WITHDRAW_COST INT_MAX
+// Age in seconds at which a link-state packet is flushed from the database
+#define LS_MAX_AGE 3600
+// Seconds between refreshes of the packets a router originates
+#define LS_REFRESH_INTERVAL 1800
+// Seconds added to the age of a link-state packet each time it is flooded
+#define LS_TRANSIT_AGE 1
 
 /**
  * Builds a link-state packet with the given parameters and stores it in a buffer.
+ * The packet starts with an age of 0.
  *
  * @param buffer      - buffer where the link-state packet will be stored
- * @param hopCount    - number of hops for which the packet will be forwarded (0-255)
  * @param seqNumber   - sequence number of the link-state packet
- *                      used to differentiate from older instances of packets (0-255)
- * @param source      - ID of the source router (single character)
- * @param destination - ID of the destination router (single character)
+ *                      used to differentiate from older instances of packets
+ * @param source      - ID of the source router
+ * @param destination - ID of the destination router
  * @param cost        - cost to travel from the source router to destination router
  */
-void buildLSPacket(char *buffer, int hopCount, int seqNumber, char source, char destination, int cost);
-
-/**
- * Gets the hop count of a link-state packet.
- *
- * @param lsPacket - buffer containing the link-state packet
- *
- * @return - the hop count
- */
-int getHopCount(char *lsPacket);
+void buildLSPacket(char *buffer, int32_t seqNumber, uint16_t source, uint16_t destination, int cost);
 
 /**
  * Gets the sequence number of a link-state packet.
@@ -50,7 +108,7 @@ int getHopCount(char *lsPacket);
  *
  * @return - the sequence number
  */
-int getSequenceNumber(char *lsPacket);
+int32_t getSequenceNumber(char *lsPacket);
 
 /**
  * Gets the source ID of a link-state packet.
@@ -59,7 +117,7 @@ int getSequenceNumber(char *lsPacket);
  *
  * @return - the source ID
  */
-char getSourceID(char *lsPacket);
+uint16_t getSourceID(char *lsPacket);
 
 /**
  * Gets the destination ID of a link-state packet.
@@ -68,7 +126,7 @@ char getSourceID(char *lsPacket);
  *
  * @return - the destination ID
  */
-char getDestinationID(char *lsPacket);
+uint16_t getDestinationID(char *lsPacket);
 
 /**
  * Gets the cost of a link-state packet.
@@ -79,6 +137,54 @@ char getDestinationID(char *lsPacket);
  */
 int getCost(char *lsPacket);
 
+/**
+ * Gets the age of a link-state packet.
+ *
+ * @param lsPacket - buffer containing the link-state packet
+ *
+ * @return - the age in seconds
+ */
+int getAge(char *lsPacket);
+
+/**
+ * Sets the age of a link-state packet, capped at LS_MAX_AGE.
+ *
+ * @param lsPacket - buffer containing the link-state packet
+ * @param age      - age in seconds
+ */
+void setAge(char *lsPacket, int age);
+
+/**
+ * Compares two sequence numbers of the same link.
+ * Numbers on the stick compare linearly and are older than every number on the circle.
+ * Numbers on the circle compare by serial number arithmetic, so the counter may wrap, and
+ * of two numbers exactly half the circle apart the larger is newer.
+ *
+ * @param a - first sequence number
+ * @param b - second sequence number
+ *
+ * @return - 1 if a is newer than b, 0 if equal, -1 if a is older than b
+ */
+int compareSequence(int32_t a, int32_t b);
+
+/**
+ * Gets the sequence number that follows a sequence number.
+ *
+ * @param seqNumber - current sequence number
+ *
+ * @return - the next sequence number
+ */
+int32_t nextSequence(int32_t seqNumber);
+
+/**
+ * Checks if a link-state packet withdraws its link instead of advertising a cost.
+ *
+ * @param lsPacket - buffer containing the link-state packet
+ *
+ * @return - 1 if withdrawal, 0 otherwise
+ */
+int isWithdrawal(char *lsPacket);
+
 /**
  * Prints all of the parameters of a link-state packet. Used for debugging.
  *
@@ -87,12 +193,106 @@ int getCost(char *lsPacket);
 void printLSPacket(char *lsPacket);
 
 /**
- * Decrements the hop count of a link-state packet
+ * Checks if two link-state packets or summaries describe the same link.
  *
- * @param lsPacket - buffer containing the link-state packet
+ * @param a - buffer containing the first packet
+ * @param b - buffer containing the second packet
+ *
+ * @return - 1 if same link, 0 otherwise
+ */
+int isSameLink(char *a, char *b);
+
+/**
+ * Builds a datagram header and stores it at the start of a buffer.
+ * The packets or summaries are stored after the header.
+ *
+ * @param datagram - buffer where the header will be stored
+ * @param type     - type of datagram (LS_TYPE_*)
+ * @param sender   - ID of the sending router
+ * @param count    - number of packets or summaries following the header
+ */
+void buildHeader(char *datagram, int type, uint16_t sender, int count);
+
+/**
+ * Gets the type of a datagram.
+ *
+ * @param datagram - buffer containing the datagram
+ *
+ * @return - the type
+ */
+int getType(char *datagram);
+
+/**
+ * Gets the flags of a datagram.
+ *
+ * @param datagram - buffer containing the datagram
+ *
+ * @return - the flags (LS_FLAG_*)
+ */
+int getFlags(char *datagram);
+
+/**
+ * Sets the flags of a datagram.
+ *
+ * @param datagram - buffer containing the datagram
+ * @param flags    - the flags (LS_FLAG_*)
+ */
+void setFlags(char *datagram, int flags);
+
+/**
+ * Gets the sender ID of a datagram.
+ *
+ * @param datagram - buffer containing the datagram
+ *
+ * @return - the sender ID
+ */
+uint16_t getSenderID(char *datagram);
+
+/**
+ * Gets the number of packets or summaries carried by a datagram.
+ *
+ * @param datagram - buffer containing the datagram
+ *
+ * @return - the count
+ */
+int getCount(char *datagram);
+
+/**
+ * Gets the size of the entries carried by a type of datagram.
+ *
+ * @param type - type of datagram
+ *
+ * @return - LS_PACKET_SIZE or LS_SUMMARY_SIZE, 0 if the type carries no entries, -1 if unknown type
+ */
+int getEntrySize(int type);
+
+/**
+ * Checks that a received datagram is of a known type and holds as many entries as it claims.
+ *
+ * @param datagram - buffer containing the datagram
+ * @param length   - number of bytes received
+ *
+ * @return - 1 if valid, 0 if not
+ */
+int isValidDatagram(char *datagram, int length);
+
+/**
+ * Reads a router ID written as a decimal number or as a single letter.
+ *
+ * @param text - the written ID
+ *
+ * @return - the router ID, LS_ROUTER_NONE if the text is not a valid ID
+ */
+uint16_t parseRouterID(const char *text);
+
+/**
+ * Writes a router ID the way parseRouterID reads it.
+ *
+ * @param id     - router ID
+ * @param buffer - buffer of at least LS_ID_LENGTH characters where the ID will be written
  *
- * @return - the new hop count after decrementing
+ * @return - the buffer
  */
-int decrementHopCount(char *lsPacket);
+char *formatRouterID(uint16_t id, char *buffer);
 
 #endif // _LS_PACKET_H
\ No newline at end of file
@@ -0,0 +1,54 @@
+/**
+ * This file implements a pool of objects of one size kept on a free list.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include "lsPool.h"
+
+void *takeObject(struct Pool *pool)
+{
+	void *object;
+
+	if (!pool->freeList && growPool(pool) < 0)
+		return NULL;
+
+	object = pool->freeList;
+	pool->freeList = *(void **) object;
+	pool->taken++;
+
+	return object;
+}
+
+void giveObject(struct Pool *pool, void *object)
+{
+	*(void **) object = pool->freeList;
+	pool->freeList = object;
+	pool->taken--;
+}
+
+int growPool(struct Pool *pool)
+{
+	int i;
+	size_t stride;
+	char *chunk;
+
+	// Objects are spaced so the pointer each holds while free is aligned
+	stride = (pool->size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+
+	if (!(chunk = (char *) malloc(pool->chunk * stride)))
+		return -1;
+
+	for (i = pool->chunk - 1; i >= 0; i--)
+	{
+		*(void **) (chunk + i * stride) = pool->freeList;
+		pool->freeList = chunk + i * stride;
+	}
+
+	pool->objects += pool->chunk;
+
+	return 0;
+}
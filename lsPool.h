@@ -0,0 +1,59 @@
+/**
+ * This file describes a pool of objects of one size kept on a free list, so that objects
+ * taken and given back as often as the entries of the retransmission lists are not
+ * allocated each time. A pool that runs out grows by a chunk of objects and never
+ * shrinks. A pool is used by one thread.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSPOOL_H
+#define _LSPOOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Static initializer of an empty pool of objects of a type, growing by chunk objects
+#define POOL_INITIALIZER(type, chunk) { sizeof(type), (chunk), NULL, 0, 0 }
+
+struct Pool
+{
+	size_t size;
+	int chunk;
+	// Objects not taken, each holding the pointer to the next
+	void *freeList;
+	// Objects allocated, and those taken
+	long long objects;
+	long long taken;
+};
+
+/**
+ * Takes an object from a pool, growing the pool if it has none left.
+ *
+ * @param pool - pool of objects
+ *
+ * @return - pointer to object, NULL if error
+ */
+void *takeObject(struct Pool *pool);
+
+/**
+ * Gives an object back to the pool it was taken from.
+ *
+ * @param pool   - pool of objects
+ * @param object - object taken from the pool
+ */
+void giveObject(struct Pool *pool, void *object);
+
+/**
+ * Allocates a chunk of objects and adds them to the free list of a pool.
+ *
+ * @param pool - pool of objects
+ *
+ * @return - 0 if success, -1 if error
+ */
+int growPool(struct Pool *pool);
+
+#endif // _LSPOOL_H
@@ -0,0 +1,210 @@
+/**
+ * This file implements the shared memory rings routers on the same host send datagrams
+ * to each other through.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lsShm.h"
+
+struct ShmRing *createShmRing(int port, uint16_t writer, long long now)
+{
+	int fd;
+	char name[SHM_NAME_LENGTH];
+	struct ShmRing *ring;
+	struct ShmHeader *header;
+
+	snprintf(name, SHM_NAME_LENGTH, "/ls-%d-%u", port, writer);
+
+	// A writer still mapping the ring of an earlier run finds it stale and opens this one
+	shm_unlink(name);
+	if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0)
+	{
+		perror("Cannot create shared ring");
+		return NULL;
+	}
+
+	if (ftruncate(fd, sizeof(struct ShmHeader) + SHM_SLOTS * sizeof(struct ShmSlot)) < 0)
+	{
+		perror("Cannot size shared ring");
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+
+	if (!(ring = mapShmRing(fd, name, 1)))
+	{
+		shm_unlink(name);
+		return NULL;
+	}
+
+	header = ring->header;
+	header->slots = SHM_SLOTS;
+	header->writer = writer;
+	header->head = 0;
+	header->stamp = now;
+	header->sleeping = 0;
+	header->tail = 0;
+	// A writer only uses a ring whose header is complete
+	__atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+	return ring;
+}
+
+struct ShmRing *openShmRing(int port, uint16_t writer)
+{
+	int fd;
+	char name[SHM_NAME_LENGTH];
+	struct ShmRing *ring;
+
+	snprintf(name, SHM_NAME_LENGTH, "/ls-%d-%u", port, writer);
+
+	// The neighbor has not created the ring yet, or does not share memory
+	if ((fd = shm_open(name, O_RDWR, 0)) < 0)
+		return NULL;
+
+	if (!(ring = mapShmRing(fd, name, 0)))
+		return NULL;
+
+	if (__atomic_load_n(&ring->header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+	    ring->header->slots != SHM_SLOTS || ring->header->writer != writer)
+	{
+		closeShmRing(ring);
+		return NULL;
+	}
+
+	ring->index = __atomic_load_n(&ring->header->tail, __ATOMIC_RELAXED);
+	ring->other = __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE);
+
+	return ring;
+}
+
+struct ShmRing *mapShmRing(int fd, const char *name, int reader)
+{
+	void *map;
+	struct stat st;
+	struct ShmRing *ring;
+
+	if (fstat(fd, &st) < 0 || st.st_size < sizeof(struct ShmHeader) + SHM_SLOTS * sizeof(struct ShmSlot) ||
+	    (map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	close(fd);
+
+	if (!(ring = (struct ShmRing *) malloc(sizeof(struct ShmRing))))
+	{
+		printf("Malloc failed.\n");
+		munmap(map, st.st_size);
+		return NULL;
+	}
+
+	ring->header = (struct ShmHeader *) map;
+	ring->slots = (struct ShmSlot *) (ring->header + 1);
+	ring->length = st.st_size;
+	ring->index = 0;
+	ring->other = 0;
+	ring->reader = reader;
+	strcpy(ring->name, name);
+
+	return ring;
+}
+
+int writeShmRing(struct ShmRing *ring, const char *datagram, int length, long long now)
+{
+	struct ShmSlot *slot;
+	struct ShmHeader *header = ring->header;
+
+	if (now - __atomic_load_n(&header->stamp, __ATOMIC_RELAXED) > SHM_STALE)
+		return SHM_STALE_READER;
+
+	if (ring->index - ring->other >= SHM_SLOTS &&
+	    ring->index - (ring->other = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE)) >= SHM_SLOTS)
+		return SHM_FULL;
+
+	slot = &ring->slots[ring->index & (SHM_SLOTS - 1)];
+	slot->length = length;
+	memcpy(slot->datagram, datagram, length);
+
+	// The datagram is complete before the reader can see it
+	__atomic_store_n(&header->tail, ++ring->index, __ATOMIC_RELEASE);
+
+	// Ordered after the tail, so a reader marking the ring sleeping either sees the
+	// datagram or is seen here and woken
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&header->sleeping, __ATOMIC_RELAXED) && __atomic_exchange_n(&header->sleeping, 0, __ATOMIC_RELAXED))
+		return SHM_WAKE;
+
+	return SHM_WRITTEN;
+}
+
+int readShmRing(struct ShmRing *ring, char *datagram, long long now)
+{
+	int length;
+	struct ShmSlot *slot;
+	struct ShmHeader *header = ring->header;
+
+	__atomic_store_n(&header->stamp, now, __ATOMIC_RELAXED);
+
+	if (ring->index == ring->other && ring->index == (ring->other = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE)))
+		return 0;
+
+	slot = &ring->slots[ring->index & (SHM_SLOTS - 1)];
+	length = slot->length;
+	if (length < 0 || length > LS_DATAGRAM_SIZE)
+		length = 0;
+	memcpy(datagram, slot->datagram, length);
+
+	// The slot is copied before the writer can reuse it
+	__atomic_store_n(&header->head, ++ring->index, __ATOMIC_RELEASE);
+
+	return length;
+}
+
+int sleepShmRing(struct ShmRing *ring)
+{
+	struct ShmHeader *header = ring->header;
+
+	__atomic_store_n(&header->sleeping, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&header->tail, __ATOMIC_RELAXED) != ring->index)
+	{
+		__atomic_store_n(&header->sleeping, 0, __ATOMIC_RELAXED);
+		return 0;
+	}
+
+	return 1;
+}
+
+void wakeShmRing(struct ShmRing *ring)
+{
+	__atomic_store_n(&ring->header->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+void closeShmRing(struct ShmRing *ring)
+{
+	if (!ring)
+		return;
+
+	munmap(ring->header, ring->length);
+	if (ring->reader)
+		shm_unlink(ring->name);
+	free(ring);
+}
+
+int isLocalAddress(const char *address)
+{
+	return !strncmp(address, "127.", 4);
+}
@@ -0,0 +1,176 @@
+/**
+ * This file describes the shared memory rings routers on the same host send datagrams
+ * to each other through instead of the loopback interface.
+ *
+ * A ring carries the datagrams of one router to one neighbor. The neighbor reading it
+ * creates it as a shared memory object named after its port and the writing router, and
+ * the writer maps the object once it finds it, so a router only uses a ring its neighbor
+ * has made and reads. Each side owns one index of the ring and publishes it with a release
+ * store, so a datagram takes no lock and no system call.
+ *
+ * The reader stamps the ring with the time each time it looks for datagrams. A writer
+ * finding the stamp older than SHM_STALE takes the reader to be gone and sends through its
+ * socket again, as it does while the ring is full. A reader about to wait on its socket
+ * marks the ring as sleeping, and the writer that finds the mark sends a hello through
+ * the socket to wake it, so a ring is only rung once per wait.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSSHM_H
+#define _LSSHM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lsPacket.h"
+
+// First bytes of a ring
+#define SHM_MAGIC 0x4D48534C
+// Datagrams a ring holds, a power of two
+#define SHM_SLOTS 256
+// Microseconds without a stamp from the reader before the writer stops using the ring
+#define SHM_STALE 100000
+// Bytes in a cache line, which the indices of the two sides are kept apart by
+#define SHM_CACHE_LINE 64
+// Characters in the name of a ring, including the terminator
+#define SHM_NAME_LENGTH 32
+
+// Results of writing a datagram to a ring
+#define SHM_WRITTEN 0
+#define SHM_WAKE 1
+#define SHM_FULL -1
+#define SHM_STALE_READER -2
+
+struct ShmSlot
+{
+	int32_t length;
+	char datagram[LS_DATAGRAM_SIZE];
+};
+
+struct ShmHeader
+{
+	uint32_t magic;
+	uint32_t slots;
+	// Router writing to the ring
+	uint16_t writer;
+	// Datagrams taken by the reader and the time it last looked for more, in microseconds
+	// of the monotonic clock every process on the host shares
+	uint32_t head __attribute__((aligned(SHM_CACHE_LINE)));
+	int64_t stamp;
+	// Set by the reader while it waits on its socket, cleared by the writer waking it
+	int32_t sleeping;
+	// Datagrams written by the writer
+	uint32_t tail __attribute__((aligned(SHM_CACHE_LINE)));
+};
+
+struct ShmRing
+{
+	struct ShmHeader *header;
+	struct ShmSlot *slots;
+	size_t length;
+	// Index owned by this side, the head of a reader or the tail of a writer
+	uint32_t index;
+	// Last index of the other side seen, loaded again only when the ring looks empty or full
+	uint32_t other;
+	// Set for the reader, which unlinks the ring when it is closed
+	int reader;
+	char name[SHM_NAME_LENGTH];
+};
+
+/**
+ * Creates the ring a router reads the datagrams of a neighbor from, replacing any ring
+ * left by an earlier run.
+ *
+ * @param port   - port the reading router is bound to
+ * @param writer - ID of the neighbor writing to the ring
+ * @param now    - current time in microseconds
+ *
+ * @return - pointer to ring, NULL if error
+ */
+struct ShmRing *createShmRing(int port, uint16_t writer, long long now);
+
+/**
+ * Opens the ring a neighbor created to read a router's datagrams from.
+ *
+ * @param port   - port the neighbor is bound to
+ * @param writer - ID of the router writing to the ring
+ *
+ * @return - pointer to ring, NULL if the neighbor has not created one
+ */
+struct ShmRing *openShmRing(int port, uint16_t writer);
+
+/**
+ * Maps a ring from its shared memory object.
+ *
+ * @param fd     - file descriptor of the object, closed once mapped
+ * @param name   - name of the object
+ * @param reader - 1 if mapped by the reader, 0 if by the writer
+ *
+ * @return - pointer to ring, NULL if error
+ */
+struct ShmRing *mapShmRing(int fd, const char *name, int reader);
+
+/**
+ * Writes a datagram to a ring, unless it is full or its reader has gone quiet.
+ *
+ * @param ring     - ring written to
+ * @param datagram - datagram being sent
+ * @param length   - length of datagram in bytes
+ * @param now      - current time in microseconds
+ *
+ * @return - SHM_WRITTEN, SHM_WAKE if written and the reader has to be woken, SHM_FULL or
+ *           SHM_STALE_READER if not written
+ */
+int writeShmRing(struct ShmRing *ring, const char *datagram, int length, long long now);
+
+/**
+ * Takes the next datagram from a ring and stamps it with the time.
+ *
+ * @param ring     - ring read from
+ * @param datagram - buffer of LS_DATAGRAM_SIZE bytes where the datagram will be stored
+ * @param now      - current time in microseconds
+ *
+ * @return - length of datagram, 0 if the ring is empty
+ */
+int readShmRing(struct ShmRing *ring, char *datagram, long long now);
+
+/**
+ * Marks a ring as sleeping before its reader waits on its socket.
+ *
+ * @param ring - ring read from
+ *
+ * @return - 1 if marked, 0 if a datagram arrived and the reader should not wait
+ */
+int sleepShmRing(struct ShmRing *ring);
+
+/**
+ * Clears the sleeping mark of a ring once its reader is done waiting.
+ *
+ * @param ring - ring read from
+ */
+void wakeShmRing(struct ShmRing *ring);
+
+/**
+ * Unmaps a ring, and removes it if it is closed by its reader.
+ *
+ * @param ring - ring being closed
+ */
+void closeShmRing(struct ShmRing *ring);
+
+/**
+ * Checks if an address belongs to the local host, so a neighbor there can be sent to
+ * through a ring.
+ *
+ * @param address - IPv4 address in dot format
+ *
+ * @return - 1 if on the loopback network, 0 otherwise
+ */
+int isLocalAddress(const char *address);
+
+#endif // _LSSHM_H
@@ -0,0 +1,158 @@
+/**
+ * This file implements the functions used for a hierarchical timer wheel.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include "lsTimer.h"
+
+struct TimerWheel *newTimerWheel(long long tickLength, long long now)
+{
+	int i, j;
+	struct TimerWheel *wheel = (struct TimerWheel *) malloc(sizeof(struct TimerWheel));
+
+	if (!wheel)
+		return NULL;
+
+	for (i = 0; i < LS_WHEEL_LEVELS; i++)
+		for (j = 0; j < LS_WHEEL_SLOTS; j++)
+			wheel->slots[i][j] = NULL;
+
+	wheel->tick = 0;
+	wheel->tickLength = tickLength;
+	wheel->start = now;
+
+	return wheel;
+}
+
+void initTimer(struct Timer *timer, void (*callback)(void *arg), void *arg)
+{
+	timer->expires = 0;
+	timer->callback = callback;
+	timer->arg = arg;
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+void addTimer(struct TimerWheel *wheel, struct Timer *timer, long long delay)
+{
+	long long ticks = (delay + wheel->tickLength - 1) / wheel->tickLength;
+
+	removeTimer(timer);
+
+	// A timer always expires on a later tick than the current one
+	if (ticks < 1)
+		ticks = 1;
+	else if (ticks > LS_WHEEL_RANGE)
+		ticks = LS_WHEEL_RANGE;
+
+	timer->expires = wheel->tick + ticks;
+	insertTimer(wheel, timer);
+}
+
+void scheduleTimer(struct TimerWheel *wheel, struct Timer *timer, long long time)
+{
+	long long delay = time - (wheel->start + wheel->tick * wheel->tickLength);
+
+	if (isTimerPending(timer) && (timer->expires - wheel->tick) * wheel->tickLength <= delay)
+		return;
+
+	addTimer(wheel, timer, delay);
+}
+
+void removeTimer(struct Timer *timer)
+{
+	if (!timer->pprev)
+		return;
+
+	*timer->pprev = timer->next;
+	if (timer->next)
+		timer->next->pprev = timer->pprev;
+
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+int isTimerPending(struct Timer *timer)
+{
+	return timer->pprev != NULL;
+}
+
+void insertTimer(struct TimerWheel *wheel, struct Timer *timer)
+{
+	int level;
+	long long delta = timer->expires - wheel->tick;
+	struct Timer **slot;
+
+	// Pick the finest wheel whose range covers the delay
+	for (level = 0; level < LS_WHEEL_LEVELS - 1; level++)
+		if (delta < (1LL << ((level + 1) * LS_WHEEL_BITS)))
+			break;
+
+	slot = &wheel->slots[level][(timer->expires >> (level * LS_WHEEL_BITS)) & (LS_WHEEL_SLOTS - 1)];
+
+	timer->next = *slot;
+	timer->pprev = slot;
+	if (*slot)
+		(*slot)->pprev = &timer->next;
+	*slot = timer;
+}
+
+void cascadeTimers(struct TimerWheel *wheel, int level, int slot)
+{
+	struct Timer *timer, *next;
+
+	timer = wheel->slots[level][slot];
+	wheel->slots[level][slot] = NULL;
+
+	while (timer)
+	{
+		next = timer->next;
+		insertTimer(wheel, timer);
+		timer = next;
+	}
+}
+
+int advanceWheel(struct TimerWheel *wheel, long long now)
+{
+	int level, slot, expired;
+	long long target;
+	struct Timer *list, *timer;
+
+	expired = 0;
+	target = (now - wheel->start) / wheel->tickLength;
+
+	while (wheel->tick < target)
+	{
+		wheel->tick++;
+
+		// When a wheel wraps around, the next slot of the coarser wheel comes into range
+		for (level = 1; level < LS_WHEEL_LEVELS; level++)
+		{
+			if (wheel->tick & ((1LL << (level * LS_WHEEL_BITS)) - 1))
+				break;
+
+			cascadeTimers(wheel, level, (wheel->tick >> (level * LS_WHEEL_BITS)) & (LS_WHEEL_SLOTS - 1));
+		}
+
+		slot = wheel->tick & (LS_WHEEL_SLOTS - 1);
+
+		// Move the expiring timers to a local list so callbacks can remove any of them
+		list = wheel->slots[0][slot];
+		wheel->slots[0][slot] = NULL;
+		if (list)
+			list->pprev = &list;
+
+		while ((timer = list))
+		{
+			removeTimer(timer);
+			timer->callback(timer->arg);
+			expired++;
+		}
+	}
+
+	return expired;
+}
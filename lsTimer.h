@@ -0,0 +1,127 @@
+/**
+ * This file describes the functions used for a hierarchical timer wheel.
+ * Timers are kept in slots of several wheels of increasing granularity. Adding and
+ * removing a timer takes constant time, and each tick only visits the timers that
+ * expire on it, plus the timers cascading down from a coarser wheel.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSTIMER_H
+#define _LSTIMER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Number of wheels
+#define LS_WHEEL_LEVELS 4
+// Number of bits of the tick used to index the slots of each wheel
+#define LS_WHEEL_BITS 6
+// Number of slots in each wheel
+#define LS_WHEEL_SLOTS (1 << LS_WHEEL_BITS)
+// Longest delay in ticks that can be held, longer delays are shortened to this
+#define LS_WHEEL_RANGE ((1LL << (LS_WHEEL_LEVELS * LS_WHEEL_BITS)) - 1)
+
+struct Timer
+{
+	long long expires;
+	void (*callback)(void *arg);
+	void *arg;
+	struct Timer *next;
+	struct Timer **pprev;
+};
+
+struct TimerWheel
+{
+	long long tick;
+	long long tickLength;
+	long long start;
+	struct Timer *slots[LS_WHEEL_LEVELS][LS_WHEEL_SLOTS];
+};
+
+/**
+ * Allocates memory for a new timer wheel.
+ *
+ * @param tickLength - length of a tick in microseconds
+ * @param now        - current time in microseconds
+ *
+ * @return - pointer to timer wheel
+ */
+struct TimerWheel *newTimerWheel(long long tickLength, long long now);
+
+/**
+ * Initializes a timer that is not on a wheel.
+ *
+ * @param timer    - timer being initialized
+ * @param callback - function called when the timer expires
+ * @param arg      - argument passed to the callback
+ */
+void initTimer(struct Timer *timer, void (*callback)(void *arg), void *arg);
+
+/**
+ * Starts a timer, restarting it if it is already pending.
+ *
+ * @param wheel - timer wheel
+ * @param timer - timer being started
+ * @param delay - microseconds until the timer expires
+ */
+void addTimer(struct TimerWheel *wheel, struct Timer *timer, long long delay);
+
+/**
+ * Starts a timer to expire at a point in time, unless it is already pending to expire
+ * no later than that.
+ *
+ * @param wheel - timer wheel
+ * @param timer - timer being started
+ * @param time  - time in microseconds when the timer expires
+ */
+void scheduleTimer(struct TimerWheel *wheel, struct Timer *timer, long long time);
+
+/**
+ * Stops a pending timer. Does nothing if the timer is not pending.
+ *
+ * @param timer - timer being stopped
+ */
+void removeTimer(struct Timer *timer);
+
+/**
+ * Checks if a timer is pending on a wheel.
+ *
+ * @param timer - timer being checked
+ *
+ * @return - 1 if pending, 0 if not pending
+ */
+int isTimerPending(struct Timer *timer);
+
+/**
+ * Places a timer in the slot of the wheel matching its expiry tick.
+ *
+ * @param wheel - timer wheel
+ * @param timer - timer being placed
+ */
+void insertTimer(struct TimerWheel *wheel, struct Timer *timer);
+
+/**
+ * Moves the timers of a slot of a coarser wheel down to the finer wheels.
+ *
+ * @param wheel - timer wheel
+ * @param level - wheel being cascaded
+ * @param slot  - slot being cascaded
+ */
+void cascadeTimers(struct TimerWheel *wheel, int level, int slot);
+
+/**
+ * Advances the wheel up to the current time, calling the callback of every timer that
+ * expires along the way. Callbacks may add and remove timers.
+ *
+ * @param wheel - timer wheel
+ * @param now   - current time in microseconds
+ *
+ * @return - number of timers that expired
+ */
+int advanceWheel(struct TimerWheel *wheel, long long now);
+
+#endif // _LSTIMER_H
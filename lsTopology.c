@@ -0,0 +1,328 @@
+/**
+ * This file implements the binary topology file and the shortest path calculation over it.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lsTopology.h"
+
+int writeTopologyFile(const char *filename, int count, const uint16_t *source, const uint16_t *dest, const int32_t *cost)
+{
+	int i, j, k, routers, edges, error;
+	uint32_t header[TOPOLOGY_HEADER_SIZE / 4];
+	uint16_t pad;
+	int *index, *slot, *lastSource, *lastSlot;
+	uint16_t *key;
+	uint32_t *offset, *outDest, *start;
+	int32_t *outCost;
+	FILE *fp;
+
+	// Labels are indexed directly, there being no more of them than fit in 16 bits
+	index = (int *) malloc((LS_MAX_ROUTER_ID + 1) * sizeof(int));
+	key = (uint16_t *) malloc((LS_MAX_ROUTER_ID + 1) * sizeof(uint16_t));
+	offset = (uint32_t *) calloc(LS_MAX_ROUTER_ID + 2, sizeof(uint32_t));
+	start = (uint32_t *) malloc((LS_MAX_ROUTER_ID + 1) * sizeof(uint32_t));
+	lastSource = (int *) malloc((LS_MAX_ROUTER_ID + 1) * sizeof(int));
+	lastSlot = (int *) malloc((LS_MAX_ROUTER_ID + 1) * sizeof(int));
+	slot = (int *) malloc((count ? count : 1) * sizeof(int));
+	outDest = (uint32_t *) malloc((count ? count : 1) * sizeof(uint32_t));
+	outCost = (int32_t *) malloc((count ? count : 1) * sizeof(int32_t));
+
+	error = !index || !key || !offset || !start || !lastSource || !lastSlot || !slot || !outDest || !outCost;
+	fp = NULL;
+	edges = -1;
+
+	if (error)
+		goto done;
+
+	for (i = 0; i <= LS_MAX_ROUTER_ID; i++)
+	{
+		index[i] = -1;
+		lastSource[i] = -1;
+	}
+
+	for (i = 0; i < count; i++)
+		index[source[i]] = index[dest[i]] = 0;
+
+	// Indices are assigned in order of label, so the label table comes out sorted
+	routers = 0;
+	for (i = 1; i <= LS_MAX_ROUTER_ID; i++)
+		if (!index[i])
+		{
+			key[routers] = i;
+			index[i] = routers++;
+		}
+
+	// Bucket the edges by source, keeping them in the order they were given
+	for (i = 0; i < count; i++)
+		offset[index[source[i]] + 1]++;
+	for (i = 0; i < routers; i++)
+	{
+		offset[i + 1] += offset[i];
+		start[i] = offset[i];
+	}
+	for (i = 0; i < count; i++)
+		slot[start[index[source[i]]]++] = i;
+
+	// Compact each router's edges, a later edge to the same router replacing an earlier one
+	edges = 0;
+	for (i = 0; i < routers; i++)
+	{
+		j = offset[i];
+		offset[i] = edges;
+
+		for (; j < (int) start[i]; j++)
+		{
+			k = index[dest[slot[j]]];
+
+			if (lastSource[k] == i)
+			{
+				outCost[lastSlot[k]] = cost[slot[j]];
+				continue;
+			}
+
+			lastSource[k] = i;
+			lastSlot[k] = edges;
+			outDest[edges] = k;
+			outCost[edges++] = cost[slot[j]];
+		}
+	}
+	offset[routers] = edges;
+
+	if (!(fp = fopen(filename, "wb")))
+	{
+		perror(filename);
+		edges = -1;
+		goto done;
+	}
+
+	header[0] = TOPOLOGY_MAGIC;
+	header[1] = TOPOLOGY_VERSION;
+	header[2] = routers;
+	header[3] = edges;
+	pad = 0;
+
+	if (fwrite(header, TOPOLOGY_HEADER_SIZE, 1, fp) != 1 ||
+	    fwrite(key, sizeof(uint16_t), routers, fp) != routers ||
+	    (routers % 2 && fwrite(&pad, sizeof(uint16_t), 1, fp) != 1) ||
+	    fwrite(offset, sizeof(uint32_t), routers + 1, fp) != routers + 1 ||
+	    fwrite(outDest, sizeof(uint32_t), edges, fp) != edges ||
+	    fwrite(outCost, sizeof(int32_t), edges, fp) != edges)
+	{
+		perror(filename);
+		edges = -1;
+	}
+
+done:
+	if (fp && fclose(fp) && edges >= 0)
+	{
+		perror(filename);
+		edges = -1;
+	}
+
+	if (error)
+		printf("Malloc failed.\n");
+
+	free(index);
+	free(key);
+	free(offset);
+	free(start);
+	free(lastSource);
+	free(lastSlot);
+	free(slot);
+	free(outDest);
+	free(outCost);
+
+	return edges;
+}
+
+int mapTopologyFile(const char *filename, struct Topology *topology)
+{
+	int fd, i, valid;
+	const uint32_t *header;
+	size_t length;
+	struct stat st;
+
+	if ((fd = open(filename, O_RDONLY)) < 0)
+	{
+		perror(filename);
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0)
+	{
+		perror(filename);
+		close(fd);
+		return -1;
+	}
+
+	if (st.st_size < TOPOLOGY_HEADER_SIZE)
+	{
+		fprintf(stderr, "%s is not a topology file\n", filename);
+		close(fd);
+		return -1;
+	}
+
+	topology->length = st.st_size;
+	topology->map = mmap(NULL, topology->length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (topology->map == MAP_FAILED)
+	{
+		perror(filename);
+		return -1;
+	}
+
+	header = (const uint32_t *) topology->map;
+
+	if (header[0] != TOPOLOGY_MAGIC || header[1] != TOPOLOGY_VERSION)
+	{
+		if (header[0] == __builtin_bswap32(TOPOLOGY_MAGIC))
+			fprintf(stderr, "%s was written on a host of the other byte order\n", filename);
+		else
+			fprintf(stderr, "%s is not a topology file\n", filename);
+		unmapTopology(topology);
+		return -1;
+	}
+
+	topology->routers = header[2];
+	topology->edges = header[3];
+
+	// Computed in size_t so that a corrupt count cannot wrap around
+	length = TOPOLOGY_HEADER_SIZE + ((size_t) header[2] + header[2] % 2) * sizeof(uint16_t) +
+	         ((size_t) header[2] + 1) * sizeof(uint32_t) + (size_t) header[3] * (sizeof(uint32_t) + sizeof(int32_t));
+
+	if (header[2] > LS_MAX_ROUTER_ID || header[3] > INT_MAX || length != topology->length)
+	{
+		fprintf(stderr, "%s is truncated or corrupt\n", filename);
+		unmapTopology(topology);
+		return -1;
+	}
+
+	topology->key = (const uint16_t *) (header + TOPOLOGY_HEADER_SIZE / 4);
+	topology->offset = (const uint32_t *) (topology->key + topology->routers + topology->routers % 2);
+	topology->dest = topology->offset + topology->routers + 1;
+	topology->cost = (const int32_t *) (topology->dest + topology->edges);
+
+	// A bad index would be followed out of the mapping, so the tables are checked once here
+	valid = topology->offset[0] == 0 && topology->offset[topology->routers] == topology->edges;
+
+	for (i = 0; valid && i < topology->routers; i++)
+		valid = topology->key[i] != LS_ROUTER_NONE && (!i || topology->key[i] > topology->key[i - 1]) &&
+		        topology->offset[i] <= topology->offset[i + 1];
+
+	for (i = 0; valid && i < topology->edges; i++)
+		valid = topology->dest[i] < topology->routers && topology->cost[i] > 0;
+
+	if (!valid)
+	{
+		fprintf(stderr, "%s is truncated or corrupt\n", filename);
+		unmapTopology(topology);
+		return -1;
+	}
+
+	return 0;
+}
+
+void unmapTopology(struct Topology *topology)
+{
+	munmap(topology->map, topology->length);
+	topology->map = NULL;
+}
+
+int findTopologyIndex(const struct Topology *topology, uint16_t label)
+{
+	int low, high, mid;
+
+	low = 0;
+	high = topology->routers - 1;
+
+	while (low <= high)
+	{
+		mid = (low + high) / 2;
+
+		if (topology->key[mid] == label)
+			return mid;
+		else if (topology->key[mid] < label)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return -1;
+}
+
+int newTopologySearch(const struct Topology *topology, struct TopologySearch *search)
+{
+	int i;
+
+	if (!(search->heap = newMinHeap(topology->routers)))
+		return -1;
+
+	if (!(search->nodes = (struct HeapNode *) malloc(topology->routers * sizeof(struct HeapNode))))
+	{
+		destroyHeap(search->heap);
+		return -1;
+	}
+
+	for (i = 0; i < topology->routers; i++)
+		search->nodes[i].index = i;
+
+	return 0;
+}
+
+void freeTopologySearch(struct TopologySearch *search)
+{
+	destroyHeap(search->heap);
+	free(search->nodes);
+}
+
+void topologyPaths(const struct Topology *topology, struct TopologySearch *search, int root, int *cost, int *hop)
+{
+	int i, u, v;
+	uint32_t e;
+	struct MinHeap *heap = search->heap;
+
+	heap->size = 0;
+
+	for (i = 0; i < topology->routers; i++)
+	{
+		hop[i] = -1;
+		cost[i] = (i == root) ? 0 : INT_MAX;
+		search->nodes[i].cost = cost[i];
+		insert(heap, &search->nodes[i]);
+	}
+
+	while (!isEmpty(heap))
+	{
+		u = extract(heap)->index;
+
+		// The rest of the routers cannot be reached
+		if (cost[u] == INT_MAX)
+			break;
+
+		if (hop[u] < 0 && cost[u] > 0)
+			hop[u] = u;
+
+		for (e = topology->offset[u]; e < topology->offset[u + 1]; e++)
+		{
+			v = topology->dest[e];
+
+			if (isInHeap(heap, v) && topology->cost[e] < cost[v] - cost[u])
+			{
+				cost[v] = cost[u] + topology->cost[e];
+				hop[v] = hop[u];
+
+				updateHeap(heap, v, cost[v]);
+			}
+		}
+	}
+}
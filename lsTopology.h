@@ -0,0 +1,131 @@
+/**
+ * This file describes the binary topology file a router maps to calculate shortest paths
+ * over a whole network offline, and the shortest path calculation over it.
+ *
+ * The file holds the graph in compressed sparse rows, in the host's byte order, so it is
+ * used straight from the mapping without being read into a graph. The router labels are
+ * sorted, the index of a router being its position in the label table. The edges leaving
+ * a router are stored together, from its offset up to the offset of the next router.
+ *
+ * Header (16 bytes): Magic(4) | Version(4) | Routers(4) | Edges(4)
+ * Labels: Routers * 2 bytes, padded to a multiple of 4 bytes
+ * Offsets: (Routers + 1) * 4 bytes
+ * Destinations: Edges * 4 bytes, each the index of the router the edge leads to
+ * Costs: Edges * 4 bytes
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSTOPOLOGY_H
+#define _LSTOPOLOGY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lsDijkstra.h"
+#include "lsPacket.h"
+
+// First bytes of a topology file, read in the other order if it was written on a host
+// of the other byte order
+#define TOPOLOGY_MAGIC 0x504F544C
+// Version of the file format
+#define TOPOLOGY_VERSION 1
+// Number of bytes in the header of a file
+#define TOPOLOGY_HEADER_SIZE 16
+
+struct Topology
+{
+	// Mapping of the file and its length in bytes
+	void *map;
+	size_t length;
+	int routers;
+	int edges;
+	const uint16_t *key;
+	const uint32_t *offset;
+	const uint32_t *dest;
+	const int32_t *cost;
+};
+
+struct TopologySearch
+{
+	struct MinHeap *heap;
+	// One heap node per router, reused by every calculation
+	struct HeapNode *nodes;
+};
+
+/**
+ * Writes a topology file from a list of edges. The edges are sorted by their source, and
+ * of several edges between the same routers the last one is kept.
+ *
+ * @param filename - path of file
+ * @param count    - number of edges
+ * @param source   - labels of the routers the edges leave
+ * @param dest     - labels of the routers the edges lead to
+ * @param cost     - costs of the edges
+ *
+ * @return - number of edges written, -1 if error
+ */
+int writeTopologyFile(const char *filename, int count, const uint16_t *source, const uint16_t *dest, const int32_t *cost);
+
+/**
+ * Maps a topology file and checks that its tables are consistent.
+ *
+ * @param filename - path of file
+ * @param topology - where the mapping and its tables will be stored
+ *
+ * @return - 0 if success, -1 if error
+ */
+int mapTopologyFile(const char *filename, struct Topology *topology);
+
+/**
+ * Unmaps a topology file.
+ *
+ * @param topology - mapped topology
+ */
+void unmapTopology(struct Topology *topology);
+
+/**
+ * Finds the index of a router label by searching the sorted label table.
+ *
+ * @param topology - mapped topology
+ * @param label    - label being searched for
+ *
+ * @return - index of label, -1 if not found
+ */
+int findTopologyIndex(const struct Topology *topology, uint16_t label);
+
+/**
+ * Allocates the heap the shortest path calculations over a topology share.
+ *
+ * @param topology - mapped topology
+ * @param search   - where the heap will be stored
+ *
+ * @return - 0 if success, -1 if error
+ */
+int newTopologySearch(const struct Topology *topology, struct TopologySearch *search);
+
+/**
+ * Frees the heap of the shortest path calculations.
+ *
+ * @param search - heap being freed
+ */
+void freeTopologySearch(struct TopologySearch *search);
+
+/**
+ * Computes the shortest path from a router to every other router in a topology.
+ *
+ * @param topology - mapped topology
+ * @param search   - heap of the calculation
+ * @param root     - index of starting router
+ * @param cost     - array of topology->routers costs where the cost of each path is
+ *                   stored, INT_MAX if the router is unreachable
+ * @param hop      - array of topology->routers indices where the first router on each
+ *                   path after the root is stored, -1 for the root and unreachable routers
+ */
+void topologyPaths(const struct Topology *topology, struct TopologySearch *search, int root, int *cost, int *hop);
+
+#endif // _LSTOPOLOGY_H
@@ -0,0 +1,185 @@
+/**
+ * This file implements the trace points that follow each link-state packet through a
+ * router, and the trace files they are written to.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "lsTrace.h"
+
+// Directory the trace files are written to, NULL if not tracing
+const char *traceDirectory;
+uint16_t traceRouter;
+double traceTicksPerMicrosecond;
+uint64_t traceReferenceTicks;
+int64_t traceReferenceTime;
+
+// Ring of the calling thread, its header NULL if the thread does not trace
+__thread struct TraceRing traceRing;
+
+uint64_t readTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+int initTrace(const char *directory, uint16_t router)
+{
+	struct timespec start, end;
+	uint64_t startTicks, endTicks;
+	int64_t elapsed;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	startTicks = readTicks();
+
+	usleep(TRACE_CALIBRATION);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	endTicks = readTicks();
+
+	elapsed = (int64_t) (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+
+	if (elapsed <= 0 || endTicks <= startTicks)
+	{
+		fprintf(stderr, "Could not time the trace clock\n");
+		return -1;
+	}
+
+	traceTicksPerMicrosecond = (double) (endTicks - startTicks) / elapsed;
+	traceReferenceTicks = endTicks;
+	traceReferenceTime = (int64_t) end.tv_sec * 1000000 + end.tv_nsec / 1000;
+	traceDirectory = directory;
+	traceRouter = router;
+
+	return 0;
+}
+
+int openTraceRing(const char *thread)
+{
+	int fd;
+	size_t size;
+	char path[PATH_MAX];
+	void *map;
+	struct TraceHeader *header;
+
+	if (!traceDirectory)
+		return 0;
+
+	snprintf(path, PATH_MAX, "%s/%u-%s.trace", traceDirectory, traceRouter, thread);
+	size = sizeof(struct TraceHeader) + TRACE_CAPACITY * sizeof(struct TraceEvent);
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+	{
+		perror("Error");
+		return -1;
+	}
+
+	if (ftruncate(fd, size) < 0 || (map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		perror("Error");
+		close(fd);
+		return -1;
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	close(fd);
+
+	header = (struct TraceHeader *) map;
+	header->capacity = TRACE_CAPACITY;
+	header->router = traceRouter;
+	strncpy(header->thread, thread, TRACE_NAME_LENGTH - 1);
+	header->ticksPerMicrosecond = traceTicksPerMicrosecond;
+	header->referenceTicks = traceReferenceTicks;
+	header->referenceTime = traceReferenceTime;
+	header->head = 0;
+	// A reader only trusts a file whose header is complete
+	__atomic_store_n(&header->magic, TRACE_MAGIC, __ATOMIC_RELEASE);
+
+	traceRing.events = (struct TraceEvent *) (header + 1);
+	traceRing.header = header;
+
+	return 0;
+}
+
+void tracePacket(int stage, const char *packet, uint16_t peer)
+{
+	uint64_t head;
+	struct TraceEvent *event;
+
+	if (!traceRing.header)
+		return;
+
+	head = traceRing.header->head;
+	event = &traceRing.events[head & (TRACE_CAPACITY - 1)];
+
+	event->ticks = readTicks();
+	event->seqN = getSequenceNumber((char *) packet);
+	event->source = getSourceID((char *) packet);
+	event->dest = getDestinationID((char *) packet);
+	event->peer = peer;
+	event->stage = stage;
+	event->unused = 0;
+
+	// The event is complete before a reader can see it
+	__atomic_store_n(&traceRing.header->head, head + 1, __ATOMIC_RELEASE);
+}
+
+int mapTraceFile(const char *filename, struct TraceRing *ring)
+{
+	int fd;
+	void *map;
+	struct stat st;
+	struct TraceHeader *header;
+
+	if ((fd = open(filename, O_RDONLY)) < 0)
+	{
+		perror(filename);
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0 || st.st_size < sizeof(struct TraceHeader) ||
+	    (map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		fprintf(stderr, "Could not map %s\n", filename);
+		close(fd);
+		return -1;
+	}
+
+	close(fd);
+
+	header = (struct TraceHeader *) map;
+
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != TRACE_MAGIC ||
+	    st.st_size < sizeof(struct TraceHeader) + header->capacity * sizeof(struct TraceEvent))
+	{
+		fprintf(stderr, "%s is not a trace file\n", filename);
+		munmap(map, st.st_size);
+		return -1;
+	}
+
+	ring->header = header;
+	ring->events = (struct TraceEvent *) (header + 1);
+
+	return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * This file describes the trace points that follow each link-state packet through a
+ * router, and the trace files they are written to.
+ *
+ * Every thread that traces has its own ring of events in a file it maps, so a trace
+ * point takes no lock and the last events are still in the file if the router is killed.
+ * The thread is the ring's only writer and publishes each event by storing the number of
+ * events written after it, a reader taking the events from the oldest still in the ring.
+ *
+ * Events are timestamped with the CPU's time stamp counter where there is one, and with
+ * the monotonic clock in nanoseconds otherwise. Every router on a host reads the same
+ * counter, so their traces are merged with one rate. The rate and a reading of the
+ * monotonic clock at the same moment are kept in the header of each file.
+ *
+ * The trace points are only compiled in when LS_TRACE is defined (make TRACE=1).
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSTRACE_H
+#define _LSTRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lsPacket.h"
+
+// Packet originated by the router
+#define TRACE_ORIGINATED 1
+// Packet received in a datagram from the peer
+#define TRACE_RECEIVED 2
+// Packet taken from the received queue
+#define TRACE_DEQUEUED 3
+// Packet newer than the graph applied to it
+#define TRACE_APPLIED 4
+// Packet taken from the send queue to be flooded
+#define TRACE_FLOOD_DEQUEUED 5
+// Packet put on the retransmission lists of the neighbors it is flooded to
+#define TRACE_FLOODED 6
+// Packet sent in a datagram to the peer
+#define TRACE_SENT 7
+// Number of stages, including the unused 0
+#define TRACE_STAGES 8
+
+// First bytes of a trace file
+#define TRACE_MAGIC 0x5254534C
+// Events held by the ring of each thread, a power of two
+#define TRACE_CAPACITY (1 << 16)
+// Microseconds the time stamp counter is timed against the monotonic clock
+#define TRACE_CALIBRATION 20000
+// Characters in the name of a thread, including the terminator
+#define TRACE_NAME_LENGTH 16
+
+#ifdef LS_TRACE
+#define TRACE_PACKET(stage, packet, peer) tracePacket(stage, packet, peer)
+#else
+#define TRACE_PACKET(stage, packet, peer) do { } while (0)
+#endif
+
+struct TraceEvent
+{
+	uint64_t ticks;
+	int32_t seqN;
+	uint16_t source;
+	uint16_t dest;
+	// Neighbor the packet was received from or sent to, LS_ROUTER_NONE for other stages
+	uint16_t peer;
+	uint8_t stage;
+	uint8_t unused;
+};
+
+struct TraceHeader
+{
+	uint32_t magic;
+	uint32_t capacity;
+	uint16_t router;
+	char thread[TRACE_NAME_LENGTH];
+	double ticksPerMicrosecond;
+	// Counter and monotonic clock in microseconds read at the same moment
+	uint64_t referenceTicks;
+	int64_t referenceTime;
+	// Number of events ever written, the newest at (head - 1) % capacity
+	uint64_t head __attribute__((aligned(64)));
+} __attribute__((aligned(64)));
+
+struct TraceRing
+{
+	struct TraceHeader *header;
+	struct TraceEvent *events;
+};
+
+/**
+ * Reads the time stamp counter, or the monotonic clock where there is none.
+ *
+ * @return - ticks
+ */
+uint64_t readTicks();
+
+/**
+ * Times the ticks against the monotonic clock and remembers where the calling router
+ * writes its traces. Takes TRACE_CALIBRATION microseconds.
+ *
+ * @param directory - directory the trace files are written to, which must exist
+ * @param router    - label of the local router
+ *
+ * @return - 0 if success, -1 if error
+ */
+int initTrace(const char *directory, uint16_t router);
+
+/**
+ * Creates the trace file of the calling thread, named after the router and the thread,
+ * and maps its ring. Does nothing if tracing was not initialized.
+ *
+ * @param thread - name of thread
+ *
+ * @return - 0 if success or not tracing, -1 if error
+ */
+int openTraceRing(const char *thread);
+
+/**
+ * Writes an event for a link-state packet to the ring of the calling thread. Does
+ * nothing if the thread has no ring.
+ *
+ * @param stage  - stage the packet reached (TRACE_*)
+ * @param packet - link-state packet or summary
+ * @param peer   - neighbor the packet was received from or sent to, or LS_ROUTER_NONE
+ */
+void tracePacket(int stage, const char *packet, uint16_t peer);
+
+/**
+ * Maps a trace file for reading.
+ *
+ * @param filename - path of trace file
+ * @param ring     - where the header and events will be stored
+ *
+ * @return - 0 if success, -1 if error
+ */
+int mapTraceFile(const char *filename, struct TraceRing *ring);
+
+#endif // _LSTRACE_H
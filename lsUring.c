@@ -0,0 +1,438 @@
+/**
+ * This file implements the io_uring a network thread can do its socket work through.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "lsUring.h"
+
+__thread struct Uring *threadRing;
+
+struct Uring *newUring(int socket, int sqpoll)
+{
+	int i;
+	unsigned *array;
+	struct io_uring_params params;
+	struct io_uring_buf_reg registration;
+	struct Uring *ring = (struct Uring *) calloc(1, sizeof(struct Uring));
+
+	if (!ring)
+	{
+		printf("Malloc failed.\n");
+		return NULL;
+	}
+
+	memset(&params, 0, sizeof(params));
+	if (sqpoll)
+	{
+		params.flags = IORING_SETUP_SQPOLL;
+		params.sq_thread_idle = URING_SQPOLL_IDLE;
+	}
+	else
+	{
+		// Receives complete only when the thread waits for them, so a wait takes all that arrived
+		params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+	}
+
+	ring->socket = socket;
+	ring->sqpoll = sqpoll;
+	ring->multishot = 1;
+	ring->current = -1;
+
+	ring->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+
+	// Kernels before 6.1 cannot defer the completions
+	if (ring->fd < 0 && errno == EINVAL && !sqpoll)
+	{
+		params.flags = 0;
+		ring->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+	}
+
+	if (ring->fd < 0)
+	{
+		perror("io_uring setup failed");
+		free(ring);
+		return NULL;
+	}
+
+	// Waiting for a completion with a timeout replaces the socket's receive timeout
+	if (!(params.features & IORING_FEAT_EXT_ARG))
+	{
+		fprintf(stderr, "io_uring of this kernel cannot wait with a timeout\n");
+		freeUring(ring);
+		return NULL;
+	}
+
+	ring->sqLength = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cqLength = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqesLength = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	// Both rings share one mapping where the kernel allows it
+	if (params.features & IORING_FEAT_SINGLE_MMAP && ring->cqLength > ring->sqLength)
+		ring->sqLength = ring->cqLength;
+
+	ring->sqMap = mmap(NULL, ring->sqLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sqMap == MAP_FAILED)
+		ring->sqMap = NULL;
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cqMap = ring->sqMap;
+	else if ((ring->cqMap = mmap(NULL, ring->cqLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING)) == MAP_FAILED)
+		ring->cqMap = NULL;
+
+	ring->sqes = (struct io_uring_sqe *) mmap(NULL, ring->sqesLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+		ring->sqes = NULL;
+
+	if (!ring->sqMap || !ring->cqMap || !ring->sqes)
+	{
+		perror("io_uring mapping failed");
+		freeUring(ring);
+		return NULL;
+	}
+
+	ring->sqHead = (unsigned *) ((char *) ring->sqMap + params.sq_off.head);
+	ring->sqTail = (unsigned *) ((char *) ring->sqMap + params.sq_off.tail);
+	ring->sqFlags = (unsigned *) ((char *) ring->sqMap + params.sq_off.flags);
+	ring->sqMask = *(unsigned *) ((char *) ring->sqMap + params.sq_off.ring_mask);
+	ring->sqEntries = params.sq_entries;
+	ring->tail = *ring->sqTail;
+	ring->cqHead = (unsigned *) ((char *) ring->cqMap + params.cq_off.head);
+	ring->cqTail = (unsigned *) ((char *) ring->cqMap + params.cq_off.tail);
+	ring->cqMask = *(unsigned *) ((char *) ring->cqMap + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) ((char *) ring->cqMap + params.cq_off.cqes);
+
+	// Every slot of the array names the entry of the same index
+	array = (unsigned *) ((char *) ring->sqMap + params.sq_off.array);
+	for (i = 0; i < ring->sqEntries; i++)
+		array[i] = i;
+
+	ring->sends = (struct UringSend *) malloc(ring->sqEntries * sizeof(struct UringSend));
+	ring->buffers = (char *) malloc(URING_BUFFERS * LS_DATAGRAM_SIZE);
+	ring->readyBuffers = (uint16_t *) malloc(URING_BUFFERS * sizeof(uint16_t));
+	ring->readyLengths = (int *) malloc(URING_BUFFERS * sizeof(int));
+
+	// The buffer ring is shared with the kernel and has to start on a page
+	ring->bufferRingLength = URING_BUFFERS * sizeof(struct io_uring_buf);
+	ring->bufferRing = (struct io_uring_buf_ring *) mmap(NULL, ring->bufferRingLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring->bufferRing == MAP_FAILED)
+		ring->bufferRing = NULL;
+
+	if (!ring->sends || !ring->buffers || !ring->readyBuffers || !ring->readyLengths || !ring->bufferRing)
+	{
+		printf("Malloc failed.\n");
+		freeUring(ring);
+		return NULL;
+	}
+
+	ring->freeSend = -1;
+	for (i = ring->sqEntries - 1; i >= 0; i--)
+	{
+		ring->sends[i].next = ring->freeSend;
+		ring->freeSend = i;
+	}
+
+	memset(&registration, 0, sizeof(registration));
+	registration.ring_addr = (uint64_t) (uintptr_t) ring->bufferRing;
+	registration.ring_entries = URING_BUFFERS;
+	registration.bgid = URING_BUFFER_GROUP;
+
+	if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+	{
+		perror("io_uring buffer ring failed");
+		freeUring(ring);
+		return NULL;
+	}
+
+	for (i = 0; i < URING_BUFFERS; i++)
+		provideBuffer(ring, i);
+
+	if (armReceive(ring) < 0 || enterUring(ring, 0, 0) < 0)
+	{
+		freeUring(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+struct io_uring_sqe *getUringEntry(struct Uring *ring)
+{
+	struct io_uring_sqe *sqe;
+
+	// A full queue is submitted to make room, which a polling thread takes in its own time
+	while (ring->tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->sqEntries)
+	{
+		if (enterUring(ring, 0, 0) < 0)
+			return NULL;
+
+		if (ring->tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) < ring->sqEntries)
+			break;
+
+		if (!ring->sqpoll)
+		{
+			fprintf(stderr, "io_uring submission queue is full\n");
+			return NULL;
+		}
+		sched_yield();
+	}
+
+	sqe = &ring->sqes[ring->tail++ & ring->sqMask];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+	return sqe;
+}
+
+int sendUring(struct Uring *ring, const char *datagram, int length, const char *destHost, int destPort)
+{
+	int slot;
+	struct UringSend *send;
+	struct io_uring_sqe *sqe;
+
+	// Sends complete as soon as the kernel takes them, so a slot frees up without waiting long
+	while (ring->freeSend < 0)
+	{
+		reapUring(ring);
+		if (ring->freeSend < 0 && enterUring(ring, 1, URING_SEND_WAIT) < 0)
+			return -1;
+	}
+
+	if (!(sqe = getUringEntry(ring)))
+		return -1;
+
+	slot = ring->freeSend;
+	send = &ring->sends[slot];
+	ring->freeSend = send->next;
+
+	// The datagram and its address are kept in the slot until the send completes
+	memset(&send->address, 0, sizeof(send->address));
+	send->address.sin_family = AF_INET;
+	inet_aton(destHost, &send->address.sin_addr);
+	send->address.sin_port = htons(destPort);
+
+	memcpy(send->datagram, datagram, length);
+	send->vector.iov_base = send->datagram;
+	send->vector.iov_len = length;
+
+	memset(&send->message, 0, sizeof(send->message));
+	send->message.msg_name = &send->address;
+	send->message.msg_namelen = sizeof(send->address);
+	send->message.msg_iov = &send->vector;
+	send->message.msg_iovlen = 1;
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = ring->socket;
+	sqe->addr = (uint64_t) (uintptr_t) &send->message;
+	sqe->len = 1;
+	sqe->user_data = slot;
+
+	return 0;
+}
+
+int receiveUring(struct Uring *ring, char **datagram, long long timeout)
+{
+	int length;
+
+	if (ring->current >= 0)
+	{
+		provideBuffer(ring, ring->current);
+		ring->current = -1;
+	}
+
+	// The sends queued since the last call are submitted by the same system call that waits
+	reapUring(ring);
+	if (enterUring(ring, !ring->readyCount, timeout) < 0)
+		return -1;
+	reapUring(ring);
+
+	if (!ring->readyCount)
+		return 0;
+
+	ring->current = ring->readyBuffers[ring->readyFirst];
+	length = ring->readyLengths[ring->readyFirst];
+	ring->readyFirst = (ring->readyFirst + 1) % URING_BUFFERS;
+	ring->readyCount--;
+
+	*datagram = ring->buffers + ring->current * LS_DATAGRAM_SIZE;
+
+	return length;
+}
+
+int enterUring(struct Uring *ring, int wait, long long timeout)
+{
+	unsigned submit, flags = 0;
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+
+	// The entries written since the last call are handed to the kernel
+	__atomic_store_n(ring->sqTail, ring->tail, __ATOMIC_RELEASE);
+	submit = ring->tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+
+	if (ring->sqpoll)
+	{
+		// The polling thread takes the entries itself, and only has to be woken once it sleeps
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (submit && (__atomic_load_n(ring->sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP))
+			flags |= IORING_ENTER_SQ_WAKEUP;
+		submit = 0;
+	}
+
+	if (wait)
+	{
+		ts.tv_sec = timeout / 1000000;
+		ts.tv_nsec = timeout % 1000000 * 1000;
+		memset(&arg, 0, sizeof(arg));
+		arg.ts = (uint64_t) (uintptr_t) &ts;
+		flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+	}
+
+	if (!submit && !flags)
+		return 0;
+
+	if (syscall(__NR_io_uring_enter, ring->fd, submit, wait ? 1 : 0, flags, wait ? &arg : NULL, wait ? sizeof(arg) : 0) < 0 &&
+	    errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+	{
+		perror("io_uring enter failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+void reapUring(struct Uring *ring)
+{
+	int id, index;
+	unsigned head, tail;
+	struct io_uring_cqe *cqe;
+
+	head = *ring->cqHead;
+	tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++)
+	{
+		cqe = &ring->cqes[head & ring->cqMask];
+
+		if (cqe->user_data != URING_RECEIVE && (cqe->user_data & URING_WATCH))
+		{
+			if (cqe->res < 0)
+				fprintf(stderr, "Poll failed: %s\n", strerror(-cqe->res));
+			else
+				watchUring(ring, (int) (cqe->user_data & ~URING_WATCH));
+			continue;
+		}
+
+		if (cqe->user_data != URING_RECEIVE)
+		{
+			if (cqe->res < 0)
+				fprintf(stderr, "Sendto failed: %s\n", strerror(-cqe->res));
+			ring->sends[cqe->user_data].next = ring->freeSend;
+			ring->freeSend = cqe->user_data;
+			continue;
+		}
+
+		// A multishot receive goes on until a completion without more to follow
+		if (!(cqe->flags & IORING_CQE_F_MORE))
+			ring->receiving = 0;
+
+		if (cqe->flags & IORING_CQE_F_BUFFER)
+		{
+			id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+			if (cqe->res > 0)
+			{
+				index = (ring->readyFirst + ring->readyCount++) % URING_BUFFERS;
+				ring->readyBuffers[index] = id;
+				ring->readyLengths[index] = cqe->res;
+			}
+			else
+				provideBuffer(ring, id);
+		}
+		else if (cqe->res == -EINVAL && ring->multishot)
+			ring->multishot = 0;
+		else if (cqe->res < 0 && cqe->res != -ENOBUFS)
+			fprintf(stderr, "Receive failed: %s\n", strerror(-cqe->res));
+	}
+
+	__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+
+	// A receive that ran out of buffers succeeds again once the taken datagrams give them back
+	if (!ring->receiving)
+		armReceive(ring);
+}
+
+int armReceive(struct Uring *ring)
+{
+	struct io_uring_sqe *sqe;
+
+	if (!(sqe = getUringEntry(ring)))
+		return -1;
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = ring->socket;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BUFFER_GROUP;
+	sqe->user_data = URING_RECEIVE;
+
+	if (ring->multishot)
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+	else
+		sqe->len = LS_DATAGRAM_SIZE;
+
+	ring->receiving = 1;
+
+	return 0;
+}
+
+int watchUring(struct Uring *ring, int fd)
+{
+	struct io_uring_sqe *sqe;
+
+	if (!(sqe = getUringEntry(ring)))
+		return -1;
+
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = POLLIN;
+	sqe->user_data = URING_WATCH | fd;
+
+	return 0;
+}
+
+void provideBuffer(struct Uring *ring, int id)
+{
+	struct io_uring_buf *buffer = &ring->bufferRing->bufs[ring->bufferTail & (URING_BUFFERS - 1)];
+
+	buffer->addr = (uint64_t) (uintptr_t) (ring->buffers + id * LS_DATAGRAM_SIZE);
+	buffer->len = LS_DATAGRAM_SIZE;
+	buffer->bid = id;
+
+	__atomic_store_n(&ring->bufferRing->tail, ++ring->bufferTail, __ATOMIC_RELEASE);
+}
+
+void freeUring(struct Uring *ring)
+{
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqesLength);
+	if (ring->cqMap && ring->cqMap != ring->sqMap)
+		munmap(ring->cqMap, ring->cqLength);
+	if (ring->sqMap)
+		munmap(ring->sqMap, ring->sqLength);
+	if (ring->bufferRing)
+		munmap(ring->bufferRing, ring->bufferRingLength);
+
+	close(ring->fd);
+	free(ring->sends);
+	free(ring->buffers);
+	free(ring->readyBuffers);
+	free(ring->readyLengths);
+	free(ring);
+}
@@ -0,0 +1,213 @@
+/**
+ * This file describes the io_uring a network thread can do its socket work through
+ * instead of blocking calls.
+ *
+ * Datagrams sent to the socket are queued as sendmsg entries on the submission queue and
+ * submitted together, so every datagram sent in a pass of the network thread, a whole
+ * flood included, takes one system call, or none when a kernel thread polls the queue.
+ * A multishot receive stays armed on the socket and fills buffers the ring provides to
+ * the kernel, so datagrams that arrive together are taken without a call each.
+ *
+ * The ring is set up through the system calls themselves, so no library is needed. A
+ * kernel that cannot set it up leaves the caller to use the blocking calls, and one
+ * without multishot receives has a single receive armed at a time instead.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#ifndef _LSURING_H
+#define _LSURING_H
+
+#include <arpa/inet.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "lsPacket.h"
+
+// Socket backends of the network thread
+#define IO_BLOCKING 0
+#define IO_URING 1
+#define IO_URING_SQPOLL 2
+
+// Entries of the submission queue, also the most sends in flight
+#define URING_ENTRIES 256
+// Buffers provided for received datagrams, a power of two
+#define URING_BUFFERS 256
+// Group the provided buffers are registered as
+#define URING_BUFFER_GROUP 1
+// Completion data of the receive, every other completion is of the send in that slot
+// unless it is of a watched socket, whose descriptor it holds along with URING_WATCH
+#define URING_RECEIVE UINT64_MAX
+#define URING_WATCH (1ULL << 62)
+// Microseconds waited for a send to complete when every slot is in flight
+#define URING_SEND_WAIT 1000
+// Milliseconds the kernel thread polling the submission queue stays awake without work
+#define URING_SQPOLL_IDLE 1000
+
+struct UringSend
+{
+	struct msghdr message;
+	struct iovec vector;
+	struct sockaddr_in address;
+	char datagram[LS_DATAGRAM_SIZE];
+	// Next free slot, -1 if none
+	int next;
+};
+
+struct Uring
+{
+	int fd;
+	int socket;
+	int sqpoll;
+	// Set while the receive is armed, and while it is multishot
+	int receiving;
+	int multishot;
+	// Submission queue, with the tail of the entries written but not yet published
+	unsigned *sqHead;
+	unsigned *sqTail;
+	unsigned *sqFlags;
+	unsigned sqMask;
+	unsigned sqEntries;
+	unsigned tail;
+	struct io_uring_sqe *sqes;
+	// Completion queue
+	unsigned *cqHead;
+	unsigned *cqTail;
+	unsigned cqMask;
+	struct io_uring_cqe *cqes;
+	// Mappings of the rings and the submission queue entries
+	void *sqMap;
+	size_t sqLength;
+	void *cqMap;
+	size_t cqLength;
+	size_t sqesLength;
+	// Slots of the sends in flight and the first free one
+	struct UringSend *sends;
+	int freeSend;
+	// Ring of provided buffers, the buffers and the tail of the ring
+	struct io_uring_buf_ring *bufferRing;
+	size_t bufferRingLength;
+	char *buffers;
+	uint16_t bufferTail;
+	// Received datagrams waiting to be taken, by buffer and length, first and count
+	uint16_t *readyBuffers;
+	int *readyLengths;
+	int readyFirst;
+	int readyCount;
+	// Buffer of the datagram taken last, -1 if none
+	int current;
+};
+
+// Ring the calling thread's sends to its socket are queued on, NULL to send them at once
+extern __thread struct Uring *threadRing;
+
+/**
+ * Sets up an io_uring for a socket, with buffers provided for its datagrams and a
+ * receive armed on it.
+ *
+ * @param socket - socket file descriptor
+ * @param sqpoll - 1 to have a kernel thread poll the submission queue, 0 if not
+ *
+ * @return - pointer to ring, NULL if error or the kernel does not support it
+ */
+struct Uring *newUring(int socket, int sqpoll);
+
+/**
+ * Gets the next free submission queue entry, submitting the queue if it is full.
+ *
+ * @param ring - io_uring
+ *
+ * @return - pointer to cleared entry, NULL if error
+ */
+struct io_uring_sqe *getUringEntry(struct Uring *ring);
+
+/**
+ * Queues a datagram to be sent to a host and port. The datagram is copied, and sent when
+ * the queue is next submitted.
+ *
+ * @param ring     - io_uring
+ * @param datagram - datagram being sent
+ * @param length   - length of datagram in bytes
+ * @param destHost - IPv4 address of destination
+ * @param destPort - port of destination
+ *
+ * @return - 0 if success, -1 if error
+ */
+int sendUring(struct Uring *ring, const char *datagram, int length, const char *destHost, int destPort);
+
+/**
+ * Takes the next received datagram, submitting the queued entries and waiting for one
+ * if none has been received. The datagram stays valid until the next call.
+ *
+ * @param ring     - io_uring
+ * @param datagram - where a pointer to the datagram will be stored
+ * @param timeout  - microseconds to wait for a datagram
+ *
+ * @return - length of datagram, 0 if none was received in time, -1 if error
+ */
+int receiveUring(struct Uring *ring, char **datagram, long long timeout);
+
+/**
+ * Submits the queued entries, and waits for a completion if asked to.
+ *
+ * @param ring    - io_uring
+ * @param wait    - 1 to wait for a completion, 0 if not
+ * @param timeout - microseconds to wait
+ *
+ * @return - 0 if success, -1 if error
+ */
+int enterUring(struct Uring *ring, int wait, long long timeout);
+
+/**
+ * Takes every completion from the completion queue. Sends free their slots and received
+ * datagrams wait to be taken, and the receive is armed again if it ended.
+ *
+ * @param ring - io_uring
+ */
+void reapUring(struct Uring *ring);
+
+/**
+ * Arms a receive into the provided buffers on the socket.
+ *
+ * @param ring - io_uring
+ *
+ * @return - 0 if success, -1 if error
+ */
+int armReceive(struct Uring *ring);
+
+/**
+ * Watches another socket for datagrams, so that waiting on the ring ends when one
+ * arrives there too. The datagram is left on the socket for the caller to take, and the
+ * socket is watched again once it has been seen readable.
+ *
+ * @param ring - io_uring
+ * @param fd   - file descriptor of socket watched
+ *
+ * @return - 0 if success, -1 if error
+ */
+int watchUring(struct Uring *ring, int fd);
+
+/**
+ * Provides a buffer to the kernel for a received datagram.
+ *
+ * @param ring - io_uring
+ * @param id   - index of buffer
+ */
+void provideBuffer(struct Uring *ring, int id);
+
+/**
+ * Tears down an io_uring and frees its buffers. The socket is left open.
+ *
+ * @param ring - io_uring
+ */
+void freeUring(struct Uring *ring);
+
+#endif // _LSURING_H
@@ -0,0 +1,236 @@
+/**
+ * This file implements regression tests of the router's modules, run by make test.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lsGraph.h"
+#include "lsNetwork.h"
+#include "lsPacket.h"
+
+// Labels of the routers of the test networks
+#define TEST_A 1
+#define TEST_B 2
+#define TEST_C 3
+
+/**
+ * Checks that a withdrawn link survives the partition it causes, so an older packet for
+ * it replayed afterwards is refused instead of bringing the link back.
+ *
+ * @return - 0 if passed, -1 if failed
+ */
+int testWithdrawnLinkReplay();
+
+/**
+ * Checks that a packet for one direction of a link leaves the other direction at the cost
+ * its own router advertised, so a neighbor's packet does not revive our withdrawal.
+ *
+ * @return - 0 if passed, -1 if failed
+ */
+int testReverseKeepsWithdrawal();
+
+/**
+ * Checks that a neighbor going down and coming up again while its events wait in the
+ * received queue is popped as both events, in the order they happened.
+ *
+ * @return - 0 if passed, -1 if failed
+ */
+int testNeighborFlapQueued();
+
+/**
+ * Checks that a copy of a queued link-state packet from another neighbor leaves the queued
+ * entry's sender unchanged, so the packet is not flooded back to the neighbor it came from.
+ *
+ * @return - 0 if passed, -1 if failed
+ */
+int testUpdateCopyQueued();
+
+int main(int argc, char **argv)
+{
+	int failed = 0;
+
+	if (testWithdrawnLinkReplay() < 0)
+	{
+		printf("FAIL withdrawn link replay\n");
+		failed++;
+	}
+	else
+		printf("PASS withdrawn link replay\n");
+
+	if (testReverseKeepsWithdrawal() < 0)
+	{
+		printf("FAIL reverse keeps withdrawal\n");
+		failed++;
+	}
+	else
+		printf("PASS reverse keeps withdrawal\n");
+
+	if (testNeighborFlapQueued() < 0)
+	{
+		printf("FAIL neighbor flap queued\n");
+		failed++;
+	}
+	else
+		printf("PASS neighbor flap queued\n");
+
+	if (testUpdateCopyQueued() < 0)
+	{
+		printf("FAIL update copy queued\n");
+		failed++;
+	}
+	else
+		printf("PASS update copy queued\n");
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int testWithdrawnLinkReplay()
+{
+	int result;
+	int32_t first, second;
+	char packet[LS_PACKET_SIZE], stale[LS_PACKET_SIZE], reverse[LS_PACKET_SIZE];
+	struct AdjListNode *edge;
+	struct Graph *graph = newGraph(3, 0);
+
+	if (!graph)
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	// A - B - C, every link advertised by both of its routers
+	first = LS_INITIAL_SEQUENCE;
+	buildLSPacket(packet, first, TEST_A, TEST_B, 1);
+	addEdgeFromPacket(graph, packet);
+	buildLSPacket(packet, first, TEST_B, TEST_A, 1);
+	addEdgeFromPacket(graph, packet);
+	buildLSPacket(stale, first, TEST_B, TEST_C, 1);
+	addEdgeFromPacket(graph, stale);
+	buildLSPacket(reverse, first, TEST_C, TEST_B, 1);
+	addEdgeFromPacket(graph, reverse);
+
+	// Both ends withdraw B - C, cutting C off from A
+	second = nextSequence(first);
+	buildLSPacket(packet, second, TEST_B, TEST_C, LS_WITHDRAW_COST);
+	addEdgeFromPacket(graph, packet);
+	buildLSPacket(packet, second, TEST_C, TEST_B, LS_WITHDRAW_COST);
+	addEdgeFromPacket(graph, packet);
+	removeUnreachable(graph, TEST_A);
+
+	// The older packets arrive late, as retransmissions or over a slower path
+	result = addEdgeFromPacket(graph, stale) == 0 && addEdgeFromPacket(graph, reverse) == 0;
+
+	edge = findIndex(graph, TEST_B) >= 0 && findIndex(graph, TEST_C) >= 0 ?
+	       findEdge(graph, findIndex(graph, TEST_B), findIndex(graph, TEST_C)) : NULL;
+	result = result && edge && edge->cost == LS_WITHDRAW_COST && edge->seqN == second;
+
+	freeGraph(graph);
+
+	return result ? 0 : -1;
+}
+
+int testReverseKeepsWithdrawal()
+{
+	int result;
+	int32_t first, second;
+	char packet[LS_PACKET_SIZE];
+	struct AdjListNode *edge, *reverse;
+	struct Graph *graph = newGraph(2, 0);
+
+	if (!graph)
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	// A - B advertised by both of its routers
+	first = LS_INITIAL_SEQUENCE;
+	buildLSPacket(packet, first, TEST_A, TEST_B, 1);
+	addEdgeFromPacket(graph, packet);
+	buildLSPacket(packet, first, TEST_B, TEST_A, 1);
+	addEdgeFromPacket(graph, packet);
+
+	// A withdraws its direction, then B's refresh of its own arrives
+	second = nextSequence(first);
+	buildLSPacket(packet, second, TEST_A, TEST_B, LS_WITHDRAW_COST);
+	addEdgeFromPacket(graph, packet);
+	buildLSPacket(packet, second, TEST_B, TEST_A, 1);
+	result = addEdgeFromPacket(graph, packet) > 0;
+
+	edge = findEdge(graph, findIndex(graph, TEST_A), findIndex(graph, TEST_B));
+	reverse = findEdge(graph, findIndex(graph, TEST_B), findIndex(graph, TEST_A));
+	result = result && edge && edge->cost == LS_WITHDRAW_COST && reverse && reverse->cost == 1;
+
+	freeGraph(graph);
+
+	return result ? 0 : -1;
+}
+
+int testNeighborFlapQueued()
+{
+	int result;
+	uint16_t peer;
+	char packet[LS_PACKET_SIZE];
+	struct FifoQueue *queue = newFifoQueue(8, 0);
+
+	if (!queue)
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	memset(packet, 0, LS_PACKET_SIZE);
+
+	// B goes down and comes back before the main thread gets to either event
+	push(queue, QUEUE_NEIGHBOR_DOWN, TEST_B, packet, PRIORITY_URGENT);
+	push(queue, QUEUE_NEIGHBOR_UP, TEST_B, packet, PRIORITY_URGENT);
+	result = pop(queue, packet, &peer) == QUEUE_NEIGHBOR_DOWN && peer == TEST_B;
+	result = result && pop(queue, packet, &peer) == QUEUE_NEIGHBOR_UP && peer == TEST_B;
+
+	// B flaps twice, ending down
+	push(queue, QUEUE_NEIGHBOR_DOWN, TEST_B, packet, PRIORITY_URGENT);
+	push(queue, QUEUE_NEIGHBOR_UP, TEST_B, packet, PRIORITY_URGENT);
+	push(queue, QUEUE_NEIGHBOR_DOWN, TEST_B, packet, PRIORITY_URGENT);
+	result = result && pop(queue, packet, &peer) == QUEUE_NEIGHBOR_UP;
+	result = result && pop(queue, packet, &peer) == QUEUE_NEIGHBOR_DOWN;
+	result = result && isEmptyQueue(queue);
+
+	free(queue->nodes);
+	free(queue->index);
+	free(queue);
+
+	return result ? 0 : -1;
+}
+
+int testUpdateCopyQueued()
+{
+	int result;
+	uint16_t peer;
+	char packet[LS_PACKET_SIZE];
+	struct FifoQueue *queue = newFifoQueue(8, 0);
+
+	if (!queue)
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	// The same packet for A - C arrives from B and then from C
+	buildLSPacket(packet, LS_INITIAL_SEQUENCE, TEST_A, TEST_C, 1);
+	push(queue, QUEUE_UPDATE, TEST_B, packet, PRIORITY_BULK);
+	push(queue, QUEUE_UPDATE, TEST_C, packet, PRIORITY_BULK);
+	result = pop(queue, packet, &peer) == QUEUE_UPDATE && peer == TEST_B && isEmptyQueue(queue);
+
+	free(queue->nodes);
+	free(queue->index);
+	free(queue);
+
+	return result ? 0 : -1;
+}
@@ -0,0 +1,1134 @@
+/**
+ * This file implements microbenchmarks of the packet, graph, queue and shortest path
+ * primitives, to give a before and after number for every change to them.
+ *
+ * Every benchmark is run at each of the given network sizes, on a random connected
+ * network of that many routers with an average of about four links each, both of their
+ * routers advertising every link. A benchmark is first run for a number of warmup
+ * repetitions, which also find how many runs fill a repetition of at least
+ * BENCH_MIN_NANOSECONDS, and then for the measured repetitions. The time per operation
+ * is reported as the minimum, percentiles and maximum over the repetitions, together
+ * with the median CPU cycles per operation where perf_event_open is available.
+ *
+ * Benchmarks:
+ * packet/encode - buildLSPacket for every packet of the network
+ * packet/decode - getSourceID, getDestinationID, getSequenceNumber and getCost of every packet
+ * graph/ingest  - addEdgeFromPacket of every packet into an empty graph
+ * graph/index   - getIndex of every router in a full graph, in a scattered order
+ * queue/push    - push of every packet into an empty FIFO queue, then pop of all of them
+ * queue/merge   - push of every packet, push of a newer packet for every link, then pop
+ * spf           - shortestPaths from a random router of the full graph
+ * flood/queue   - floodPacket of BENCH_FLOOD_PACKETS packets to BENCH_FANOUT neighbors'
+ *                 retransmission lists from pooled buffers, then an acknowledgement of
+ *                 every copy
+ * socket/sendto - floods of a packet to BENCH_FANOUT neighbors on loopback, each copy
+ *                 acknowledged, with a blocking call for every datagram of the router
+ * socket/uring  - the same floods with the router's datagrams going through an io_uring
+ * shm/ring      - the same floods and acknowledgements through the shared memory rings of
+ *                 neighbors on one host
+ * socket/rtt    - round trip of a datagram to an echoing thread over loopback
+ * shm/rtt       - the same round trip through shared memory rings, a hello through the
+ *                 socket waking whichever side waits on its socket as a router does
+ *
+ * The socket and ring benchmarks count every datagram the router sends and receives. The
+ * peer standing in for the neighbors answers with blocking calls in both socket floods,
+ * and the kernel's share of the work is timed, so the time per operation is the CPU time
+ * per datagram, as it is in shm/ring whose thread reads and writes both ends of the rings.
+ * The round trip benchmarks time one round trip per operation.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lsDijkstra.h"
+#include "lsFlood.h"
+#include "lsGraph.h"
+#include "lsNetwork.h"
+#include "lsPacket.h"
+#include "lsShm.h"
+
+// Default number of measured repetitions of a benchmark
+#define BENCH_REPETITIONS 50
+// Default number of warmup repetitions of a benchmark
+#define BENCH_WARMUP 5
+// Shortest repetition in nanoseconds, shorter runs are repeated within a repetition
+#define BENCH_MIN_NANOSECONDS 200000LL
+// Most network sizes benchmarked in one run
+#define BENCH_MAX_SIZES 16
+// Average number of links of a router, including those of the spanning tree
+#define BENCH_DEGREE 4
+// Neighbors a packet is flooded to in the socket benchmarks
+#define BENCH_FANOUT 8
+// Floods in a run of the socket benchmarks
+#define BENCH_FLOODS 16
+// Packets on the retransmission lists in a run of flood/queue
+#define BENCH_FLOOD_PACKETS 64
+// Microseconds waited for an acknowledgement before it is given up as lost
+#define BENCH_RECV_TIMEOUT 100000
+// Labels the router and the peer write their rings as
+#define BENCH_ROUTER 1
+#define BENCH_PEER 2
+
+struct Benchmark
+{
+	const char *name;
+	// Called before every timed run if a run changes what the next one starts from, may be NULL
+	void (*reset)();
+	// Timed, returns the number of operations performed
+	long long (*run)();
+};
+
+struct BenchResult
+{
+	long long runs;
+	long long operations;
+	double minimum;
+	double median;
+	double p90;
+	double p99;
+	double maximum;
+	// Median CPU cycles per operation, -1 if not counted
+	double cycles;
+};
+
+/**
+ * Gets the current time of a monotonic clock.
+ *
+ * @return - time in nanoseconds
+ */
+long long nanoTime();
+/**
+ * Opens a counter of the CPU cycles spent by this thread in user space.
+ *
+ * @return - file descriptor of counter, -1 if unavailable
+ */
+int openCycleCounter();
+/**
+ * Reads the CPU cycle counter.
+ *
+ * @return - cycles counted, 0 if unavailable
+ */
+long long readCycles();
+/**
+ * Generates a random connected network and the link-state packets of its routers.
+ *
+ * @param size - number of routers
+ *
+ * @return - 0 if success, -1 if error
+ */
+int generateNetwork(int size);
+/**
+ * Frees the network and the structures built from it.
+ */
+void freeNetwork();
+/**
+ * Builds a graph of the whole network.
+ *
+ * @return - pointer to graph, NULL if error
+ */
+struct Graph *buildGraph();
+/**
+ * Runs a benchmark for the warmup and measured repetitions.
+ *
+ * @param benchmark - benchmark being run
+ * @param result    - where the results will be stored
+ *
+ * @return - 0 if success, -1 if error
+ */
+int runBenchmark(struct Benchmark *benchmark, struct BenchResult *result);
+/**
+ * Compares two doubles, used to sort the repetitions.
+ *
+ * @param a - pointer to first double
+ * @param b - pointer to second double
+ *
+ * @return - negative, zero or positive as a is less than, equal to or greater than b
+ */
+int compareDoubles(const void *a, const void *b);
+/**
+ * Gets a percentile of sorted values by nearest rank.
+ *
+ * @param values  - sorted values
+ * @param count   - number of values
+ * @param percent - percentile
+ *
+ * @return - value at percentile
+ */
+double percentile(double *values, int count, double percent);
+/**
+ * Encodes every packet of the network.
+ *
+ * @return - number of packets encoded
+ */
+long long runEncode();
+/**
+ * Decodes the fields of every packet of the network.
+ *
+ * @return - number of packets decoded
+ */
+long long runDecode();
+/**
+ * Replaces the ingest graph with an empty graph.
+ */
+void resetIngest();
+/**
+ * Adds every packet of the network to the ingest graph.
+ *
+ * @return - number of packets added
+ */
+long long runIngest();
+/**
+ * Looks up the index of every router of the network.
+ *
+ * @return - number of routers looked up
+ */
+long long runIndex();
+/**
+ * Pushes every packet of the network to the queue and pops them again.
+ *
+ * @return - number of packets pushed and popped
+ */
+long long runPush();
+/**
+ * Pushes every packet of the network to the queue, pushes a newer packet for every link
+ * to merge with it and pops them all again.
+ *
+ * @return - number of packets pushed
+ */
+long long runMerge();
+/**
+ * Calculates the shortest paths from a random router of the network.
+ *
+ * @return - 1
+ */
+long long runShortestPaths();
+/**
+ * Floods packets to the retransmission lists of the neighbors and acknowledges them.
+ *
+ * @return - number of copies queued and acknowledged
+ */
+long long runFloodQueue();
+/**
+ * Opens the sockets of the router and the peer on loopback, and an io_uring for the
+ * router's socket where the kernel supports it.
+ *
+ * @return - 0 if success, -1 if error
+ */
+int openSockets();
+/**
+ * Floods packets from a router socket to the peer, which acknowledges every copy, and
+ * takes the acknowledgements.
+ *
+ * @param socket - socket of the router
+ * @param ring   - io_uring of the socket, NULL for blocking calls
+ *
+ * @return - number of datagrams the router sent and received
+ */
+long long floodSockets(int socket, struct Uring *ring);
+/**
+ * Floods packets with blocking calls.
+ *
+ * @return - number of datagrams sent and received
+ */
+long long runSocketBlocking();
+/**
+ * Floods packets through the io_uring.
+ *
+ * @return - number of datagrams sent and received
+ */
+long long runSocketUring();
+/**
+ * Creates the rings between the router and the peer, and starts the thread echoing the
+ * round trip benchmarks.
+ *
+ * @return - 0 if success, -1 if shared memory is unavailable
+ */
+int openRings();
+/**
+ * Floods packets through a ring to the peer, which acknowledges every copy through
+ * another ring, and takes the acknowledgements.
+ *
+ * @return - number of datagrams the router wrote and read
+ */
+long long runShmRing();
+/**
+ * Thread function echoing every datagram received through its socket or ring back the
+ * way it came, waiting on its socket as the network thread of a router does.
+ *
+ * @param param - unused
+ */
+void *echoThread(void *param);
+/**
+ * Writes a datagram to a ring, waking its reader with a hello through a socket if it waits.
+ *
+ * @param ring     - ring written to
+ * @param socket   - socket the hello is sent from
+ * @param port     - port of the reader's socket
+ * @param datagram - datagram being sent
+ * @param length   - length of datagram in bytes
+ *
+ * @return - 0 if written, -1 if not
+ */
+int writeRing(struct ShmRing *ring, int socket, int port, const char *datagram, int length);
+/**
+ * Waits for the next datagram of a ring, sleeping on a socket while the ring is empty.
+ *
+ * @param ring     - ring read from
+ * @param socket   - socket of the reader
+ * @param datagram - buffer of LS_DATAGRAM_SIZE bytes where the datagram will be stored
+ *
+ * @return - length of datagram, 0 if none arrived within BENCH_RECV_TIMEOUT
+ */
+int waitRing(struct ShmRing *ring, int socket, char *datagram);
+/**
+ * Sends a datagram to the echoing thread over loopback and waits for it to come back.
+ *
+ * @return - 1
+ */
+long long runSocketRoundTrip();
+/**
+ * Writes a datagram to the echoing thread's ring and waits for it to come back through
+ * the router's ring.
+ *
+ * @return - 1
+ */
+long long runShmRoundTrip();
+/**
+ * Parses the command line arguments and stores the results in the parameters.
+ *
+ * @param argc   - number of arguments
+ * @param argv   - argument vector
+ * @param filter - prefix of the names of the benchmarks run, NULL for all
+ * @param sizes  - network sizes
+ * @param count  - number of network sizes
+ * @param seed   - seed of the random number generator
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, char **filter, int *sizes, int *count, unsigned int *seed);
+
+struct Benchmark benchmarks[] = {
+	{ "packet/encode", NULL, runEncode },
+	{ "packet/decode", NULL, runDecode },
+	{ "graph/ingest", resetIngest, runIngest },
+	{ "graph/index", NULL, runIndex },
+	{ "queue/push", NULL, runPush },
+	{ "queue/merge", NULL, runMerge },
+	{ "spf", NULL, runShortestPaths },
+	{ "flood/queue", NULL, runFloodQueue },
+	{ "socket/sendto", NULL, runSocketBlocking },
+	{ "socket/uring", NULL, runSocketUring },
+	{ "shm/ring", NULL, runShmRing },
+	{ "socket/rtt", NULL, runSocketRoundTrip },
+	{ "shm/rtt", NULL, runShmRoundTrip },
+};
+
+// Number of measured and warmup repetitions of each benchmark
+int repetitions;
+int warmup;
+// Counter of CPU cycles, -1 if unavailable
+int cycleFd = -1;
+// Network being benchmarked, packet i of a link advertised by both of its routers
+int routerCount;
+int packetCount;
+uint16_t *labels;
+uint16_t *sources;
+uint16_t *destinations;
+int *costs;
+char *packets;
+// Newer packet for every link, merged with the packets in queue/merge
+char *newerPackets;
+// Structures built from the network
+struct Graph *graph;
+struct Graph *ingestGraph;
+struct FifoQueue *queue;
+int *spfCost;
+int *spfHop;
+// Results folded into this so the compiler keeps the work being measured
+volatile long long sink;
+// Neighbors packets are flooded to in flood/queue
+struct NeighborList *floodNeighbors;
+// Sockets of the socket benchmarks, the router's having its own for each backend so the
+// armed receive of the ring does not take the datagrams of the blocking calls
+int blockingSocket;
+int ringSocket;
+int peerSocket;
+int peerPort;
+// Ring of the router's socket, NULL if io_uring is unavailable
+struct Uring *benchRing;
+// Socket of the thread echoing the round trips, and the ports of the router and the thread
+int echoSocket;
+int routerPort;
+int echoPort;
+// Rings from the router to the peer and back, each with a handle to write and to read,
+// NULL if shared memory is unavailable
+struct ShmRing *routerWriter;
+struct ShmRing *peerReader;
+struct ShmRing *peerWriter;
+struct ShmRing *routerReader;
+// Rings of shm/ring, whose thread is both the router flooding through one and the peer
+// acknowledging through the other
+struct ShmRing *floodWriter;
+struct ShmRing *floodReader;
+struct ShmRing *ackWriter;
+struct ShmRing *ackReader;
+
+int main(int argc, char **argv)
+{
+	int i, j, count, sizes[BENCH_MAX_SIZES];
+	unsigned int seed;
+	char *filter;
+	struct BenchResult result;
+
+	if (parseCommandLine(argc, argv, &filter, sizes, &count, &seed) < 0)
+		exit(EXIT_FAILURE);
+
+	srand(seed);
+
+	if ((cycleFd = openCycleCounter()) < 0)
+		fprintf(stderr, "Cycle counter unavailable (%s), cycles are not reported\n", strerror(errno));
+
+	if (openSockets() < 0)
+		exit(EXIT_FAILURE);
+
+	if (openRings() < 0)
+		fprintf(stderr, "Shared memory unavailable, the shm benchmarks are not run\n");
+
+	if (!(floodNeighbors = newNeighborList()))
+	{
+		printf("Malloc failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < BENCH_FANOUT; i++)
+	{
+		addToList(floodNeighbors, newNeighbor(i + 1, "127.0.0.1", 0, 1));
+		floodNeighbors->head->state = NEIGHBOR_FULL;
+	}
+
+	printf("%-14s %6s %8s %10s %10s %10s %10s %10s %10s\n", "benchmark", "size", "ops",
+	       "min ns", "p50 ns", "p90 ns", "p99 ns", "max ns", "p50 cycles");
+
+	for (i = 0; i < count; i++)
+	{
+		if (generateNetwork(sizes[i]) < 0)
+		{
+			fprintf(stderr, "Could not generate a network of %d routers\n", sizes[i]);
+			exit(EXIT_FAILURE);
+		}
+
+		for (j = 0; j < sizeof(benchmarks) / sizeof(benchmarks[0]); j++)
+		{
+			if (filter && strncmp(benchmarks[j].name, filter, strlen(filter)))
+				continue;
+
+			if (benchmarks[j].run == runSocketUring && !benchRing)
+				continue;
+
+			if (!strncmp(benchmarks[j].name, "shm/", 4) && !peerReader)
+				continue;
+
+			if (runBenchmark(&benchmarks[j], &result) < 0)
+			{
+				fprintf(stderr, "Could not run %s\n", benchmarks[j].name);
+				exit(EXIT_FAILURE);
+			}
+
+			printf("%-14s %6d %8lld %10.1f %10.1f %10.1f %10.1f %10.1f ", benchmarks[j].name, routerCount,
+			       result.operations, result.minimum, result.median, result.p90, result.p99, result.maximum);
+			if (result.cycles < 0)
+				printf("%10s\n", "-");
+			else
+				printf("%10.1f\n", result.cycles);
+		}
+
+		freeNetwork();
+	}
+
+	closeShmRing(routerWriter);
+	closeShmRing(peerReader);
+	closeShmRing(peerWriter);
+	closeShmRing(routerReader);
+	closeShmRing(floodWriter);
+	closeShmRing(floodReader);
+	closeShmRing(ackWriter);
+	closeShmRing(ackReader);
+
+	exit(EXIT_SUCCESS);
+}
+
+long long nanoTime()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int openCycleCounter()
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+long long readCycles()
+{
+	long long cycles;
+
+	if (cycleFd < 0 || read(cycleFd, &cycles, sizeof(cycles)) != sizeof(cycles))
+		return 0;
+
+	return cycles;
+}
+
+int generateNetwork(int size)
+{
+	int i, a, b, links;
+
+	routerCount = size;
+	links = size * BENCH_DEGREE / 2;
+	packetCount = 2 * links;
+
+	labels = (uint16_t *) malloc(size * sizeof(uint16_t));
+	sources = (uint16_t *) malloc(packetCount * sizeof(uint16_t));
+	destinations = (uint16_t *) malloc(packetCount * sizeof(uint16_t));
+	costs = (int *) malloc(packetCount * sizeof(int));
+	packets = (char *) malloc(packetCount * LS_PACKET_SIZE);
+	newerPackets = (char *) malloc(packetCount * LS_PACKET_SIZE);
+	spfCost = (int *) malloc(size * sizeof(int));
+	spfHop = (int *) malloc(size * sizeof(int));
+
+	if (!labels || !sources || !destinations || !costs || !packets || !newerPackets || !spfCost || !spfHop)
+		return -1;
+
+	for (i = 0; i < size; i++)
+		labels[i] = i + 1;
+
+	// A random spanning tree keeps the network connected, the remaining links are random
+	for (i = 0; i < links; i++)
+	{
+		if (i < size - 1)
+		{
+			a = i + 1;
+			b = rand() % a;
+		}
+		else
+		{
+			a = rand() % size;
+			b = (a + 1 + rand() % (size - 1)) % size;
+		}
+
+		sources[2 * i] = destinations[2 * i + 1] = labels[a];
+		destinations[2 * i] = sources[2 * i + 1] = labels[b];
+		costs[2 * i] = costs[2 * i + 1] = 1 + rand() % 10;
+	}
+
+	for (i = 0; i < packetCount; i++)
+	{
+		buildLSPacket(packets + i * LS_PACKET_SIZE, LS_INITIAL_SEQUENCE, sources[i], destinations[i], costs[i]);
+		buildLSPacket(newerPackets + i * LS_PACKET_SIZE, nextSequence(LS_INITIAL_SEQUENCE),
+		              sources[i], destinations[i], costs[i]);
+	}
+
+	if (!(graph = buildGraph()) || !(ingestGraph = newGraph(size, 0)))
+		return -1;
+
+	if (!(queue = newFifoQueue(packetCount, 0)))
+		return -1;
+
+	return 0;
+}
+
+void freeNetwork()
+{
+	free(labels);
+	free(sources);
+	free(destinations);
+	free(costs);
+	free(packets);
+	free(newerPackets);
+	free(spfCost);
+	free(spfHop);
+	freeGraph(graph);
+	freeGraph(ingestGraph);
+	free(queue->nodes);
+	free(queue->index);
+	free(queue);
+}
+
+struct Graph *buildGraph()
+{
+	int i;
+	struct Graph *built = newGraph(routerCount, 0);
+
+	if (!built)
+		return NULL;
+
+	for (i = 0; i < packetCount; i++)
+	{
+		if (addEdgeFromPacket(built, packets + i * LS_PACKET_SIZE) < 0)
+		{
+			freeGraph(built);
+			return NULL;
+		}
+	}
+
+	return built;
+}
+
+int runBenchmark(struct Benchmark *benchmark, struct BenchResult *result)
+{
+	int i, rep;
+	long long runs, start, elapsed, cycles, operations = 0;
+	double *times, *cyclesPerOperation;
+
+	times = (double *) malloc(repetitions * sizeof(double));
+	cyclesPerOperation = (double *) malloc(repetitions * sizeof(double));
+
+	if (!times || !cyclesPerOperation)
+	{
+		free(times);
+		free(cyclesPerOperation);
+		return -1;
+	}
+
+	// Warmup repetitions run once each and find how many runs fill a repetition.
+	// A benchmark that is reset before every run is timed one run at a time.
+	runs = 1;
+	for (rep = 0; rep < warmup; rep++)
+	{
+		if (benchmark->reset)
+			benchmark->reset();
+
+		start = nanoTime();
+		benchmark->run();
+		elapsed = nanoTime() - start;
+
+		if (!benchmark->reset && elapsed > 0 && BENCH_MIN_NANOSECONDS / elapsed + 1 > runs)
+			runs = BENCH_MIN_NANOSECONDS / elapsed + 1;
+	}
+
+	for (rep = 0; rep < repetitions; rep++)
+	{
+		if (benchmark->reset)
+			benchmark->reset();
+
+		operations = 0;
+		cycles = readCycles();
+		start = nanoTime();
+
+		for (i = 0; i < runs; i++)
+			operations += benchmark->run();
+
+		elapsed = nanoTime() - start;
+		cycles = readCycles() - cycles;
+
+		times[rep] = (double) elapsed / operations;
+		cyclesPerOperation[rep] = (double) cycles / operations;
+	}
+
+	qsort(times, repetitions, sizeof(double), compareDoubles);
+	qsort(cyclesPerOperation, repetitions, sizeof(double), compareDoubles);
+
+	result->runs = runs;
+	result->operations = operations / runs;
+	result->minimum = times[0];
+	result->median = percentile(times, repetitions, 50);
+	result->p90 = percentile(times, repetitions, 90);
+	result->p99 = percentile(times, repetitions, 99);
+	result->maximum = times[repetitions - 1];
+	result->cycles = cycleFd < 0 ? -1 : percentile(cyclesPerOperation, repetitions, 50);
+
+	free(times);
+	free(cyclesPerOperation);
+
+	return 0;
+}
+
+int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+double percentile(double *values, int count, double percent)
+{
+	int rank = (int) (percent / 100 * count + 0.999999);
+
+	if (rank < 1)
+		rank = 1;
+
+	return values[rank - 1];
+}
+
+long long runEncode()
+{
+	int i;
+
+	for (i = 0; i < packetCount; i++)
+		buildLSPacket(packets + i * LS_PACKET_SIZE, LS_INITIAL_SEQUENCE, sources[i], destinations[i], costs[i]);
+
+	sink += packets[LS_PACKET_SIZE - 1];
+
+	return packetCount;
+}
+
+long long runDecode()
+{
+	int i;
+	long long sum = 0;
+	char *packet;
+
+	for (i = 0; i < packetCount; i++)
+	{
+		packet = packets + i * LS_PACKET_SIZE;
+		sum += getSourceID(packet) + getDestinationID(packet) + getSequenceNumber(packet) + getCost(packet);
+	}
+
+	sink += sum;
+
+	return packetCount;
+}
+
+void resetIngest()
+{
+	freeGraph(ingestGraph);
+
+	if (!(ingestGraph = newGraph(routerCount, 0)))
+	{
+		printf("Malloc failed.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+long long runIngest()
+{
+	int i;
+
+	for (i = 0; i < packetCount; i++)
+		addEdgeFromPacket(ingestGraph, packets + i * LS_PACKET_SIZE);
+
+	return packetCount;
+}
+
+long long runIndex()
+{
+	int i;
+	long long sum = 0;
+
+	// Labels were assigned in the order the packets named them, so look them up in another
+	for (i = 0; i < routerCount; i++)
+		sum += getIndex(graph, labels[(i * 7919LL) % routerCount]);
+
+	sink += sum;
+
+	return routerCount;
+}
+
+long long runPush()
+{
+	int i;
+	uint16_t peer;
+	char buffer[LS_PACKET_SIZE];
+
+	for (i = 0; i < packetCount; i++)
+		push(queue, QUEUE_UPDATE, sources[i], packets + i * LS_PACKET_SIZE, PRIORITY_BULK);
+
+	while (pop(queue, buffer, &peer))
+		;
+
+	sink += peer;
+
+	return packetCount;
+}
+
+long long runMerge()
+{
+	int i;
+	uint16_t peer;
+	char buffer[LS_PACKET_SIZE];
+
+	for (i = 0; i < packetCount; i++)
+		push(queue, QUEUE_UPDATE, sources[i], packets + i * LS_PACKET_SIZE, PRIORITY_BULK);
+
+	for (i = 0; i < packetCount; i++)
+		push(queue, QUEUE_UPDATE, sources[i], newerPackets + i * LS_PACKET_SIZE, PRIORITY_BULK);
+
+	while (pop(queue, buffer, &peer))
+		;
+
+	sink += peer;
+
+	return 2 * packetCount;
+}
+
+long long runShortestPaths()
+{
+	shortestPaths(graph, labels[rand() % routerCount], spfCost, spfHop);
+
+	sink += spfCost[0];
+
+	return 1;
+}
+
+long long runFloodQueue()
+{
+	int i, count;
+	long long now = currentTime();
+	struct Neighbor *neighbor;
+	struct PacketBuffer *buffer;
+
+	count = packetCount < BENCH_FLOOD_PACKETS ? packetCount : BENCH_FLOOD_PACKETS;
+
+	for (i = 0; i < count; i++)
+	{
+		if (!(buffer = takeBuffer()))
+		{
+			printf("Malloc failed.\n");
+			exit(EXIT_FAILURE);
+		}
+		memcpy(buffer->packet, packets + i * LS_PACKET_SIZE, LS_PACKET_SIZE);
+		floodPacket(floodNeighbors, buffer, LS_ROUTER_NONE, 1, 0, now);
+		releaseBuffer(buffer);
+	}
+
+	// Acknowledged in the order they were queued, so each is found at the head of its list
+	for (neighbor = floodNeighbors->head; neighbor; neighbor = neighbor->next)
+		for (i = 0; i < count; i++)
+			acknowledgePacket(neighbor, packets + i * LS_PACKET_SIZE, now);
+
+	return 2 * count * BENCH_FANOUT;
+}
+
+int openSockets()
+{
+	struct sockaddr_in address;
+	socklen_t length = sizeof(address);
+
+	// Bound to any free port, which the peer's is read back from
+	if ((blockingSocket = initializeSocket(0)) < 0 || (ringSocket = initializeSocket(0)) < 0 ||
+	    (peerSocket = initializeSocket(0)) < 0)
+		return -1;
+
+	if (getsockname(peerSocket, (struct sockaddr *) &address, &length) < 0)
+	{
+		perror("Getsockname failed");
+		return -1;
+	}
+	peerPort = ntohs(address.sin_port);
+
+	if (!(benchRing = newUring(ringSocket, 0)))
+		fprintf(stderr, "io_uring unavailable, socket/uring is not run\n");
+
+	return 0;
+}
+
+int openRings()
+{
+	int err;
+	long long now = currentTime();
+	pthread_t echo_thread;
+	struct sockaddr_in address;
+	socklen_t length = sizeof(address);
+
+	if ((echoSocket = initializeSocket(0)) < 0 || getsockname(echoSocket, (struct sockaddr *) &address, &length) < 0)
+		return -1;
+	echoPort = ntohs(address.sin_port);
+
+	length = sizeof(address);
+	if (getsockname(blockingSocket, (struct sockaddr *) &address, &length) < 0)
+		return -1;
+	routerPort = ntohs(address.sin_port);
+
+	// Each ring is created by its reader and opened by its writer, as between two routers
+	if (!(peerReader = createShmRing(echoPort, BENCH_ROUTER, now)) || !(routerWriter = openShmRing(echoPort, BENCH_ROUTER)) ||
+	    !(routerReader = createShmRing(routerPort, BENCH_PEER, now)) || !(peerWriter = openShmRing(routerPort, BENCH_PEER)) ||
+	    !(floodReader = createShmRing(peerPort, BENCH_ROUTER, now)) || !(floodWriter = openShmRing(peerPort, BENCH_ROUTER)) ||
+	    !(ackReader = createShmRing(peerPort, BENCH_PEER, now)) || !(ackWriter = openShmRing(peerPort, BENCH_PEER)))
+	{
+		peerReader = NULL;
+		return -1;
+	}
+
+	if ((err = pthread_create(&echo_thread, NULL, &echoThread, NULL)))
+	{
+		fprintf(stderr, "Can't create Echo Thread: [%s]\n", strerror(err));
+		return -1;
+	}
+
+	return 0;
+}
+
+long long runShmRing()
+{
+	int i, j, length;
+	long long sum = 0;
+	long long now = currentTime();
+	char datagram[LS_DATAGRAM_SIZE], ack[LS_DATAGRAM_SIZE];
+
+	length = LS_HEADER_SIZE + LS_PACKET_SIZE;
+
+	// Both readers look at their empty rings first, as a router does every pass, so
+	// neither is taken to be gone after the benchmarks run in between
+	readShmRing(floodReader, ack, now);
+	readShmRing(ackReader, ack, now);
+
+	for (i = 0; i < BENCH_FLOODS; i++)
+	{
+		buildHeader(datagram, LS_TYPE_UPDATE, sources[i % packetCount], 1);
+		memcpy(datagram + LS_HEADER_SIZE, packets + (i % packetCount) * LS_PACKET_SIZE, LS_PACKET_SIZE);
+
+		// The ring to the peer stands in for every neighbor the packet is flooded to
+		for (j = 0; j < BENCH_FANOUT; j++)
+			writeShmRing(floodWriter, datagram, length, now);
+
+		for (j = 0; j < BENCH_FANOUT; j++)
+		{
+			if (readShmRing(floodReader, ack, now) <= 0)
+				continue;
+			buildHeader(ack, LS_TYPE_ACK, getDestinationID(ack + LS_HEADER_SIZE), 1);
+			writeShmRing(ackWriter, ack, length, now);
+		}
+
+		for (j = 0; j < BENCH_FANOUT; j++)
+			sum += readShmRing(ackReader, ack, now);
+	}
+
+	sink += sum;
+
+	return 2 * BENCH_FLOODS * BENCH_FANOUT;
+}
+
+void *echoThread(void *param)
+{
+	int length;
+	char datagram[LS_DATAGRAM_SIZE];
+	struct sockaddr_in source;
+	socklen_t sourceLength;
+
+	while (1)
+	{
+		while ((length = readShmRing(peerReader, datagram, currentTime())) > 0)
+		{
+			buildHeader(datagram, LS_TYPE_ACK, BENCH_PEER, 1);
+			writeRing(peerWriter, echoSocket, routerPort, datagram, length);
+		}
+
+		sourceLength = sizeof(source);
+		length = recvfrom(echoSocket, datagram, LS_DATAGRAM_SIZE, sleepShmRing(peerReader) ? 0 : MSG_DONTWAIT,
+		                  (struct sockaddr *) &source, &sourceLength);
+		wakeShmRing(peerReader);
+
+		// Hellos only wake the thread, anything else is echoed back over loopback
+		if (length > LS_HEADER_SIZE)
+			sendto(echoSocket, datagram, length, 0, (struct sockaddr *) &source, sourceLength);
+	}
+
+	return NULL;
+}
+
+int writeRing(struct ShmRing *ring, int socket, int port, const char *datagram, int length)
+{
+	int written;
+	char hello[LS_HEADER_SIZE];
+
+	if ((written = writeShmRing(ring, datagram, length, currentTime())) == SHM_WAKE)
+	{
+		buildHeader(hello, LS_TYPE_HELLO, getSenderID((char *) datagram), 0);
+		sendPacket(socket, hello, LS_HEADER_SIZE, "127.0.0.1", port);
+	}
+
+	return written < 0 ? -1 : 0;
+}
+
+int waitRing(struct ShmRing *ring, int socket, char *datagram)
+{
+	int length;
+	char hello[LS_DATAGRAM_SIZE];
+	long long start = currentTime(), now;
+
+	while ((length = readShmRing(ring, datagram, now = currentTime())) == 0 && now - start < BENCH_RECV_TIMEOUT)
+	{
+		if (sleepShmRing(ring))
+			recv(socket, hello, LS_DATAGRAM_SIZE, 0);
+		wakeShmRing(ring);
+	}
+
+	return length;
+}
+
+long long runSocketRoundTrip()
+{
+	int length;
+	char datagram[LS_DATAGRAM_SIZE];
+	long long start = currentTime();
+
+	buildHeader(datagram, LS_TYPE_UPDATE, BENCH_ROUTER, 1);
+	memcpy(datagram + LS_HEADER_SIZE, packets, LS_PACKET_SIZE);
+	sendPacket(blockingSocket, datagram, LS_HEADER_SIZE + LS_PACKET_SIZE, "127.0.0.1", echoPort);
+
+	// Hellos left over from the ring benchmarks are skipped
+	while ((length = recv(blockingSocket, datagram, LS_DATAGRAM_SIZE, 0)) <= LS_HEADER_SIZE &&
+	       currentTime() - start < BENCH_RECV_TIMEOUT)
+		;
+
+	sink += length;
+
+	return 1;
+}
+
+long long runShmRoundTrip()
+{
+	char datagram[LS_DATAGRAM_SIZE];
+
+	// The router looks at its empty ring first, as a router does every pass
+	readShmRing(routerReader, datagram, currentTime());
+
+	buildHeader(datagram, LS_TYPE_UPDATE, BENCH_ROUTER, 1);
+	memcpy(datagram + LS_HEADER_SIZE, packets, LS_PACKET_SIZE);
+	writeRing(routerWriter, blockingSocket, echoPort, datagram, LS_HEADER_SIZE + LS_PACKET_SIZE);
+
+	sink += waitRing(routerReader, blockingSocket, datagram);
+
+	return 1;
+}
+
+long long floodSockets(int socket, struct Uring *ring)
+{
+	int i, j, length;
+	long long sum = 0;
+	char datagram[LS_DATAGRAM_SIZE], ack[LS_DATAGRAM_SIZE], *received;
+	struct sockaddr_in source;
+	socklen_t sourceLength;
+
+	threadRing = ring;
+	length = LS_HEADER_SIZE + LS_PACKET_SIZE;
+
+	for (i = 0; i < BENCH_FLOODS; i++)
+	{
+		buildHeader(datagram, LS_TYPE_UPDATE, sources[i % packetCount], 1);
+		memcpy(datagram + LS_HEADER_SIZE, packets + (i % packetCount) * LS_PACKET_SIZE, LS_PACKET_SIZE);
+
+		// The peer socket stands in for every neighbor the packet is flooded to
+		for (j = 0; j < BENCH_FANOUT; j++)
+			sendPacket(socket, datagram, length, "127.0.0.1", peerPort);
+		if (ring)
+			enterUring(ring, 0, 0);
+
+		for (j = 0; j < BENCH_FANOUT; j++)
+		{
+			sourceLength = sizeof(source);
+			if (recvfrom(peerSocket, ack, LS_DATAGRAM_SIZE, 0, (struct sockaddr *) &source, &sourceLength) <= 0)
+				continue;
+			buildHeader(ack, LS_TYPE_ACK, getDestinationID(ack + LS_HEADER_SIZE), 1);
+			sendto(peerSocket, ack, length, 0, (struct sockaddr *) &source, sourceLength);
+		}
+
+		for (j = 0; j < BENCH_FANOUT; j++)
+		{
+			if (ring)
+				sum += receiveUring(ring, &received, BENCH_RECV_TIMEOUT);
+			else
+				sum += recv(socket, datagram, LS_DATAGRAM_SIZE, 0);
+		}
+	}
+
+	threadRing = NULL;
+	sink += sum;
+
+	return 2 * BENCH_FLOODS * BENCH_FANOUT;
+}
+
+long long runSocketBlocking()
+{
+	return floodSockets(blockingSocket, NULL);
+}
+
+long long runSocketUring()
+{
+	return floodSockets(ringSocket, benchRing);
+}
+
+int parseCommandLine(int argc, char **argv, char **filter, int *sizes, int *count, unsigned int *seed)
+{
+	int i;
+	char *size;
+
+	*filter = NULL;
+	*seed = 1;
+	repetitions = BENCH_REPETITIONS;
+	warmup = BENCH_WARMUP;
+	sizes[0] = 16;
+	sizes[1] = 256;
+	sizes[2] = 4096;
+	*count = 3;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (argv[i][0] != '-')
+		{
+			*filter = argv[i];
+			continue;
+		}
+
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "Missing value of %s\n", argv[i]);
+			return -1;
+		}
+
+		if (!strcmp(argv[i], "-reps"))
+			repetitions = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-warmup"))
+			warmup = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed"))
+			*seed = strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-sizes"))
+		{
+			*count = 0;
+			for (size = strtok(argv[++i], DELIM); size && *count < BENCH_MAX_SIZES; size = strtok(NULL, DELIM))
+			{
+				sizes[*count] = atoi(size);
+				if (sizes[*count] < 2 || sizes[*count] > LS_MAX_ROUTER_ID)
+				{
+					fprintf(stderr, "Network sizes must be from 2 to %d routers\n", LS_MAX_ROUTER_ID);
+					return -1;
+				}
+				(*count)++;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s. Use format:\n"
+			                "[benchmark prefix] [-reps n] [-warmup n] [-sizes n,n,...] [-seed n]\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (repetitions < 1 || warmup < 1 || !*count)
+	{
+		fprintf(stderr, "At least one repetition, warmup repetition and network size are needed\n");
+		return -1;
+	}
+
+	return 0;
+}
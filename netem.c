@@ -0,0 +1,856 @@
+/**
+ * This file implements a network emulator standing between the routers of a topology on
+ * loopback, so their convergence can be measured over links that lose, delay, duplicate
+ * and reorder datagrams.
+ *
+ * The neighbor files of a topology directory are rewritten into an output directory with
+ * every router's address replaced by a port of the emulator. A router reads its rewritten
+ * file and sends to the emulator, which forwards each datagram to the address and port the
+ * original files give for the router after impairing it. Routers tell their neighbors
+ * apart by the sender in the datagram header, so the emulator only needs one port per
+ * router, and the link a datagram crosses is the sender and the router of the port.
+ *
+ * Loss     - percent of datagrams dropped
+ * Delay    - milliseconds a datagram is held before it is forwarded
+ * Jitter   - the delay varies uniformly by up to this many milliseconds either way
+ * Duplicate - percent of datagrams forwarded twice, each copy with its own delay
+ * Reorder  - percent of datagrams held back until the next datagram on their link has
+ *            been forwarded, or for NETEM_REORDER_HOLD if none follows
+ *
+ * Every datagram and what was done to it can be logged, and the totals of each link are
+ * printed when the emulator is interrupted.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+#include "lsNetwork.h"
+#include "lsPacket.h"
+#include "lsTimer.h"
+
+// Default first port of the emulator, one is used per router
+#define NETEM_PORT 61000
+// Default address the rewritten neighbor files send to
+#define NETEM_HOST "127.0.0.1"
+// Longest time in microseconds a reordered datagram waits for the next one
+#define NETEM_REORDER_HOLD 50000
+
+struct Impairment
+{
+	// Percent chances of dropping, duplicating and reordering a datagram
+	double loss;
+	double duplicate;
+	double reorder;
+	// Microseconds of delay and its variation
+	long long delay;
+	long long jitter;
+};
+
+struct ProxyLink
+{
+	uint16_t source;
+	struct ProxyRouter *dest;
+	struct Impairment impairment;
+	// Datagram held back to be reordered, NULL if none
+	struct Pending *held;
+	long long received;
+	long long dropped;
+	long long duplicated;
+	long long reordered;
+	long long forwarded;
+	// Sum of the times the forwarded datagrams were held in microseconds
+	long long delayed;
+};
+
+struct ProxyRouter
+{
+	uint16_t label;
+	char name[NAME_MAX + 1];
+	// Address and port the router listens on
+	struct sockaddr_in address;
+	int hasAddress;
+	int proxyPort;
+	int fd;
+	struct NeighborList *neighbors;
+	// Links leading to the router, one per sender seen
+	struct ProxyLink *links;
+	int linkCount;
+	int linkSize;
+};
+
+struct Pending
+{
+	struct Timer timer;
+	struct ProxyLink *link;
+	// Time in microseconds the datagram was received
+	long long received;
+	int length;
+	char datagram[LS_DATAGRAM_SIZE];
+};
+
+/**
+ * Reads the neighbor file of every router in a topology directory.
+ *
+ * @param directory - directory holding the neighbor files
+ *
+ * @return - 0 if success, -1 if error
+ */
+int loadTopology(const char *directory);
+/**
+ * Writes the neighbor files of every router with their neighbors' addresses replaced by
+ * the emulator's ports.
+ *
+ * @param directory - directory the files are written to
+ * @param host      - address of the emulator written to the files
+ *
+ * @return - 0 if success, -1 if error
+ */
+int writeProxyFiles(const char *directory, const char *host);
+/**
+ * Finds the link from a sender to a router, adding it if it has not been seen.
+ *
+ * @param router - router the link leads to
+ * @param source - label of router the link leaves
+ *
+ * @return - pointer to link, NULL if error
+ */
+struct ProxyLink *findLink(struct ProxyRouter *router, uint16_t source);
+/**
+ * Parses the impairment of a link, a comma separated list of name=value settings.
+ *
+ * @param spec       - text of impairment
+ * @param impairment - impairment the settings are stored to
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseImpairment(const char *spec, struct Impairment *impairment);
+/**
+ * Sets the impairment of the links named by a -link option, A,B for both directions of a
+ * link and A>B for only one.
+ *
+ * @param link - routers of link
+ * @param spec - text of impairment
+ *
+ * @return - 0 if success, -1 if error
+ */
+int setLinkImpairment(const char *link, const char *spec);
+/**
+ * Receives every datagram waiting at a router's port and impairs it.
+ *
+ * @param router - router the datagrams are sent to
+ */
+void receiveDatagrams(struct ProxyRouter *router);
+/**
+ * Decides what happens to a datagram crossing a link and schedules its forwarding.
+ *
+ * @param link     - link crossed
+ * @param datagram - datagram received
+ * @param length   - length of datagram
+ */
+void impairDatagram(struct ProxyLink *link, const char *datagram, int length);
+/**
+ * Schedules a copy of a datagram to be forwarded after a delay.
+ *
+ * @param link     - link crossed
+ * @param datagram - datagram received
+ * @param length   - length of datagram
+ * @param delay    - microseconds until it is forwarded
+ *
+ * @return - pointer to scheduled datagram, NULL if it was forwarded at once or error
+ */
+struct Pending *scheduleDatagram(struct ProxyLink *link, const char *datagram, int length, long long delay);
+/**
+ * Forwards a scheduled datagram to its router, the callback of its timer.
+ *
+ * @param arg - scheduled datagram
+ */
+void forwardDatagram(void *arg);
+/**
+ * Picks the delay of a datagram on a link.
+ *
+ * @param impairment - impairment of link
+ *
+ * @return - delay in microseconds
+ */
+long long randomDelay(struct Impairment *impairment);
+/**
+ * Returns 1 with a chance in percent.
+ *
+ * @param percent - chance
+ *
+ * @return - 1 or 0
+ */
+int chance(double percent);
+/**
+ * Writes a line about a datagram to the log, if one is open.
+ *
+ * @param link     - link crossed
+ * @param datagram - datagram
+ * @param action   - what was done to it
+ * @param delay    - delay in microseconds, -1 if none is logged
+ */
+void logDatagram(struct ProxyLink *link, char *datagram, const char *action, long long delay);
+/**
+ * Prints the totals of every link that carried a datagram.
+ */
+void printTotals();
+/**
+ * Stops the emulator, the handler of SIGINT and SIGTERM.
+ *
+ * @param sig - signal received
+ */
+void stopEmulator(int sig);
+/**
+ * Parses the command line arguments and stores the results in the parameters.
+ *
+ * @param argc      - number of arguments
+ * @param argv      - argument vector
+ * @param directory - directory holding the neighbor files
+ * @param output    - directory the rewritten files are written to
+ * @param host      - address of the emulator written to the files
+ * @param logPath   - path of log, NULL if none
+ * @param seed      - seed of the random number generator
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, char **directory, char **output, char **host, char **logPath, unsigned int *seed);
+
+// Routers of the topology
+struct ProxyRouter *routers;
+int routerCount;
+// Index of the router with each label, -1 if there is none
+int routerIndex[LS_MAX_ROUTER_ID + 1];
+// Impairment of links without one of their own
+struct Impairment defaults;
+// The -link options, applied once the topology is read
+char **linkOptions;
+int linkOptionCount;
+int basePort;
+struct TimerWheel *wheel;
+// Number of datagrams waiting to be forwarded
+int pendingCount;
+FILE *logFile;
+long long startTime;
+volatile sig_atomic_t running = 1;
+
+int main(int argc, char **argv)
+{
+	int i, ready;
+	unsigned int seed;
+	char *directory, *output, *host, *logPath;
+	struct pollfd *fds;
+
+	if (parseCommandLine(argc, argv, &directory, &output, &host, &logPath, &seed) < 0)
+		exit(EXIT_FAILURE);
+
+	srand(seed);
+
+	if (loadTopology(directory) < 0)
+		exit(EXIT_FAILURE);
+
+	for (i = 0; i < linkOptionCount; i += 2)
+		if (setLinkImpairment(linkOptions[i], linkOptions[i + 1]) < 0)
+			exit(EXIT_FAILURE);
+
+	if (!(fds = (struct pollfd *) malloc(routerCount * sizeof(struct pollfd))))
+	{
+		printf("Malloc failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < routerCount; i++)
+	{
+		if ((routers[i].fd = initializeSocket(routers[i].proxyPort)) < 0)
+			exit(EXIT_FAILURE);
+
+		fcntl(routers[i].fd, F_SETFL, O_NONBLOCK);
+		fds[i].fd = routers[i].fd;
+		fds[i].events = POLLIN;
+	}
+
+	if (writeProxyFiles(output, host) < 0)
+		exit(EXIT_FAILURE);
+
+	if (logPath && !(logFile = fopen(logPath, "w")))
+	{
+		perror(logPath);
+		exit(EXIT_FAILURE);
+	}
+
+	signal(SIGINT, stopEmulator);
+	signal(SIGTERM, stopEmulator);
+
+	startTime = currentTime();
+	wheel = newTimerWheel(LS_TICK, startTime);
+
+	printf("Emulating %d routers on ports %d to %d, neighbor files written to %s\n",
+	       routerCount, basePort, basePort + routerCount - 1, output);
+	fflush(stdout);
+
+	while (running)
+	{
+		// The wheel is only polled while a datagram is waiting on it
+		ready = poll(fds, routerCount, pendingCount ? LS_TICK / 1000 : -1);
+
+		if (ready < 0 && errno != EINTR)
+		{
+			perror("Poll failed");
+			break;
+		}
+
+		for (i = 0; ready > 0 && i < routerCount; i++)
+			if (fds[i].revents & POLLIN)
+				receiveDatagrams(&routers[i]);
+
+		advanceWheel(wheel, currentTime());
+	}
+
+	printTotals();
+
+	if (logFile)
+		fclose(logFile);
+
+	exit(EXIT_SUCCESS);
+}
+
+int loadTopology(const char *directory)
+{
+	int i, size;
+	uint16_t label;
+	char name[NAME_MAX + 1], path[PATH_MAX];
+	DIR *dir;
+	struct dirent *entry;
+	struct Neighbor *neighbor;
+	struct ProxyRouter *router, *dest;
+
+	if (!(dir = opendir(directory)))
+	{
+		perror("Error");
+		return -1;
+	}
+
+	for (i = 0; i <= LS_MAX_ROUTER_ID; i++)
+		routerIndex[i] = -1;
+
+	size = 0;
+	routers = NULL;
+	routerCount = 0;
+	while ((entry = readdir(dir)))
+	{
+		strcpy(name, entry->d_name);
+		i = strlen(name) - 4;
+		if (i < 1 || strcmp(name + i, ".txt"))
+			continue;
+
+		name[i] = '\0';
+		if (!(label = parseRouterID(name)) || routerIndex[label] >= 0)
+			continue;
+
+		if (routerCount == size)
+		{
+			size = size ? 2 * size : 64;
+			if (!(routers = (struct ProxyRouter *) realloc(routers, size * sizeof(struct ProxyRouter))))
+			{
+				printf("Malloc failed.\n");
+				closedir(dir);
+				return -1;
+			}
+		}
+
+		router = &routers[routerCount];
+		memset(router, 0, sizeof(struct ProxyRouter));
+		router->label = label;
+		strcpy(router->name, name);
+		router->proxyPort = basePort + routerCount;
+		router->fd = -1;
+		routerIndex[label] = routerCount++;
+	}
+	closedir(dir);
+
+	if (!routerCount)
+	{
+		fprintf(stderr, "No neighbor files in %s\n", directory);
+		return -1;
+	}
+
+	if (basePort + routerCount - 1 > 65535)
+	{
+		fprintf(stderr, "Not enough ports above %d for %d routers\n", basePort, routerCount);
+		return -1;
+	}
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		if (!(router->neighbors = newNeighborList()))
+		{
+			printf("Malloc failed.\n");
+			return -1;
+		}
+
+		snprintf(path, PATH_MAX, "%s/%s.txt", directory, router->name);
+		if (processTextFile(path, router->neighbors) < 0)
+			return -1;
+
+		for (neighbor = router->neighbors->head; neighbor; neighbor = neighbor->next)
+		{
+			if (routerIndex[neighbor->label] < 0)
+			{
+				fprintf(stderr, "%s lists a router without a neighbor file\n", path);
+				return -1;
+			}
+
+			// A router listens where its neighbors send to, which the emulator now forwards to
+			dest = &routers[routerIndex[neighbor->label]];
+			if (!dest->hasAddress)
+			{
+				dest->address.sin_family = AF_INET;
+				inet_aton(neighbor->address, &dest->address.sin_addr);
+				dest->address.sin_port = htons(neighbor->port);
+				dest->hasAddress = 1;
+			}
+
+			if (!findLink(dest, router->label))
+				return -1;
+		}
+	}
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		if (!router->hasAddress)
+		{
+			fprintf(stderr, "No neighbor file gives the port of router %s\n", router->name);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int writeProxyFiles(const char *directory, const char *host)
+{
+	char path[PATH_MAX], label[LS_ID_LENGTH];
+	FILE *fp;
+	struct Neighbor *neighbor;
+	struct ProxyRouter *router;
+
+	if (mkdir(directory, 0755) < 0 && errno != EEXIST)
+	{
+		perror(directory);
+		return -1;
+	}
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		snprintf(path, PATH_MAX, "%s/%s.txt", directory, router->name);
+		if (!(fp = fopen(path, "w")))
+		{
+			perror(path);
+			return -1;
+		}
+
+		for (neighbor = router->neighbors->head; neighbor; neighbor = neighbor->next)
+			fprintf(fp, "%s%s%s%s%d%s%d\n", formatRouterID(neighbor->label, label), DELIM, host, DELIM,
+			        routers[routerIndex[neighbor->label]].proxyPort, DELIM, neighbor->cost);
+
+		if (fclose(fp))
+		{
+			perror(path);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+struct ProxyLink *findLink(struct ProxyRouter *router, uint16_t source)
+{
+	int i;
+	struct ProxyLink *link;
+
+	for (i = 0; i < router->linkCount; i++)
+		if (router->links[i].source == source)
+			return &router->links[i];
+
+	if (router->linkCount == router->linkSize)
+	{
+		router->linkSize = router->linkSize ? 2 * router->linkSize : 8;
+		if (!(router->links = (struct ProxyLink *) realloc(router->links, router->linkSize * sizeof(struct ProxyLink))))
+		{
+			printf("Malloc failed.\n");
+			return NULL;
+		}
+	}
+
+	link = &router->links[router->linkCount++];
+	memset(link, 0, sizeof(struct ProxyLink));
+	link->source = source;
+	link->dest = router;
+	link->impairment = defaults;
+
+	return link;
+}
+
+int parseImpairment(const char *spec, struct Impairment *impairment)
+{
+	char *copy, *setting, *value, *save;
+	int result;
+
+	if (!(copy = strdup(spec)))
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	result = 0;
+	for (setting = strtok_r(copy, ",", &save); setting && !result; setting = strtok_r(NULL, ",", &save))
+	{
+		if (!(value = strchr(setting, '=')))
+		{
+			fprintf(stderr, "Missing value of %s\n", setting);
+			result = -1;
+			continue;
+		}
+
+		*value++ = '\0';
+
+		if (!strcmp(setting, "loss"))
+			impairment->loss = atof(value);
+		else if (!strcmp(setting, "delay"))
+			impairment->delay = atof(value) * 1000;
+		else if (!strcmp(setting, "jitter"))
+			impairment->jitter = atof(value) * 1000;
+		else if (!strcmp(setting, "duplicate"))
+			impairment->duplicate = atof(value);
+		else if (!strcmp(setting, "reorder"))
+			impairment->reorder = atof(value);
+		else
+		{
+			fprintf(stderr, "Unknown impairment %s\n", setting);
+			result = -1;
+		}
+	}
+
+	free(copy);
+
+	return result;
+}
+
+int setLinkImpairment(const char *link, const char *spec)
+{
+	char *copy, *separator;
+	uint16_t a, b;
+	int both;
+	struct Impairment impairment;
+	struct ProxyLink *forward, *back;
+
+	if (!(copy = strdup(link)))
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	both = (separator = strchr(copy, ',')) != NULL;
+	if (!both)
+		separator = strchr(copy, '>');
+
+	if (separator)
+		*separator++ = '\0';
+
+	if (!separator || !(a = parseRouterID(copy)) || !(b = parseRouterID(separator)) ||
+	    routerIndex[a] < 0 || routerIndex[b] < 0)
+	{
+		fprintf(stderr, "%s is not a link between two routers of the topology\n", link);
+		free(copy);
+		return -1;
+	}
+
+	free(copy);
+
+	impairment = defaults;
+	if (parseImpairment(spec, &impairment) < 0)
+		return -1;
+
+	if (!(forward = findLink(&routers[routerIndex[b]], a)) || (both && !(back = findLink(&routers[routerIndex[a]], b))))
+		return -1;
+
+	forward->impairment = impairment;
+	if (both)
+		back->impairment = impairment;
+
+	return 0;
+}
+
+void receiveDatagrams(struct ProxyRouter *router)
+{
+	int length;
+	char datagram[LS_DATAGRAM_SIZE];
+	struct ProxyLink *link;
+
+	while ((length = recv(router->fd, datagram, LS_DATAGRAM_SIZE, 0)) > 0)
+	{
+		// Anything a router would throw away is forwarded untouched, as it cannot be traced to a link
+		if (!isValidDatagram(datagram, length) || !(link = findLink(router, getSenderID(datagram))))
+		{
+			sendto(router->fd, datagram, length, 0, (struct sockaddr *) &router->address, sizeof(router->address));
+			continue;
+		}
+
+		impairDatagram(link, datagram, length);
+	}
+}
+
+void impairDatagram(struct ProxyLink *link, const char *datagram, int length)
+{
+	long long delay;
+	struct Pending *pending, *held;
+
+	link->received++;
+
+	if (chance(link->impairment.loss))
+	{
+		link->dropped++;
+		logDatagram(link, (char *) datagram, "drop", -1);
+		return;
+	}
+
+	delay = randomDelay(&link->impairment);
+	held = link->held;
+
+	// A datagram is only held back while no other one is, so a held datagram is never stranded
+	if (!held && chance(link->impairment.reorder))
+	{
+		if ((pending = scheduleDatagram(link, datagram, length, delay + NETEM_REORDER_HOLD)))
+		{
+			link->reordered++;
+			link->held = pending;
+			logDatagram(link, (char *) datagram, "hold", -1);
+		}
+		return;
+	}
+
+	logDatagram(link, (char *) datagram, "delay", delay);
+	scheduleDatagram(link, datagram, length, delay);
+
+	// The held datagram goes out one tick after the one that overtook it
+	if (held)
+	{
+		link->held = NULL;
+		addTimer(wheel, &held->timer, delay + LS_TICK);
+		logDatagram(link, held->datagram, "release", delay + LS_TICK);
+	}
+
+	if (chance(link->impairment.duplicate))
+	{
+		delay = randomDelay(&link->impairment);
+		link->duplicated++;
+		logDatagram(link, (char *) datagram, "duplicate", delay);
+		scheduleDatagram(link, datagram, length, delay);
+	}
+}
+
+struct Pending *scheduleDatagram(struct ProxyLink *link, const char *datagram, int length, long long delay)
+{
+	struct Pending *pending;
+	struct ProxyRouter *router = link->dest;
+
+	// Datagrams that are not delayed are forwarded at once instead of waiting for a tick
+	if (delay <= 0)
+	{
+		if (sendto(router->fd, datagram, length, 0, (struct sockaddr *) &router->address, sizeof(router->address)) < 0)
+			perror("Sendto failed");
+		link->forwarded++;
+		return NULL;
+	}
+
+	if (!(pending = (struct Pending *) malloc(sizeof(struct Pending))))
+	{
+		printf("Malloc failed.\n");
+		return NULL;
+	}
+
+	pending->link = link;
+	pending->received = currentTime();
+	pending->length = length;
+	memcpy(pending->datagram, datagram, length);
+	initTimer(&pending->timer, forwardDatagram, pending);
+
+	pendingCount++;
+	addTimer(wheel, &pending->timer, delay);
+
+	return pending;
+}
+
+void forwardDatagram(void *arg)
+{
+	struct Pending *pending = (struct Pending *) arg;
+	struct ProxyLink *link = pending->link;
+	struct ProxyRouter *router = link->dest;
+
+	if (sendto(router->fd, pending->datagram, pending->length, 0, (struct sockaddr *) &router->address, sizeof(router->address)) < 0)
+		perror("Sendto failed");
+
+	link->forwarded++;
+	link->delayed += currentTime() - pending->received;
+	pendingCount--;
+
+	// A held datagram no later one overtook is forwarded once it has waited long enough
+	if (link->held == pending)
+	{
+		link->held = NULL;
+		logDatagram(link, pending->datagram, "timeout", -1);
+	}
+
+	free(pending);
+}
+
+long long randomDelay(struct Impairment *impairment)
+{
+	long long delay = impairment->delay;
+
+	if (impairment->jitter > 0)
+		delay += (long long) ((2.0 * rand() / RAND_MAX - 1.0) * impairment->jitter);
+
+	return delay < 0 ? 0 : delay;
+}
+
+int chance(double percent)
+{
+	return percent > 0 && 100.0 * rand() / ((double) RAND_MAX + 1) < percent;
+}
+
+void logDatagram(struct ProxyLink *link, char *datagram, const char *action, long long delay)
+{
+	static const char *types[] = { "unknown", "update", "ack", "description", "request", "hello" };
+	char source[LS_ID_LENGTH], dest[LS_ID_LENGTH];
+	int type;
+
+	if (!logFile)
+		return;
+
+	type = getType(datagram);
+	fprintf(logFile, "%.3f %s>%s %s %s %d", (currentTime() - startTime) / 1000.0, formatRouterID(link->source, source),
+	        formatRouterID(link->dest->label, dest), action, types[type <= LS_TYPE_HELLO ? type : 0], getCount(datagram));
+
+	if (delay >= 0)
+		fprintf(logFile, " %.3f", delay / 1000.0);
+
+	fputc('\n', logFile);
+}
+
+void printTotals()
+{
+	int i;
+	char source[LS_ID_LENGTH], dest[LS_ID_LENGTH];
+	struct ProxyLink *link;
+	struct ProxyRouter *router;
+
+	printf("%-13s %10s %10s %10s %10s %10s %10s\n", "Link", "Received", "Dropped", "Duplicated", "Reordered",
+	       "Forwarded", "Delay ms");
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		for (i = 0; i < router->linkCount; i++)
+		{
+			link = &router->links[i];
+			if (!link->received)
+				continue;
+
+			printf("%5s > %-5s %10lld %10lld %10lld %10lld %10lld %10.3f\n", formatRouterID(link->source, source),
+			       formatRouterID(router->label, dest), link->received, link->dropped, link->duplicated,
+			       link->reordered, link->forwarded, link->forwarded ? link->delayed / 1000.0 / link->forwarded : 0.0);
+		}
+	}
+}
+
+void stopEmulator(int sig)
+{
+	running = 0;
+}
+
+int parseCommandLine(int argc, char **argv, char **directory, char **output, char **host, char **logPath, unsigned int *seed)
+{
+	int i;
+
+	if (argc < 3)
+	{
+		fprintf(stderr, "Not enough arguments. Use format:\n"
+		                "topologyDirectory outputDirectory [-loss percent] [-delay ms] [-jitter ms] [-duplicate percent]\n"
+		                "[-reorder percent] [-link A,B|A>B name=value,...] [-host address] [-port n] [-seed n] [-log file]\n");
+		return -1;
+	}
+
+	*directory = argv[1];
+	*output = argv[2];
+	*host = NETEM_HOST;
+	*logPath = NULL;
+	*seed = 1;
+	basePort = NETEM_PORT;
+
+	if (!(linkOptions = (char **) malloc(argc * sizeof(char *))))
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	for (i = 3; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "Missing value of %s\n", argv[i]);
+			return -1;
+		}
+
+		if (!strcmp(argv[i], "-loss"))
+			defaults.loss = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-delay"))
+			defaults.delay = atof(argv[++i]) * 1000;
+		else if (!strcmp(argv[i], "-jitter"))
+			defaults.jitter = atof(argv[++i]) * 1000;
+		else if (!strcmp(argv[i], "-duplicate"))
+			defaults.duplicate = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-reorder"))
+			defaults.reorder = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-host"))
+			*host = argv[++i];
+		else if (!strcmp(argv[i], "-port"))
+			basePort = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed"))
+			*seed = strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-log"))
+			*logPath = argv[++i];
+		else if (!strcmp(argv[i], "-link"))
+		{
+			if (i + 2 >= argc)
+			{
+				fprintf(stderr, "Missing value of %s\n", argv[i]);
+				return -1;
+			}
+
+			linkOptions[linkOptionCount++] = argv[++i];
+			linkOptions[linkOptionCount++] = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (basePort <= 0)
+	{
+		fprintf(stderr, "Invalid port %d\n", basePort);
+		return -1;
+	}
+
+	return 0;
+}
@@ -8,6 +8,9 @@
  */
 
 #include <pthread.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
 
 #ifdef __APPLE__
 #include <mach/semaphore.h>
@@ -21,23 +24,315 @@
 #include <semaphore.h>
 #endif
 
+#include "lsCapture.h"
+#include "lsCheckpoint.h"
+#include "lsChurn.h"
+#include "lsFlood.h"
+#include "lsMetrics.h"
 #include "lsNetwork.h"
 #include "lsPacket.h"
 #include "lsGraph.h"
 #include "lsDijkstra.h"
+#include "lsTopology.h"
+#include "lsTrace.h"
+
+// Receive shard of the router: a socket bound to the router's port that the datagrams of
+// the shard's neighbors are steered to, and the network thread serving those neighbors
+struct Shard
+{
+	int index;
+	int fd;
+	// Timer wheel for the hellos and transmissions of the shard's neighbors
+	struct TimerWheel *wheel;
+	// Queue containing packets waiting to be sent to the shard's neighbors
+	struct FifoQueue *sendQueue;
+	// Queue containing packets from the shard's neighbors waiting to be processed
+	struct FifoQueue *recvQueue;
+	// Semaphores for synchronizing the shard's network thread with the other threads
+	sem_t sendLock;
+	sem_t recvLock;
+	// Rings the shard's neighbors on the same host write to
+	struct ShmRing **rings;
+	int ringCount;
+	// Sockets waited on with blocking calls, the shard's own first and then those of the
+	// segments it floods to by multicast
+	struct pollfd *polls;
+	int pollCount;
+};
 
 /**
- * Thread function for managing incoming and outgoing link-state packets.
+ * Thread function for managing incoming and outgoing link-state packets of a shard's neighbors.
  *
- * @param param - integer pointer to socket file descriptor
+ * @param param - pointer to the shard served by the thread
  */
 void *networkThread(void *param);
 /**
- * Thread function for periodically changing a neighboring edge cost.
+ * Handles a datagram received by the network thread through its socket or a shared ring,
+ * recording it first if datagrams are captured. Link-state packets are pushed to
+ * the received queue and acknowledged once it takes them. Database descriptions and
+ * requests are collected in the neighbor entry and announced with one queue entry.
+ * Acknowledgements are removed from the retransmission list of the neighbor that sent them.
+ *
+ * @param fd       - socket file descriptor
+ * @param datagram - received datagram
+ * @param length   - length of datagram in bytes
+ */
+void processDatagram(int fd, char *datagram, int length);
+/**
+ * Timer callback sending a hello to a neighbor and starting the timer for the next one.
+ *
+ * @param arg - neighbor the hello is sent to
+ */
+void helloTimeout(void *arg);
+/**
+ * Timer callback for a neighbor that has not been heard from for the dead interval.
+ * The neighbor is reset and the main thread is told to withdraw the link to it.
+ *
+ * @param arg - neighbor that is down
+ */
+void deadTimeout(void *arg);
+/**
+ * Timer callback sending whatever is due to a neighbor and starting the timer for
+ * whatever is due next.
+ *
+ * @param arg - neighbor being sent to
+ */
+void transmitTimeout(void *arg);
+/**
+ * Timer callback writing the buffered records of the capture log and starting the timer
+ * for the next flush.
+ *
+ * @param arg - unused
+ */
+void captureTimeout(void *arg);
+/**
+ * Starts the transmit timer of a neighbor for its transmit time, unless it is already
+ * pending to fire sooner.
+ *
+ * @param neighbor - neighboring router
+ */
+void scheduleTransmit(struct Neighbor *neighbor);
+/**
+ * Thread function reading commands from standard input once the router is running.
+ * "cost <label> <cost>" changes the cost of the link to a neighbor, "stats" prints
+ * the number of datagrams sent and received, and "metrics" prints every metric.
+ *
+ * @param param - unused
+ */
+void *commandThread(void *param);
+/**
+ * Notes that a neighbor came up, ending startup once every neighbor has.
+ *
+ * @param peer - label of neighbor
+ */
+void neighborStarted(uint16_t peer);
+/**
+ * Timer callback ending startup when some neighbors have not come up in time.
+ *
+ * @param arg - unused
+ */
+void startupTimeout(void *arg);
+/**
+ * Ends startup, reporting how many neighbors came up and starting the churn engine.
+ */
+void finishStartup();
+/**
+ * Timer callback making the churn engine's changes that are due and starting the timer
+ * for the next one.
+ *
+ * @param arg - unused
+ */
+void churnTimeout(void *arg);
+/**
+ * Makes a change of the churn engine to one of our links.
+ *
+ * @param link - link changed
+ *
+ * @return - 1 if the link was changed, 0 if its neighbor is down
+ */
+int churnLink(struct ChurnLink *link);
+
+/**
+ * Pushes a packet to the send queues to be handled by the network threads. A flooded
+ * packet goes to every shard, any other packet only to the shard of its peer.
+ *
+ * @param type     - type of queued packet (QUEUE_*)
+ * @param peer     - label of neighboring router the packet is for
+ * @param packet   - packet being queued
+ * @param priority - priority class of the packet (PRIORITY_*)
+ */
+void queueForNetwork(int type, uint16_t peer, const char *packet, int priority);
+/**
+ * Pushes a packet to the send queue of a shard, waiting for its network thread to make
+ * room if the queue is full.
+ *
+ * @param target   - shard the packet is queued for
+ * @param type     - type of queued packet (QUEUE_*)
+ * @param peer     - label of neighboring router the packet is for
+ * @param packet   - packet being queued
+ * @param priority - priority class of the packet (PRIORITY_*)
+ */
+void queueForShard(struct Shard *target, int type, uint16_t peer, const char *packet, int priority);
+/**
+ * Pops the next entry of the shards' received queues for the main thread. The queues are
+ * merged by taking from the shards in turn, each of which keeps its neighbors' entries in
+ * the order they were received.
+ *
+ * @param packet - buffer where the packet will be stored
+ * @param peer   - where the label of the neighbor the entry is from will be stored
+ *
+ * @return - type of entry (QUEUE_*), 0 if every received queue is empty
+ */
+int popReceived(char *packet, uint16_t *peer);
+/**
+ * Checks if the received queue of every shard is empty.
+ *
+ * @return - 1 if empty, 0 if not
+ */
+int isReceivedEmpty();
+/**
+ * Updates the graph with a link-state packet. A packet newer than the graph is flooded
+ * to every other neighbor, a packet older than the graph is answered with our copy.
+ *
+ * @param packet - link-state packet
+ * @param peer   - label of neighbor the packet was received from, or the local router
+ */
+void processPacket(char *packet, uint16_t peer);
+/**
+ * Compares a summary from a neighbor's database description to the graph. A newer or
+ * missing packet is requested from the neighbor, an older one is answered with our copy.
+ *
+ * @param summary - link-state packet summary
+ * @param peer    - label of neighbor that sent the description
+ */
+void compareSummary(char *summary, uint16_t peer);
+/**
+ * Changes the cost of our link to a neighbor and originates the new cost, unless the
+ * link is withdrawn, in which case the new cost is used once it is restored.
+ *
+ * @param peer - label of neighbor
+ * @param cost - new cost of the link
+ */
+void changeNeighborCost(uint16_t peer, int cost);
+/**
+ * Takes the summaries a neighbor sent in its database description or requests and
+ * handles each of them.
+ *
+ * @param type - QUEUE_PEER_DESCRIPTION or QUEUE_PEER_REQUESTS
+ * @param peer - label of neighbor that sent the summaries
+ */
+void processSummaries(int type, uint16_t peer);
+/**
+ * Sends the link-state packet stored in an edge to a single neighbor.
  *
- * @param param - character pointer to local router label
+ * @param edge   - edge leaving the source router of the packet
+ * @param buffer - buffer holding a packet or summary for the edge, overwritten with the packet
+ * @param peer   - label of neighbor the packet is sent to
  */
-void *dynamicThread(void *param);
+void replyWithEdge(struct AdjListNode *edge, char *buffer, uint16_t peer);
+/**
+ * Builds the database description for a neighbor from a summary of every link-state
+ * packet in the graph, and queues it one datagram per entry.
+ *
+ * @param peer - label of neighbor the description is sent to
+ */
+void describeDatabase(uint16_t peer);
+/**
+ * Finds the edge between two routers in the graph.
+ *
+ * @param source - label of source router
+ * @param dest   - label of destination router
+ *
+ * @return - pointer to edge, NULL if either router or the edge is unknown
+ */
+struct AdjListNode *lookupEdge(uint16_t source, uint16_t dest);
+/**
+ * Originates our link to a neighbor when the neighbor goes down or comes back up.
+ * A down neighbor's link is withdrawn, and a withdrawn link is restored with the
+ * neighbor's cost once it is up again.
+ *
+ * @param peer - label of neighbor
+ * @param up   - 1 if the neighbor came up, 0 if it went down
+ */
+void originateNeighborLink(uint16_t peer, int up);
+/**
+ * Starts the age timer of the record the graph holds for a link-state packet that was
+ * just applied, so the record is flushed if it is not refreshed before LS_MAX_AGE.
+ *
+ * @param packet - applied link-state packet
+ */
+void ageRecord(char *packet);
+/**
+ * Gets the current age of the packet held in an edge.
+ *
+ * @param edge - edge leaving the source router of the packet
+ *
+ * @return - age in seconds, at most LS_MAX_AGE
+ */
+int getRecordAge(struct AdjListNode *edge);
+/**
+ * Timer callback flushing a record that reached LS_MAX_AGE. The edge is removed unless
+ * the router at its other end still advertises it.
+ *
+ * @param arg - edge holding the record
+ */
+void expireRecord(void *arg);
+/**
+ * Timer callback originating every live link of the local router again with a new
+ * sequence number and starting the timer for the next refresh.
+ *
+ * @param arg - unused
+ */
+void refreshLinks(void *arg);
+/**
+ * Timer callback saving the database to the checkpoint and starting the timer for the
+ * next checkpoint.
+ *
+ * @param arg - unused
+ */
+void checkpointTimeout(void *arg);
+/**
+ * Saves every live record of the database to the checkpoint.
+ *
+ * @return - number of records saved, -1 if error
+ */
+int saveDatabase();
+/**
+ * Restores the records saved in the checkpoint, aged by the time since they were saved.
+ * The records of other routers are installed unverified. Our own links are originated
+ * again with the sequence number after the saved one and the cost of the neighbor file.
+ */
+void restoreDatabase();
+/**
+ * Checks whether the restored records can be flushed, which is once startup is over and
+ * every neighbor up by then described its whole database.
+ *
+ * @return - 1 if every neighbor up described its database, 0 if not
+ */
+int allDescribed();
+/**
+ * Timer callback flushing the restored records a dead interval after startup, without
+ * the descriptions of the neighbors that did not finish theirs.
+ *
+ * @param arg - unused
+ */
+void verifyTimeout(void *arg);
+/**
+ * Flushes the restored records no neighbor's database description confirmed, since the
+ * network no longer holds them.
+ */
+void flushUnverified();
+/**
+ * Rewrites an instance of one of our own link-state packets that is newer than our copy
+ * into a fresh origination with a later sequence number. If we have no such link, the
+ * received instance is applied and the rewritten packet withdraws it.
+ *
+ * @param packet - link-state packet originated by the local router
+ * @param label  - label of local router
+ *
+ * @return - 1 if the packet was rewritten, 0 if it was left unchanged
+ */
+int supersedeOwnPacket(char *packet, uint16_t label);
 
 /**
  * Parses the command line arguments and stores the results in the parameters 
@@ -48,306 +343,1663 @@ void *dynamicThread(void *param);
  * @param port      - local port number
  * @param numRouter - number of routers in the network
  * @param filename  - file name of neighbor discovery file
- * @param dynamic   - flag indicating whether dynamic option was enabled
+ * @param churn     - settings of the churn engine, NULL if the links are not churned
+ * @param metrics   - path of the metrics server's socket, NULL if metrics are not served
+ * @param trace     - directory the trace files are written to, NULL if not tracing
+ * @param capture   - file the received datagrams are recorded in, NULL if not capturing
+ * @param saved     - file the database is checkpointed to, NULL if not checkpointing
+ * @param io        - socket backend of the network threads (IO_*)
+ * @param shards    - number of receive shards
+ * @param shm       - 1 if neighbors on the same host are sent to through shared rings, 0 if not
+ * @param multicast - 1 if neighbors on a segment are flooded to through its group, 0 if not
+ * @param pace      - datagrams per second each neighbor is sent, 0 if not paced
+ * @param batch     - longest microseconds a flooded packet is held, 0 if not batched
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, uint16_t *label, int *port, int *numRouters, char **filename, char **churn, char **metrics, char **trace, char **capture, char **saved, int *io, int *shards, int *shm, int *multicast, double *pace, long long *batch);
+/**
+ * Maps a binary topology file and computes the shortest paths over it from one router,
+ * printing its forwarding table, or from every router, printing how long it took. Runs
+ * in place of the router when the program is started with -spf-only.
+ *
+ * @param filename - path of topology file
+ * @param root     - label of starting router, or "all" for every router
  *
  * @return - 0 if success, -1 if error
  */
-int parseCommandLine(int argc, char **argv, char *label, int *port, int *numRouters, char **filename, int *dynamic);
+int runSPFOnly(const char *filename, const char *root);
 /**
- * Initializes the socket and data structures that are used in the program.
+ * Initializes the sockets and data structures that are used in the program.
  *
- * @param fd         - socket file descriptor
  * @param port       - local port number
  * @param numRouters - number of routers in the network
  * @param filename   - file name of neighbor discovery file
  * @param label      - label of local router
+ * @param count      - number of receive shards
+ * @param pace       - datagrams per second each neighbor is sent, 0 if not paced
+ * @param batch      - longest microseconds a flooded packet is held, 0 if not batched
  *
  * @return - 0 if success, -1 if error
  */
-int initialization(int *fd, int port, int numRouters, char *filename, char label);
+int initialization(int port, int numRouters, char *filename, uint16_t label, int count, double pace, long long batch);
 /**
- * Creates and starts the network thread.
- *
- * @param fd - socket file descriptor
+ * Creates and starts the network thread of every shard.
  *
  * @return - 0 if success, -1 if error
  */
-int startNetworkThread(int *fd);
+int startNetworkThreads();
 /**
- * Creates and starts the dynamic thread.
+ * Signal handler removing the shared rings the router created, so none is left behind
+ * when the router is stopped, and stopping it as the signal would.
  *
- * @param label - label of local router
+ * @param sig - signal received
+ */
+void removeRings(int sig);
+/**
+ * Creates and starts the command thread.
  *
  * @return - 0 if success, -1 if error
  */
-int startDynamicThread(char *label);
+int startCommandThread();
 
+// Label of the local router
+uint16_t label;
+// Port the router's sockets are bound to
+int localPort;
+// Socket backend of the network threads (IO_*)
+int ioBackend;
+// Set if neighbors on the same host are sent to through shared rings
+int sharedRings;
+// Set if neighbors on a segment are flooded to through its multicast group
+int multicastFlooding;
+// Receive shards, each with a socket on the router's port and a network thread
+struct Shard *shards;
+int shardCount;
+// Shard the main thread takes the next received entry from
+int nextShard;
+// Shard served by the calling network thread
+__thread struct Shard *shard;
+// Timer wheel for the aging and refreshing of the graph's records in the main thread
+struct TimerWheel *mainWheel;
+// Timer for the next refresh of the local router's links
+struct Timer refreshTimer;
+// Log the received datagrams are recorded in, NULL if not capturing
+struct Capture *capture;
+// Timer for the next flush of the capture log
+struct Timer captureTimer;
+// File the database is checkpointed to, NULL if not checkpointing
+struct Checkpoint *checkpoint;
+// Timer for the next checkpoint
+struct Timer checkpointTimer;
+// Engine changing our links as a load generator, NULL if not churning
+struct Churn *churn;
+// Timer for the next change of the churn engine
+struct Timer churnTimer;
+// Time the router started, and the neighbors that have not come up since, -1 once startup is over
+long long startTime;
+int startupPending;
+// Timer ending startup without the neighbors that have not come up
+struct Timer startupTimer;
+// Set while the records restored from the checkpoint wait for the neighbors' databases
+int unverifiedRecords;
+// Timer flushing the restored records if a neighbor never finishes describing its database
+struct Timer verifyTimer;
 // Graph of all nodes and edges in the network
 struct Graph *graph;
 // List containing the neighbor info read from file
 struct NeighborList *neighbors;
-// Queue containing packets waiting to be sent
-struct FifoQueue *sendQueue;
-// Queue containing packets waiting to be processed
-struct FifoQueue *recvQueue;
-
-// Semaphores for synchronizing threads
-sem_t sendLock;
-sem_t recvLock;
-sem_t dynamLock;
 
 int main(int argc, char **argv)
 {
-	int fd, port, numRouters, dynamic, dLock;
-	char label, *filename;
+	int i, port, numRouters, type;
+	uint16_t peer;
+	long long start, batch;
+	double pace;
+	char *filename, *churnSpec, *metricsPath, *traceDirectory, *captureFile, *checkpointFile;
 	char recvBuffer[LS_PACKET_SIZE];
 
-	// Parse command line arguments to get parameters and set dynamic flag
-	if (parseCommandLine(argc, argv, &label, &port, &numRouters, &filename, &dynamic) < 0)
+	// Calculate shortest paths over a topology file without starting a router
+	if (argc > 1 && !strcmp(argv[1], "-spf-only"))
+	{
+		if (argc != 4)
+		{
+			fprintf(stderr, "Use format:\n-spf-only topologyFile routerLabel|all\n");
+			exit(EXIT_FAILURE);
+		}
+		exit(runSPFOnly(argv[2], argv[3]) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	// Parse command line arguments to get parameters and churn settings
+	if (parseCommandLine(argc, argv, &label, &port, &numRouters, &filename, &churnSpec, &metricsPath, &traceDirectory, &captureFile, &checkpointFile, &ioBackend, &shardCount, &sharedRings, &multicastFlooding, &pace, &batch) < 0)
+		exit(EXIT_FAILURE);
+
+	// Initialize sockets and data structures
+	if (initialization(port, numRouters, filename, label, shardCount, pace, batch) < 0)
 		exit(EXIT_FAILURE);
 
-	// Initialize socket and data structures
-	if (initialization(&fd, port, numRouters, filename, label) < 0)
+	// Serve the metrics recorded by the main and network threads. The time entries wait
+	// in the queues is only measured while metrics are served.
+	if (registerMetricThread() < 0 || setGaugeSeries(shardCount) < 0)
+	{
+		fprintf(stderr, "Cannot record metrics of %d shards\n", shardCount);
+		exit(EXIT_FAILURE);
+	}
+	if (metricsPath)
+	{
+		if (startMetricsServer(metricsPath) < 0)
+			exit(EXIT_FAILURE);
+		for (i = 0; i < shardCount; i++)
+		{
+			shards[i].recvQueue->timed = 1;
+			shards[i].sendQueue->timed = 1;
+		}
+	}
+
+	// Trace the packets passing through the main and network threads
+	if (traceDirectory && (initTrace(traceDirectory, label) < 0 || openTraceRing("main") < 0))
 		exit(EXIT_FAILURE);
 
-	// Start network thread
-	if (startNetworkThread(&fd) < 0)
+	// Record every received datagram for replay
+	if (captureFile && !(capture = createCapture(captureFile, label, numRouters)))
 		exit(EXIT_FAILURE);
-	
-	// Initialization finished, give other processes time to set up before continuing
-	printf("Press enter to continue after all nodes are running.\n");
-	getchar();
 
-	// Start dynamic change thread if dynamic flag is set
-	if (dynamic)
+	// Restore the database saved before a restart, and keep saving it
+	if (checkpointFile)
+	{
+		if (!(checkpoint = openCheckpoint(checkpointFile, label)))
+			exit(EXIT_FAILURE);
+		restoreDatabase();
+		initTimer(&checkpointTimer, checkpointTimeout, NULL);
+		addTimer(mainWheel, &checkpointTimer, LS_CHECKPOINT_INTERVAL);
+	}
+
+	// Churn our links once startup is over
+	if (churnSpec)
 	{
-		if (startDynamicThread(&label) < 0)
+		if (!(churn = newChurn(churnSpec)) || selectChurnLinks(churn, neighbors) < 0)
 			exit(EXIT_FAILURE);
-		dLock = 1;
+		initTimer(&churnTimer, churnTimeout, NULL);
 	}
+
+	// Startup is over once every neighbor has come up, which the hellos of the network
+	// thread detect without the other routers having to be started in any order. Our link
+	// to each neighbor is originated as it comes up.
+	startTime = currentTime();
+	startupPending = neighbors->size;
+	initTimer(&startupTimer, startupTimeout, NULL);
+	if (startupPending)
+		addTimer(mainWheel, &startupTimer, LS_STARTUP_TIMEOUT);
 	else
-		dLock = 0;
+		finishStartup();
+
+	// Remove the shared rings when stopped
+	if (sharedRings)
+	{
+		signal(SIGINT, removeRings);
+		signal(SIGTERM, removeRings);
+	}
+
+	// Start network threads
+	if (startNetworkThreads() < 0)
+		exit(EXIT_FAILURE);
+
+	// Take commands from standard input
+	if (startCommandThread() < 0)
+		exit(EXIT_FAILURE);
+
+	// Refresh our links periodically so they never age out of the other routers' databases
+	initTimer(&refreshTimer, refreshLinks, NULL);
+	addTimer(mainWheel, &refreshTimer, LS_REFRESH_INTERVAL * 1000000LL - rand() % (LS_REFRESH_INTERVAL * 100000));
 
 	// The main loop where all the processing occurs
 	while (1)
 	{
-		// Process recveived packets in received queue until empty
-		while (!isEmptyQueue(recvQueue))	
+		// Flush records that reached the maximum age and refresh our links when due
+		advanceWheel(mainWheel, currentTime());
+		// Process recveived packets in the shards' received queues until all are empty
+		while ((type = popReceived(recvBuffer, &peer)))
 		{
-			// Pop packet from queue
-			sem_wait(&recvLock);
-			pop(recvQueue, recvBuffer);
-			sem_post(&recvLock);
-			// Update the graph
-			addEdgeFromPacket(graph, recvBuffer);
-			// If hop count greater than 0 after decrementing:
-			if (decrementHopCount(recvBuffer) > 0)
+			switch (type)
 			{
-				// Push packet to send queue to be sent on network thread
-				sem_wait(&sendLock);
-				push(sendQueue, recvBuffer);
-				sem_post(&sendLock);
+				case QUEUE_UPDATE:
+					TRACE_PACKET(TRACE_DEQUEUED, recvBuffer, LS_ROUTER_NONE);
+					// Update the graph and flood the packet if it was newer
+					processPacket(recvBuffer, peer);
+					break;
+				case QUEUE_PEER_DESCRIPTION:
+				case QUEUE_PEER_REQUESTS:
+					// Request newer packets described by the neighbor, or send the requested ones
+					processSummaries(type, peer);
+					break;
+				case QUEUE_NEIGHBOR_UP:
+					// Restore our link to the neighbor and describe our database to it
+					originateNeighborLink(peer, 1);
+					describeDatabase(peer);
+					neighborStarted(peer);
+					break;
+				case QUEUE_NEIGHBOR_DOWN:
+					// Withdraw our link to the neighbor so traffic is routed around it
+					originateNeighborLink(peer, 0);
+					// A link the churn engine withdrew is now restored when the neighbor comes back
+					if (churn)
+						releaseChurnLink(churn, peer);
+					break;
+				case QUEUE_COST_CHANGE:
+					changeNeighborCost(peer, getCost(recvBuffer));
+					break;
 			}
 		}
 		// If all received packets are processed and the graph 
 		// has been changed since the last shortest path calculation:
-		if (isEmptyQueue(recvQueue) && graph->updated)
+		if (isReceivedEmpty() && graph->updated)
 		{
+			start = currentTime();
+			// Drop routers whose records have all aged out so their indices can be reused
+			removeUnreachable(graph, label);
 			// Calculate the shortest path and print the forwarding table
 			dijkstra(graph, label);
-			// If dynamic thread is initially blocked, allow it to continue
-			if (dLock) 
-			{
-				sem_post(&dynamLock);
-				dLock = 0;
-			}
+			countMetric(METRIC_SPF_RUNS, 1);
+			observeMetric(METRIC_SPF_DURATION, currentTime() - start);
 		}
+		// Sleep until the next tick rather than spin while there is nothing to process
+		if (isReceivedEmpty())
+			usleep(LS_TICK);
 	}
 }
 
 void *networkThread(void *param)
 {
-	int fd = *((int *) param);
+	int i, j, type, recvLen, wait;
+	uint16_t peer;
+	long long now, queued;
+	struct Neighbor *neighbor;
+	struct PacketBuffer *buffer;
+	struct Segment *segment;
 
-	int recvLen;
+	char recvBuffer[LS_DATAGRAM_SIZE], ring[32];
+	char *datagram;
 
-	char sendBuffer[LS_PACKET_SIZE];
-	char recvBuffer[LS_PACKET_SIZE];
+	shard = (struct Shard *) param;
 
-	// Main loop where the network thread behavior is determined
-	while (1)
+	if (registerMetricThread() < 0)
 	{
-		// Forward packets in send queue until queue is empty
-		while (!isEmptyQueue(sendQueue))
-		{
-			sem_wait(&sendLock);
-			// Pop packet from send queue
-			pop(sendQueue, sendBuffer);
+		fprintf(stderr, "Cannot record metrics of network thread %d\n", shard->index);
+		exit(EXIT_FAILURE);
+	}
+	if (shard->index)
+		snprintf(ring, sizeof(ring), "network%d", shard->index);
+	else
+		strcpy(ring, "network");
+	if (openTraceRing(ring) < 0)
+		exit(EXIT_FAILURE);
 
-			sem_post(&sendLock);
-			// Send packet to all adjacent neighbors
-			floodPacket(fd, sendBuffer, neighbors);
-		}
-		// Receive packet (time out set on socket receive operation)
-		recvLen = recv(fd, recvBuffer, LS_PACKET_SIZE, 0);
-		// If packet was received:
-		if (recvLen > 0)
-		{
-			sem_wait(&recvLock);
-			// Push packet to received queue to be processed in main thread
-			push(recvQueue, recvBuffer);
+	// Do the socket work through an io_uring, or with blocking calls where it cannot be set up
+	if (ioBackend != IO_BLOCKING && !(threadRing = newUring(shard->fd, ioBackend == IO_URING_SQPOLL)))
+		fprintf(stderr, "Using blocking socket calls\n");
 
-			sem_post(&recvLock);
-		}
+	// Create the rings the shard's neighbors on the same host write to, which they find
+	// with their next hello
+	if (!(shard->rings = (struct ShmRing **) malloc((neighbors->size ? neighbors->size : 1) * sizeof(struct ShmRing *))))
+	{
+		printf("Malloc failed.\n");
+		exit(EXIT_FAILURE);
+	}
+	for (neighbor = neighbors->head; neighbor; neighbor = neighbor->next)
+	{
+		if (neighbor->local && neighbor->shard == shard->index &&
+		    (shard->rings[shard->ringCount] = createShmRing(localPort, neighbor->label, currentTime())))
+			shard->ringCount++;
 	}
-}
 
-void *dynamicThread(void *param)
-{
-	char label;
-	char packet[LS_PACKET_SIZE];
-	int i, num, numEdges, cost;
-	struct AdjList vertex;
-	struct AdjListNode *edge;
+	// Wait on the sockets of the segments joined along with the shard's own, so that a
+	// datagram flooded to a group ends the wait as well
+	for (segment = neighbors->segments; segment; segment = segment->next)
+		shard->pollCount++;
+	if (!(shard->polls = (struct pollfd *) malloc((shard->pollCount + 1) * sizeof(struct pollfd))))
+	{
+		printf("Malloc failed.\n");
+		exit(EXIT_FAILURE);
+	}
+	shard->polls[0].fd = shard->fd;
+	shard->polls[0].events = POLLIN;
+	shard->pollCount = 1;
+	for (segment = neighbors->segments; segment; segment = segment->next)
+	{
+		if (segment->fd < 0)
+			continue;
+
+		shard->polls[shard->pollCount].fd = segment->fd;
+		shard->polls[shard->pollCount++].events = POLLIN;
+		if (threadRing)
+			watchUring(threadRing, segment->fd);
+	}
+
+	// Start sending hellos to the shard's neighbors, spread out so that the neighbors are
+	// not all sent to at once
+	for (neighbor = neighbors->head; neighbor; neighbor = neighbor->next)
+	{
+		if (neighbor->shard != shard->index)
+			continue;
 
-	label = *((char *) param);
-	numEdges = neighbors->size;
+		initTimer(&neighbor->helloTimer, helloTimeout, neighbor);
+		initTimer(&neighbor->deadTimer, deadTimeout, neighbor);
+		initTimer(&neighbor->transmitTimer, transmitTimeout, neighbor);
+		addTimer(shard->wheel, &neighbor->helloTimer, rand() % LS_HELLO_INTERVAL);
+	}
 
-	// Block until first shortest path calculation
-	sem_wait(&dynamLock);
-	// Seed the random number generator
-	srand(time(NULL));
-	// Get the vertex of the local router
-	i = getIndex(graph->key, graph->size, label);
-	vertex = graph->array[i];
+	if (capture)
+	{
+		initTimer(&captureTimer, captureTimeout, NULL);
+		addTimer(shard->wheel, &captureTimer, LS_CAPTURE_FLUSH);
+	}
 
-	// Loop handling the creation of dynamic network changes
+	// Main loop where the network thread behavior is determined
 	while (1)
 	{
-		// Change the cost of a random edge of the router every 5 seconds
-		sleep(5);
-		// Pick a random edge
-		num = rand() % (numEdges);
-		// Loop to the picked edge
-		i = 0;
-		edge = vertex.head;
-		while (edge && i < num)
+		now = currentTime();
+		// Queue packets in send queue on the neighbors' retransmission lists until queue is empty
+		while (!isEmptyQueue(shard->sendQueue))
 		{
-			edge = edge->next;
-			i++;
-		}
+			// Packets are popped straight into a pooled buffer, which the retransmission
+			// lists of every neighbor they are flooded to share
+			if (!(buffer = takeBuffer()))
+			{
+				printf("Malloc failed.\n");
+				break;
+			}
+
+			sem_wait(&shard->sendLock);
+			// Pop packet from send queue
+			type = pop(shard->sendQueue, buffer->packet, &peer);
+			queued = shard->sendQueue->poppedTime;
+			buffer->priority = shard->sendQueue->poppedPriority;
+			setGauge(METRIC_SEND_QUEUE_DEPTH, shard->index, shard->sendQueue->size);
+
+			sem_post(&shard->sendLock);
+
+			if (shard->sendQueue->timed)
+				observeMetric(METRIC_SEND_QUEUE_WAIT, now - queued);
+
+			if (type == QUEUE_UPDATE)
+			{
+				TRACE_PACKET(TRACE_FLOOD_DEQUEUED, buffer->packet, LS_ROUTER_NONE);
+				// Send packet to all adjacent neighbors except the one it came from
+				floodPacket(neighbors, buffer, peer, label, shard->index, now);
+				TRACE_PACKET(TRACE_FLOODED, buffer->packet, LS_ROUTER_NONE);
+				releaseBuffer(buffer);
+				for (neighbor = neighbors->head; neighbor; neighbor = neighbor->next)
+					if (neighbor->shard == shard->index)
+						scheduleTransmit(neighbor);
+				continue;
+			}
+
+			// Every other packet is meant only for its peer, and is dropped if the peer went down
+			if (!(neighbor = findNeighbor(neighbors, peer)) || neighbor->state == NEIGHBOR_DOWN)
+			{
+				if (type == QUEUE_DESCRIPTION || type == QUEUE_DESCRIPTION_END)
+					free(unpackDescription(buffer->packet));
+				releaseBuffer(buffer);
+				continue;
+			}
 
-		if (edge)
+			switch (type)
+			{
+				case QUEUE_REPLY:
+					queuePacket(neighbor, buffer, 0, 0, now);
+					break;
+				case QUEUE_REQUEST:
+					requestPacket(neighbor, buffer, now);
+					break;
+				case QUEUE_DESCRIPTION:
+					addDescription(neighbor, unpackDescription(buffer->packet));
+					break;
+				case QUEUE_DESCRIPTION_END:
+					addDescription(neighbor, unpackDescription(buffer->packet));
+					sendDescription(shard->fd, neighbor, label, now);
+					break;
+			}
+			releaseBuffer(buffer);
+			scheduleTransmit(neighbor);
+		}
+		// Send the packets flooded to each segment in this pass together to its group
+		sendSegments(neighbors, label);
+		// Send hellos, new and unacknowledged packets and held acknowledgements that are due,
+		// and detect neighbors that are down
+		advanceWheel(shard->wheel, now);
+		// Take the datagrams written to the shared rings, a ring's worth at most from each
+		for (i = 0; i < shard->ringCount; i++)
+			for (j = 0; j < SHM_SLOTS && (recvLen = readShmRing(shard->rings[i], recvBuffer, now)) > 0; j++)
+				processDatagram(shard->fd, recvBuffer, recvLen);
+		// Only wait on the socket if every ring is still empty once marked as sleeping, so
+		// that a neighbor writing to one from then on wakes us with a hello
+		wait = 1;
+		for (i = 0; i < shard->ringCount && wait; i++)
+			wait = sleepShmRing(shard->rings[i]);
+		// Receive datagram, waiting up to a tick. The ring also submits the datagrams sent in
+		// this pass, the blocking call times out as set on the socket.
+		if (threadRing)
+			recvLen = receiveUring(threadRing, &datagram, wait ? LS_TICK : 0);
+		else
 		{
-			// Add a random number between -4 and +4 to get the new cost
-			cost = edge->cost + (rand() % 9) - 4;
-			// If new cost is less than 1, set to 1
-			cost = cost < 1 ? 1 : cost;
-			// Build link-state packet to enact change to graph
-			buildLSPacket(packet, 6, (edge->seqN + 1) % 256, label, graph->key[edge->dest], cost);
-			// Display changes
-			printf("Changing cost to reach %c from %d to %d\n", graph->key[edge->dest], edge->cost, cost);
-			// Push packet onto queue to be processed
-			sem_wait(&recvLock);
-			push(recvQueue, packet);
-			sem_post(&recvLock);
+			// The segments' sockets are waited on together with our own, which is then
+			// only read if it has a datagram
+			if (wait && shard->pollCount > 1)
+			{
+				poll(shard->polls, shard->pollCount, LS_TICK / 1000);
+				wait = 0;
+			}
+			recvLen = recv(shard->fd, datagram = recvBuffer, LS_DATAGRAM_SIZE, wait ? 0 : MSG_DONTWAIT);
+		}
+		for (i = 0; i < shard->ringCount; i++)
+			wakeShmRing(shard->rings[i]);
+		// If datagram was received:
+		if (recvLen > 0)
+			processDatagram(shard->fd, datagram, recvLen);
+		// Take the datagrams flooded to the segments' groups, less the copies of our own
+		for (i = 1; i < shard->pollCount; i++)
+		{
+			for (j = 0; j < LS_SEGMENT_BATCH && (recvLen = recv(shard->polls[i].fd, recvBuffer, LS_DATAGRAM_SIZE, MSG_DONTWAIT)) > 0; j++)
+				if (recvLen < LS_HEADER_SIZE || getSenderID(recvBuffer) != label)
+					processDatagram(shard->fd, recvBuffer, recvLen);
 		}
 	}
 }
 
-int parseCommandLine(int argc, char **argv, char *label, int *port, int *numRouters, char **filename, int *dynamic)
+void processDatagram(int fd, char *datagram, int length)
 {
-	if (argc < 5) {
-		fprintf(stderr, "Not enough arguments. Use format:\n"
-		                "routerLabel portNum totalNumRouters discoverFile [-dynamic]\n");
-		return -1;
+	int i, count, priority;
+	char accepted[LS_MAX_PACKETS];
+	char *packet;
+	long long now;
+	struct Neighbor *neighbor;
+
+	if (capture && captureDatagram(capture, datagram, length, currentTime()) < 0)
+	{
+		perror("Capture stopped");
+		capture = NULL;
 	}
 
-	if (strlen(argv[1]) != 1)
+	// Datagrams from routers that are not neighbors of the shard are ignored
+	if (!isValidDatagram(datagram, length) || !(neighbor = findNeighbor(neighbors, getSenderID(datagram))) ||
+	    neighbor->shard != shard->index)
 	{
-		fprintf(stderr, "Please use a 1 character router label.\n");
-		return -1;
+		countMetric(METRIC_DATAGRAMS_DROPPED, 1);
+		return;
 	}
 
-	// Read command line arguments
-	*label = argv[1][0];
-	*port = atoi(argv[2]);
-	*numRouters = atoi(argv[3]);
-	*filename = argv[4];
+	now = currentTime();
+	count = getCount(datagram);
+	packet = datagram + LS_HEADER_SIZE;
 
-	// Set dynamic flag
-	if (argc >= 6 && !strcmp(argv[5], "-dynamic\0"))
-		*dynamic = 1;
-	else
-		*dynamic = 0;
+	// Any datagram shows the neighbor is alive
+	addTimer(shard->wheel, &neighbor->deadTimer, LS_DEAD_INTERVAL);
+	neighbor->datagramsReceived++;
+	countMetric(METRIC_DATAGRAMS_RECEIVED, 1);
 
-	return 0;
-}
+	sem_wait(&shard->recvLock);
 
-int initialization(int *fd, int port, int numRouters, char *filename, char label)
-{
-	// Create and bind socket
-	if ((*fd = initializeSocket(port)) < 0)
-		return -1;
+	// The first datagram from a neighbor starts the exchange of database descriptions
+	if (neighbor->state == NEIGHBOR_DOWN)
+	{
+		neighbor->state = NEIGHBOR_EXCHANGE;
+		push(shard->recvQueue, QUEUE_NEIGHBOR_UP, neighbor->label, packet, PRIORITY_URGENT);
+	}
 
-	// Initialize data structures
-	graph = newGraph(numRouters, 0);
-	neighbors = newNeighborList();
-	sendQueue = newFifoQueue();
-	recvQueue = newFifoQueue();
+	switch (getType(datagram))
+	{
+		case LS_TYPE_UPDATE:
+			// Push packets to received queue to be processed in main thread, those the
+			// neighbor marked urgent ahead of the others
+			priority = getFlags(datagram) & LS_FLAG_URGENT ? PRIORITY_URGENT : PRIORITY_BULK;
+			for (i = 0; i < count; i++)
+			{
+				TRACE_PACKET(TRACE_RECEIVED, packet + i * LS_PACKET_SIZE, neighbor->label);
+				if (!(accepted[i] = push(shard->recvQueue, QUEUE_UPDATE, neighbor->label, packet + i * LS_PACKET_SIZE, priority) >= 0))
+					countMetric(METRIC_PACKETS_REFUSED, 1);
+				answerRequest(neighbor, packet + i * LS_PACKET_SIZE);
+			}
+			countMetric(METRIC_PACKETS_RECEIVED, count);
+			break;
 
-	if (!graph || !neighbors || !sendQueue || !recvQueue) {
-		printf("Malloc failed.\n");
-		return -1;
-	}
+		case LS_TYPE_DESCRIPTION:
+			// Summaries are collected in the neighbor entry and handed over in one queue entry,
+			// so a description of any size fits in the received queue
+			for (i = 0; i < count; i++)
+				addSummary(&neighbor->peerDescription, packet + i * LS_SUMMARY_SIZE);
+			if (getFlags(datagram) & LS_FLAG_MORE)
+				break;
+			push(shard->recvQueue, QUEUE_PEER_DESCRIPTION, neighbor->label, packet, PRIORITY_BULK);
+			// Describe our database again if the neighbor has not received our description
+			if (receiveDescription(neighbor, getFlags(datagram)))
+				push(shard->recvQueue, QUEUE_NEIGHBOR_UP, neighbor->label, packet, PRIORITY_URGENT);
+			break;
 
-	// Initialize semaphores
-	if(sem_init(&sendLock, 0, 1) != 0) {
-		printf("Sem init failed.\n");
-		return -1;
+		case LS_TYPE_REQUEST:
+			for (i = 0; i < count; i++)
+				addSummary(&neighbor->peerRequests, packet + i * LS_SUMMARY_SIZE);
+			push(shard->recvQueue, QUEUE_PEER_REQUESTS, neighbor->label, packet, PRIORITY_BULK);
+			break;
+
+		case LS_TYPE_ACK:
+			for (i = 0; i < count; i++)
+				acknowledgePacket(neighbor, packet + i * LS_SUMMARY_SIZE, now);
+			break;
 	}
-	if(sem_init(&recvLock, 0, 1) != 0) {
-		printf("Sem init failed.\n");
-		return -1;
+
+	setGauge(METRIC_RECV_QUEUE_DEPTH, shard->index, shard->recvQueue->size);
+	sem_post(&shard->recvLock);
+
+	// Every packet taken by the received queue is acknowledged, including duplicates whose
+	// acknowledgement was lost. A refused packet is left for the neighbor to retransmit.
+	if (getType(datagram) == LS_TYPE_UPDATE)
+	{
+		for (i = 0; i < count; i++)
+		{
+			if (accepted[i])
+				queueAck(fd, neighbor, label, packet + i * LS_PACKET_SIZE, now);
+		}
+		scheduleTransmit(neighbor);
 	}
+}
 
-	// Read discovery text file to find adjacent neighbor nodes
-	if (processTextFile(filename, neighbors) < 0)
-		return -1;
-	// Push neighbor edges to received queue to be processed in main loop
-	queueNeighbors(neighbors, recvQueue, label);
+void helloTimeout(void *arg)
+{
+	struct Neighbor *neighbor = (struct Neighbor *) arg;
 
-	return 0;
+	sendHello(shard->fd, neighbor, label);
+	// Jitter the interval by up to a tenth either way so hellos do not synchronize
+	addTimer(shard->wheel, &neighbor->helloTimer, LS_HELLO_INTERVAL - LS_HELLO_INTERVAL / 10 + rand() % (LS_HELLO_INTERVAL / 5));
 }
 
-int startNetworkThread(int *fd)
+void deadTimeout(void *arg)
 {
-	int err;
-	pthread_t network_thread;
-	// Start network thread
-	if ((err = pthread_create(&network_thread, NULL, &networkThread, fd))) {
-		fprintf(stderr, "Can't create Network Thread: [%s]\n", strerror(err));
-		return -1;
-	}
+	struct Neighbor *neighbor = (struct Neighbor *) arg;
+	char packet[LS_PACKET_SIZE];
 
-	return 0;
+	memset(packet, 0, LS_PACKET_SIZE);
+
+	sem_wait(&shard->recvLock);
+	resetNeighbor(neighbor);
+	push(shard->recvQueue, QUEUE_NEIGHBOR_DOWN, neighbor->label, packet, PRIORITY_URGENT);
+	sem_post(&shard->recvLock);
 }
 
-int startDynamicThread(char *label)
+void transmitTimeout(void *arg)
 {
-	int err;
-	pthread_t dynamic_thread;
+	struct Neighbor *neighbor = (struct Neighbor *) arg;
 
-	if(sem_init(&dynamLock, 0, 1) != 0) {
-		printf("Sem init failed.\n");
-		return -1;
-	}
-	// Block dynamic thread until after first shortest path calculation
-	sem_wait(&dynamLock);
+	transmitPackets(shard->fd, neighbor, label, currentTime());
+	scheduleTransmit(neighbor);
+}
+
+void captureTimeout(void *arg)
+{
+	if (!capture)
+		return;
+
+	if (flushCapture(capture) < 0)
+	{
+		perror("Capture stopped");
+		capture = NULL;
+		return;
+	}
+
+	addTimer(shard->wheel, &captureTimer, LS_CAPTURE_FLUSH);
+}
+
+void scheduleTransmit(struct Neighbor *neighbor)
+{
+	if (neighbor->transmitTime != LLONG_MAX)
+		scheduleTimer(shard->wheel, &neighbor->transmitTimer, neighbor->transmitTime);
+}
+
+void *commandThread(void *param)
+{
+	int cost;
+	long long sent, hellos, received;
+	char line[128], peer[LS_ID_LENGTH + 1], packet[LS_PACKET_SIZE];
+	struct Neighbor *neighbor;
+	struct Segment *segment;
+
+	while (fgets(line, sizeof(line), stdin))
+	{
+		if (sscanf(line, "cost %6s %d", peer, &cost) == 2)
+		{
+			if (!(neighbor = findNeighbor(neighbors, parseRouterID(peer))) || cost < 1 || cost == LS_WITHDRAW_COST)
+			{
+				fprintf(stderr, "No link to %s with a cost of %d\n", peer, cost);
+				continue;
+			}
+
+			// The main thread originates the change, as only it knows the sequence number
+			buildLSPacket(packet, LS_SEQUENCE_NONE, label, neighbor->label, cost);
+			sem_wait(&shards[neighbor->shard].recvLock);
+			push(shards[neighbor->shard].recvQueue, QUEUE_COST_CHANGE, neighbor->label, packet, PRIORITY_URGENT);
+			sem_post(&shards[neighbor->shard].recvLock);
+		}
+		else if (!strncmp(line, "stats", 5))
+		{
+			// The counters are read without the network thread's cooperation, which may
+			// leave the totals a datagram or two behind
+			sent = hellos = received = 0;
+			for (neighbor = neighbors->head; neighbor; neighbor = neighbor->next)
+			{
+				sent += neighbor->datagramsSent;
+				hellos += neighbor->hellosSent;
+				received += neighbor->datagramsReceived;
+			}
+			// A datagram flooded to a segment is sent once for all of its neighbors
+			for (segment = neighbors->segments; segment; segment = segment->next)
+				sent += segment->datagramsSent;
+			printf("Datagrams sent: %lld, hellos sent: %lld, received: %lld\n", sent, hellos, received);
+		}
+		else if (!strncmp(line, "metrics", 7))
+			writeMetrics(stdout);
+		else if (line[0] != '\n')
+			fprintf(stderr, "Unknown command: %s", line);
+	}
+
+	return NULL;
+}
+
+void neighborStarted(uint16_t peer)
+{
+	struct Neighbor *neighbor = findNeighbor(neighbors, peer);
+
+	if (!neighbor || neighbor->started)
+		return;
+
+	neighbor->started = 1;
+
+	if (startupPending > 0 && --startupPending == 0)
+		finishStartup();
+}
+
+void startupTimeout(void *arg)
+{
+	finishStartup();
+}
+
+void finishStartup()
+{
+	int up;
+	long long now = currentTime();
+
+	if (startupPending < 0)
+		return;
+
+	removeTimer(&startupTimer);
+
+	if (startupPending)
+	{
+		up = neighbors->size - startupPending;
+		printf("Started with %d of %d neighbors up after %.1f s\n", up, neighbors->size, (now - startTime) / 1000000.0);
+	}
+	else
+		printf("Started with all %d neighbors up in %.1f ms\n", neighbors->size, (now - startTime) / 1000.0);
+
+	startupPending = -1;
+
+	// The restored records wait for the neighbors up now to describe their databases,
+	// at most for a dead interval in case one of them goes down first
+	if (unverifiedRecords)
+	{
+		if (allDescribed())
+			flushUnverified();
+		else
+			addTimer(mainWheel, &verifyTimer, LS_DEAD_INTERVAL);
+	}
+
+	if (churn && churn->linkCount)
+	{
+		churn->reportTime = now;
+		churn->next = nextChurnTime(churn, now);
+		addTimer(mainWheel, &churnTimer, churn->next - now);
+	}
+	else if (churn)
+		fprintf(stderr, "No links to churn\n");
+}
+
+void churnTimeout(void *arg)
+{
+	int batch;
+	long long now = currentTime();
+
+	// A rate faster than the ticks makes every change that fell due since the last one
+	for (batch = 0; batch < CHURN_MAX_BATCH && churn->next <= now && (!churn->limit || churn->changes < churn->limit); batch++)
+	{
+		if (churnLink(pickChurnLink(churn)))
+		{
+			churn->changes++;
+			countMetric(METRIC_CHURN_CHANGES, 1);
+		}
+		churn->next = nextChurnTime(churn, churn->next);
+	}
+
+	if (churn->rate > CHURN_PRINT_RATE && now - churn->reportTime >= CHURN_REPORT_INTERVAL)
+	{
+		printf("Churn made %lld changes in %.1f s, %.0f per second, %.1f ms behind\n", churn->changes - churn->reported,
+		       (now - churn->reportTime) / 1000000.0, (churn->changes - churn->reported) * 1000000.0 / (now - churn->reportTime),
+		       churn->next < now ? (now - churn->next) / 1000.0 : 0.0);
+		churn->reported = churn->changes;
+		churn->reportTime = now;
+	}
+
+	if (churn->limit && churn->changes >= churn->limit)
+	{
+		printf("Churn finished after %lld changes\n", churn->changes);
+		return;
+	}
+
+	addTimer(mainWheel, &churnTimer, churn->next - now);
+}
+
+int churnLink(struct ChurnLink *link)
+{
+	int cost;
+	char dest[LS_ID_LENGTH];
+	struct AdjListNode *edge = lookupEdge(label, link->peer);
+	int print = churn->rate <= CHURN_PRINT_RATE;
+
+	// A link withdrawn because its neighbor is down is left alone. One the flap pattern
+	// withdrew may have been removed along with a neighbor it cut off, and is still restored
+	if (!link->withdrawn && (!edge || edge->cost == LS_WITHDRAW_COST))
+		return 0;
+
+	formatRouterID(link->peer, dest);
+
+	if (churn->pattern == CHURN_FLAP)
+	{
+		link->withdrawn = !link->withdrawn;
+		if (print)
+			printf("%s link to %s\n", link->withdrawn ? "Withdrawing" : "Restoring", dest);
+		originateNeighborLink(link->peer, !link->withdrawn);
+		return 1;
+	}
+
+	if (churn->pattern == CHURN_TOGGLE)
+		cost = edge->cost != link->cost ? link->cost : churn->toggleCost ? churn->toggleCost : 2 * link->cost;
+	else
+	{
+		// Add a random number between -4 and +4 to get the new cost, no less than 1
+		cost = edge->cost + (int) (churnRandom(churn) * 9) - 4;
+		cost = cost < 1 ? 1 : cost;
+	}
+
+	if (print)
+		printf("Changing cost to reach %s from %d to %d\n", dest, edge->cost, cost);
+
+	changeNeighborCost(link->peer, cost);
+
+	return 1;
+}
+
+void queueForNetwork(int type, uint16_t peer, const char *packet, int priority)
+{
+	int i;
+
+	if (type == QUEUE_UPDATE)
+	{
+		for (i = 0; i < shardCount; i++)
+			queueForShard(&shards[i], type, peer, packet, priority);
+	}
+	else
+		queueForShard(&shards[getShard(peer, shardCount)], type, peer, packet, priority);
+}
+
+void queueForShard(struct Shard *target, int type, uint16_t peer, const char *packet, int priority)
+{
+	int result;
+
+	sem_wait(&target->sendLock);
+	result = push(target->sendQueue, type, peer, packet, priority);
+	setGauge(METRIC_SEND_QUEUE_DEPTH, target->index, target->sendQueue->size);
+	sem_post(&target->sendLock);
+
+	// Nothing from the main thread may be lost, wait for the network thread to make room
+	while (result < 0)
+	{
+		usleep(LS_TICK);
+
+		sem_wait(&target->sendLock);
+		result = push(target->sendQueue, type, peer, packet, priority);
+		sem_post(&target->sendLock);
+	}
+}
+
+int popReceived(char *packet, uint16_t *peer)
+{
+	int i, type;
+	long long queued;
+	struct Shard *next;
+
+	for (i = 0; i < shardCount; i++)
+	{
+		next = &shards[(nextShard + i) % shardCount];
+		if (isEmptyQueue(next->recvQueue))
+			continue;
+
+		sem_wait(&next->recvLock);
+		type = pop(next->recvQueue, packet, peer);
+		queued = next->recvQueue->poppedTime;
+		setGauge(METRIC_RECV_QUEUE_DEPTH, next->index, next->recvQueue->size);
+		sem_post(&next->recvLock);
+
+		if (next->recvQueue->timed)
+			observeMetric(METRIC_RECV_QUEUE_WAIT, currentTime() - queued);
+
+		nextShard = (next->index + 1) % shardCount;
+		return type;
+	}
+
+	return 0;
+}
+
+int isReceivedEmpty()
+{
+	int i;
+
+	for (i = 0; i < shardCount; i++)
+		if (!isEmptyQueue(shards[i].recvQueue))
+			return 0;
+
+	return 1;
+}
+
+void changeNeighborCost(uint16_t peer, int cost)
+{
+	char packet[LS_PACKET_SIZE];
+	struct Neighbor *neighbor = findNeighbor(neighbors, peer);
+	struct AdjListNode *edge = lookupEdge(label, peer);
+
+	if (!neighbor)
+		return;
+
+	neighbor->cost = cost;
+
+	if (!edge || edge->cost == LS_WITHDRAW_COST || edge->cost == cost)
+		return;
+
+	buildLSPacket(packet, nextSequence(edge->seqN), label, peer, cost);
+	processPacket(packet, label);
+}
+
+void processPacket(char *packet, uint16_t peer)
+{
+	int result, priority;
+	struct AdjListNode *edge;
+
+	// A packet at the maximum age is being flushed and is not installed again
+	if (peer != label && getAge(packet) >= LS_MAX_AGE)
+		return;
+	// Our own packet received from a neighbor with a newer sequence number than ours
+	// is left over from before a restart, supersede it with a fresh origination
+	if (peer != label && getSourceID(packet) == label && supersedeOwnPacket(packet, label))
+		peer = label;
+	if (peer == label)
+		TRACE_PACKET(TRACE_ORIGINATED, packet, LS_ROUTER_NONE);
+	// A packet changing the cost of a link, withdrawing it or adding it changes the
+	// topology and is flooded ahead of refreshes
+	edge = lookupEdge(getSourceID(packet), getDestinationID(packet));
+	priority = !edge || edge->cost != getCost(packet) ? PRIORITY_URGENT : PRIORITY_BULK;
+	// Update the graph
+	result = addEdgeFromPacket(graph, packet);
+	countMetric(result > 0 ? METRIC_PACKETS_ACCEPTED : METRIC_PACKETS_REJECTED, 1);
+	// If the packet was newer than the graph, flood it to every other neighbor on network thread
+	if (result > 0)
+	{
+		TRACE_PACKET(TRACE_APPLIED, packet, LS_ROUTER_NONE);
+		ageRecord(packet);
+		setAge(packet, getAge(packet) + LS_TRANSIT_AGE);
+		queueForNetwork(QUEUE_UPDATE, peer, packet, priority);
+	}
+	// If a neighbor sent a packet older than the graph, answer with the newer copy
+	else if (result == 0 && peer != label &&
+	         (edge = lookupEdge(getSourceID(packet), getDestinationID(packet))) &&
+	         compareSequence(edge->seqN, getSequenceNumber(packet)) > 0)
+		replyWithEdge(edge, packet, peer);
+}
+
+void compareSummary(char *summary, uint16_t peer)
+{
+	int newer;
+	struct AdjListNode *edge = lookupEdge(getSourceID(summary), getDestinationID(summary));
+
+	newer = edge ? compareSequence(getSequenceNumber(summary), edge->seqN) : 1;
+
+	// A restored record the neighbor holds in any instance is still in the network
+	if (edge)
+		edge->unverified = 0;
+
+	if (newer > 0)
+		queueForNetwork(QUEUE_REQUEST, peer, summary, PRIORITY_BULK);
+	else if (newer < 0)
+		replyWithEdge(edge, summary, peer);
+}
+
+void processSummaries(int type, uint16_t peer)
+{
+	int i, count;
+	char *summaries, summary[LS_PACKET_SIZE];
+	struct AdjListNode *edge;
+	struct Neighbor *neighbor = findNeighbor(neighbors, peer);
+
+	if (!neighbor)
+		return;
+
+	sem_wait(&shards[neighbor->shard].recvLock);
+	summaries = takeSummaries(type == QUEUE_PEER_DESCRIPTION ? &neighbor->peerDescription : &neighbor->peerRequests, &count);
+	sem_post(&shards[neighbor->shard].recvLock);
+
+	for (i = 0; i < count; i++)
+	{
+		// Copied into a packet sized buffer since a reply is built in place
+		memcpy(summary, summaries + i * LS_SUMMARY_SIZE, LS_SUMMARY_SIZE);
+
+		if (type == QUEUE_PEER_DESCRIPTION)
+			compareSummary(summary, peer);
+		else if ((edge = lookupEdge(getSourceID(summary), getDestinationID(summary))))
+			replyWithEdge(edge, summary, peer);
+	}
+
+	free(summaries);
+
+	// The databases described to us after a restart show which restored records are gone
+	// from the network. The summaries are only handed over once a description is whole.
+	if (type == QUEUE_PEER_DESCRIPTION && unverifiedRecords)
+	{
+		neighbor->described = 1;
+		if (allDescribed())
+			flushUnverified();
+	}
+}
+
+void replyWithEdge(struct AdjListNode *edge, char *buffer, uint16_t peer)
+{
+	buildLSPacket(buffer, edge->seqN, getSourceID(buffer), getDestinationID(buffer), edge->cost);
+	setAge(buffer, getRecordAge(edge) + LS_TRANSIT_AGE);
+	queueForNetwork(QUEUE_REPLY, peer, buffer, PRIORITY_BULK);
+}
+
+void describeDatabase(uint16_t peer)
+{
+	int i;
+	char packet[LS_PACKET_SIZE];
+	struct AdjListNode *edge;
+	struct Description *description, *full;
+
+	if (!(description = newDescription()))
+		return;
+
+	full = NULL;
+	for (i = 0; i < graph->size; i++)
+	{
+		if (!graph->key[i])
+			continue;
+
+		// Only the edges leaving a router hold the packets it originated
+		for (edge = graph->array[i].head; edge; edge = edge->next)
+		{
+			if (edge->seqN == LS_SEQUENCE_NONE)
+				continue;
+
+			// A full datagram is only queued once another summary shows that more follow
+			if (full)
+			{
+				full->more = 1;
+				packDescription(packet, full);
+				queueForNetwork(QUEUE_DESCRIPTION, peer, packet, PRIORITY_BULK);
+				if (!(description = newDescription()))
+					return;
+				full = NULL;
+			}
+
+			buildLSPacket(packet, edge->seqN, graph->key[i], graph->key[edge->dest], edge->cost);
+			setAge(packet, getRecordAge(edge));
+			if (describeSummary(description, packet))
+				full = description;
+		}
+	}
+
+	// An empty database is still described by a single empty datagram
+	packDescription(packet, description);
+	queueForNetwork(QUEUE_DESCRIPTION_END, peer, packet, PRIORITY_BULK);
+}
+
+void originateNeighborLink(uint16_t peer, int up)
+{
+	char packet[LS_PACKET_SIZE];
+	struct Neighbor *neighbor = findNeighbor(neighbors, peer);
+	struct AdjListNode *edge = lookupEdge(label, peer);
+
+	if (!neighbor)
+		return;
+
+	// A link removed along with the unreachable neighbor is originated afresh, any
+	// copy left elsewhere with a later sequence number is superseded when it is received
+	if (!edge)
+	{
+		if (up)
+		{
+			buildLSPacket(packet, LS_INITIAL_SEQUENCE, label, peer, neighbor->cost);
+			processPacket(packet, label);
+		}
+		return;
+	}
+
+	// Only a change in the state of the link is originated. A link only the neighbor has
+	// advertised so far is originated once it comes up.
+	if (edge->seqN == LS_SEQUENCE_NONE ? !up : (edge->cost != LS_WITHDRAW_COST) == up)
+		return;
+
+	buildLSPacket(packet, nextSequence(edge->seqN), label, peer, up ? neighbor->cost : LS_WITHDRAW_COST);
+	processPacket(packet, label);
+}
+
+void ageRecord(char *packet)
+{
+	struct AdjListNode *edge = lookupEdge(getSourceID(packet), getDestinationID(packet));
+	long long age = getAge(packet) * 1000000LL;
+
+	if (!edge)
+		return;
+
+	edge->originTime = currentTime() - age;
+	removeTimer(&edge->ageTimer);
+	initTimer(&edge->ageTimer, expireRecord, edge);
+	addTimer(mainWheel, &edge->ageTimer, LS_MAX_AGE * 1000000LL - age);
+}
+
+int getRecordAge(struct AdjListNode *edge)
+{
+	long long age = (currentTime() - edge->originTime) / 1000000;
+
+	return age < LS_MAX_AGE ? age : LS_MAX_AGE;
+}
+
+void expireRecord(void *arg)
+{
+	struct AdjListNode *edge = (struct AdjListNode *) arg;
+	struct AdjListNode *reverse = findEdge(graph, edge->dest, edge->source);
+
+	// The link stays while the other router's record for it is alive, at that record's cost
+	if (reverse && reverse->seqN != LS_SEQUENCE_NONE)
+	{
+		if (edge->cost != reverse->cost)
+			graph->updated = 1;
+		edge->seqN = LS_SEQUENCE_NONE;
+		edge->cost = reverse->cost;
+	}
+	else
+		removeEdge(graph, edge->source, edge->dest);
+}
+
+void refreshLinks(void *arg)
+{
+	int i;
+	char packet[LS_PACKET_SIZE];
+	struct AdjListNode *edge;
+
+	// Every refresh is queued before the network thread runs, so they share datagrams
+	if ((i = findIndex(graph, label)) >= 0)
+	{
+		for (edge = graph->array[i].head; edge; edge = edge->next)
+		{
+			// Withdrawn links are left to age out
+			if (edge->seqN == LS_SEQUENCE_NONE || edge->cost == LS_WITHDRAW_COST)
+				continue;
+
+			buildLSPacket(packet, nextSequence(edge->seqN), label, graph->key[edge->dest], edge->cost);
+			processPacket(packet, label);
+		}
+	}
+
+	// Jitter the interval so the routers' refreshes do not synchronize
+	addTimer(mainWheel, &refreshTimer, LS_REFRESH_INTERVAL * 1000000LL - rand() % (LS_REFRESH_INTERVAL * 100000));
+}
+
+struct AdjListNode *lookupEdge(uint16_t source, uint16_t dest)
+{
+	int srcI = findIndex(graph, source);
+	int destI = findIndex(graph, dest);
+
+	if (srcI < 0 || destI < 0)
+		return NULL;
+
+	return findEdge(graph, srcI, destI);
+}
+
+void checkpointTimeout(void *arg)
+{
+	if (!checkpoint)
+		return;
+
+	if (saveDatabase() < 0)
+	{
+		perror("Checkpoint stopped");
+		checkpoint = NULL;
+		return;
+	}
+
+	addTimer(mainWheel, &checkpointTimer, LS_CHECKPOINT_INTERVAL);
+}
+
+int saveDatabase()
+{
+	int i, count;
+	char *packets;
+	struct AdjListNode *edge;
+
+	// Withdrawn links are not saved, a restored router has no edge to hold them
+	count = 0;
+	for (i = 0; i < graph->size; i++)
+		for (edge = graph->array[i].head; edge; edge = edge->next)
+			if (edge->seqN != LS_SEQUENCE_NONE && edge->cost != LS_WITHDRAW_COST)
+				count++;
+
+	if (!(packets = beginCheckpoint(checkpoint, count)))
+		return -1;
+
+	count = 0;
+	for (i = 0; i < graph->size; i++)
+	{
+		for (edge = graph->array[i].head; edge; edge = edge->next)
+		{
+			if (edge->seqN == LS_SEQUENCE_NONE || edge->cost == LS_WITHDRAW_COST)
+				continue;
+
+			buildLSPacket(packets + count * LS_PACKET_SIZE, edge->seqN, graph->key[i], graph->key[edge->dest], edge->cost);
+			setAge(packets + count * LS_PACKET_SIZE, getRecordAge(edge));
+			count++;
+		}
+	}
+
+	commitCheckpoint(checkpoint);
+
+	return count;
+}
+
+void restoreDatabase()
+{
+	int i, count, elapsed, restored;
+	long long start;
+	const char *packets;
+	char packet[LS_PACKET_SIZE];
+	struct Neighbor *neighbor;
+	struct AdjListNode *edge;
+
+	start = currentTime();
+	restored = 0;
+
+	if (!(count = loadCheckpoint(checkpoint, &packets, &elapsed)))
+		return;
+
+	for (i = 0; i < count; i++)
+	{
+		memcpy(packet, packets + i * LS_PACKET_SIZE, LS_PACKET_SIZE);
+
+		// Records that would have aged out while the router was down are not restored
+		if (getAge(packet) + elapsed >= LS_MAX_AGE)
+			continue;
+		setAge(packet, getAge(packet) + elapsed);
+
+		// Our own links continue from the saved sequence numbers, replacing the
+		// originations queued from the neighbor file. Links no longer in the file are
+		// left to be withdrawn when a neighbor sends them back.
+		if (getSourceID(packet) == label)
+		{
+			if ((neighbor = findNeighbor(neighbors, getDestinationID(packet))))
+			{
+				buildLSPacket(packet, nextSequence(getSequenceNumber(packet)), label, neighbor->label, neighbor->cost);
+				push(shards[0].recvQueue, QUEUE_UPDATE, label, packet, PRIORITY_BULK);
+			}
+			continue;
+		}
+
+		if (addEdgeFromPacket(graph, packet) <= 0)
+			continue;
+
+		ageRecord(packet);
+		if ((edge = lookupEdge(getSourceID(packet), getDestinationID(packet))))
+			edge->unverified = 1;
+		restored++;
+	}
+
+	unverifiedRecords = restored > 0;
+	initTimer(&verifyTimer, verifyTimeout, NULL);
+
+	printf("Restored %d records saved %d s ago in %.3f ms\n", restored, elapsed, (currentTime() - start) / 1000.0);
+}
+
+int allDescribed()
+{
+	struct Neighbor *neighbor;
+
+	if (startupPending >= 0)
+		return 0;
+
+	for (neighbor = neighbors->head; neighbor; neighbor = neighbor->next)
+		if (neighbor->started && !neighbor->described)
+			return 0;
+
+	return 1;
+}
+
+void verifyTimeout(void *arg)
+{
+	if (unverifiedRecords)
+		flushUnverified();
+}
+
+void flushUnverified()
+{
+	int i, flushed;
+	struct AdjListNode *edge, *next;
+
+	removeTimer(&verifyTimer);
+
+	flushed = 0;
+	for (i = 0; i < graph->size; i++)
+	{
+		for (edge = graph->array[i].head; edge; edge = next)
+		{
+			next = edge->next;
+
+			if (!edge->unverified)
+				continue;
+
+			edge->unverified = 0;
+			removeTimer(&edge->ageTimer);
+			expireRecord(edge);
+			flushed++;
+		}
+	}
+
+	unverifiedRecords = 0;
+
+	if (flushed)
+		printf("Flushed %d restored records the neighbors' databases do not hold\n", flushed);
+}
+
+int supersedeOwnPacket(char *packet, uint16_t label)
+{
+	uint16_t dest = getDestinationID(packet);
+	int32_t seqN = getSequenceNumber(packet);
+	struct AdjListNode *edge = lookupEdge(label, dest);
+
+	// Only an instance newer than our copy needs to be superseded
+	if (edge && compareSequence(seqN, edge->seqN) <= 0)
+		return 0;
+
+	if (edge)
+	{
+		buildLSPacket(packet, nextSequence(seqN), label, dest, edge->cost);
+		return 1;
+	}
+
+	// Install the stale link so that the withdrawal has an edge to supersede
+	addEdgeFromPacket(graph, packet);
+	buildLSPacket(packet, nextSequence(seqN), label, dest, LS_WITHDRAW_COST);
+
+	return 1;
+}
+
+int parseCommandLine(int argc, char **argv, uint16_t *label, int *port, int *numRouters, char **filename, char **churn, char **metrics, char **trace, char **capture, char **saved, int *io, int *shards, int *shm, int *multicast, double *pace, long long *batch)
+{
+	int i;
+
+	if (argc < 5) {
+		fprintf(stderr, "Not enough arguments. Use format:\n"
+		                "routerLabel portNum totalNumRouters discoverFile [-dynamic] [-churn settings] [-metrics socketPath] [-trace directory] [-capture file] [-checkpoint file] [-io blocking|uring|sqpoll] [-shards n] [-transport udp|shm] [-flood unicast|multicast] [-pace datagramsPerSecond] [-batch microseconds]\n"
+		                "-spf-only topologyFile routerLabel|all\n");
+		return -1;
+	}
+
+	if (!(*label = parseRouterID(argv[1])))
+	{
+		fprintf(stderr, "Please use a router label of 1 to %d or a single character.\n", LS_MAX_ROUTER_ID);
+		return -1;
+	}
+
+	// Read command line arguments
+	*port = atoi(argv[2]);
+	*numRouters = atoi(argv[3]);
+	*filename = argv[4];
+
+	*churn = NULL;
+	*metrics = NULL;
+	*trace = NULL;
+	*capture = NULL;
+	*saved = NULL;
+	*io = IO_BLOCKING;
+	*shards = 1;
+	*shm = 0;
+	*multicast = 0;
+	*pace = 0;
+	*batch = 0;
+
+	// Read options
+	for (i = 5; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-dynamic"))
+			*churn = "";
+		else if (!strcmp(argv[i], "-churn") && i + 1 < argc)
+			*churn = argv[++i];
+		else if (!strcmp(argv[i], "-metrics") && i + 1 < argc)
+			*metrics = argv[++i];
+		else if (!strcmp(argv[i], "-capture") && i + 1 < argc)
+			*capture = argv[++i];
+		else if (!strcmp(argv[i], "-checkpoint") && i + 1 < argc)
+			*saved = argv[++i];
+		else if (!strcmp(argv[i], "-io") && i + 1 < argc)
+		{
+			i++;
+			if (!strcmp(argv[i], "blocking"))
+				*io = IO_BLOCKING;
+			else if (!strcmp(argv[i], "uring"))
+				*io = IO_URING;
+			else if (!strcmp(argv[i], "sqpoll"))
+				*io = IO_URING_SQPOLL;
+			else
+			{
+				fprintf(stderr, "Unknown socket backend %s\n", argv[i]);
+				return -1;
+			}
+		}
+		else if (!strcmp(argv[i], "-transport") && i + 1 < argc)
+		{
+			i++;
+			if (!strcmp(argv[i], "udp"))
+				*shm = 0;
+			else if (!strcmp(argv[i], "shm"))
+				*shm = 1;
+			else
+			{
+				fprintf(stderr, "Unknown transport %s\n", argv[i]);
+				return -1;
+			}
+		}
+		else if (!strcmp(argv[i], "-flood") && i + 1 < argc)
+		{
+			i++;
+			if (!strcmp(argv[i], "unicast"))
+				*multicast = 0;
+			else if (!strcmp(argv[i], "multicast"))
+				*multicast = 1;
+			else
+			{
+				fprintf(stderr, "Unknown flooding %s\n", argv[i]);
+				return -1;
+			}
+		}
+		else if (!strcmp(argv[i], "-pace") && i + 1 < argc)
+		{
+			if ((*pace = atof(argv[++i])) < 0)
+			{
+				fprintf(stderr, "Please use a pace of 0 or more datagrams per second.\n");
+				return -1;
+			}
+		}
+		else if (!strcmp(argv[i], "-batch") && i + 1 < argc)
+		{
+			if ((*batch = atoll(argv[++i])) < 0)
+			{
+				fprintf(stderr, "Please use a batching window of 0 or more microseconds.\n");
+				return -1;
+			}
+		}
+		else if (!strcmp(argv[i], "-shards") && i + 1 < argc)
+		{
+			if ((*shards = atoi(argv[++i])) < 1 || *shards > LS_MAX_SHARDS)
+			{
+				fprintf(stderr, "Please use 1 to %d shards.\n", LS_MAX_SHARDS);
+				return -1;
+			}
+		}
+		else if (!strcmp(argv[i], "-trace") && i + 1 < argc)
+		{
+#ifdef LS_TRACE
+			*trace = argv[++i];
+#else
+			fprintf(stderr, "Tracing needs a router built with make TRACE=1\n");
+			return -1;
+#endif
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	// A capture is one stream of datagrams, as replayed into a single network thread
+	if (*capture && *shards > 1)
+	{
+		fprintf(stderr, "Capturing needs a single shard.\n");
+		return -1;
+	}
+
+	// A datagram sent to a group reaches every shard, which would each flood it again
+	if (*multicast && *shards > 1)
+	{
+		fprintf(stderr, "Multicast flooding needs a single shard.\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+int runSPFOnly(const char *filename, const char *root)
+{
+	int i, r, first, last;
+	int *cost, *hop;
+	long long start, mapped, searched, reachable, longest;
+	char dest[LS_ID_LENGTH], forward[LS_ID_LENGTH];
+	struct Topology topology;
+	struct TopologySearch search;
+
+	start = currentTime();
+
+	if (mapTopologyFile(filename, &topology) < 0)
+		return -1;
+
+	first = 0;
+	last = topology.routers - 1;
+	if (strcmp(root, "all") && (first = last = findTopologyIndex(&topology, parseRouterID(root))) < 0)
+	{
+		fprintf(stderr, "Router %s is not in %s\n", root, filename);
+		unmapTopology(&topology);
+		return -1;
+	}
+
+	cost = (int *) malloc(topology.routers * sizeof(int));
+	hop = (int *) malloc(topology.routers * sizeof(int));
+
+	if (!cost || !hop || newTopologySearch(&topology, &search) < 0)
+	{
+		printf("Malloc failed.\n");
+		free(cost);
+		free(hop);
+		unmapTopology(&topology);
+		return -1;
+	}
+
+	mapped = currentTime();
+	reachable = longest = 0;
+
+	for (r = first; r <= last; r++)
+	{
+		topologyPaths(&topology, &search, r, cost, hop);
+
+		for (i = 0; i < topology.routers; i++)
+			if (i != r && cost[i] != INT_MAX)
+			{
+				reachable++;
+				if (cost[i] > longest)
+					longest = cost[i];
+			}
+	}
+
+	searched = currentTime();
+
+	if (first == last)
+	{
+		printf("Destination | Forward to | Cost\n");
+		for (i = 0; i < topology.routers; i++)
+		{
+			if (cost[i] == INT_MAX)
+				continue;
+
+			formatRouterID(topology.key[i], dest);
+			if (hop[i] < 0)
+				strcpy(forward, "-");
+			else
+				formatRouterID(topology.key[hop[i]], forward);
+
+			printf("%-11s | %-10s | %d\n", dest, forward, cost[i]);
+		}
+		printf("\n");
+	}
+
+	printf("Started on %d routers and %d edges in %.3f ms\n", topology.routers, topology.edges, (mapped - start) / 1000.0);
+	printf("%d shortest path calculations in %.3f ms, %.1f us each\n", last - first + 1, (searched - mapped) / 1000.0,
+	       (double) (searched - mapped) / (last - first + 1));
+	printf("%lld router pairs reachable, longest path cost %lld\n", reachable, longest);
+
+	freeTopologySearch(&search);
+	free(cost);
+	free(hop);
+	unmapTopology(&topology);
+
+	return 0;
+}
+
+int initialization(int port, int numRouters, char *filename, uint16_t label, int count, double pace, long long batch)
+{
+	int i, capacity;
+	int fds[LS_MAX_SHARDS];
+	struct Neighbor *neighbor;
+
+	// Create and bind a socket for each shard
+	if (initializeShards(port, fds, count) < 0)
+		return -1;
+
+	// Initialize data structures
+	graph = newGraph(numRouters, 0);
+	neighbors = newNeighborList();
+	shards = (struct Shard *) calloc(count, sizeof(struct Shard));
+	mainWheel = newTimerWheel(LS_TICK, currentTime());
+
+	if (!graph || !neighbors || !shards || !mainWheel) {
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		shards[i].index = i;
+		shards[i].fd = fds[i];
+		shards[i].sendQueue = newFifoQueue(LS_SEND_CAPACITY, 0);
+		shards[i].wheel = newTimerWheel(LS_TICK, currentTime());
+
+		if (!shards[i].sendQueue || !shards[i].wheel) {
+			printf("Malloc failed.\n");
+			return -1;
+		}
+
+		// Initialize semaphores
+		if(sem_init(&shards[i].sendLock, 0, 1) != 0) {
+			printf("Sem init failed.\n");
+			return -1;
+		}
+		if(sem_init(&shards[i].recvLock, 0, 1) != 0) {
+			printf("Sem init failed.\n");
+			return -1;
+		}
+	}
+
+	// Print each line as it is written, so forwarding tables read through a pipe show up at once
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	// Seed the random number generator used to spread out the hellos
+	srand(time(NULL) ^ getpid());
+
+	// Read discovery text file to find adjacent neighbor nodes
+	if (processTextFile(filename, neighbors) < 0)
+		return -1;
+
+	// Each neighbor's bucket holds its share of a receive buffer the size of ours, which the
+	// neighbor's own neighbors all send into
+	if ((capacity = getReceiveCapacity(fds[0])) < 0)
+		return -1;
+	setPacing(pace, (double) capacity / (neighbors->size ? neighbors->size : 1));
+	setBatching(batch);
+
+	// Each neighbor is served by the shard its datagrams are steered to, and one on the
+	// same host is sent to through the ring it reads if rings are shared
+	localPort = port;
+	for (neighbor = neighbors->head; neighbor; neighbor = neighbor->next)
+	{
+		neighbor->shard = getShard(neighbor->label, count);
+		neighbor->local = sharedRings && isLocalAddress(neighbor->address);
+	}
+
+	// Join the group of each segment shared with a neighbor, on loopback for a neighbor on
+	// this host. The neighbors of a segment left unjoined are flooded to one by one.
+	for (neighbor = neighbors->head; neighbor && multicastFlooding; neighbor = neighbor->next)
+	{
+		if (neighbor->segment && neighbor->segment->fd < 0 && joinSegment(neighbor->segment, isLocalAddress(neighbor->address)) < 0)
+			return -1;
+	}
+
+	// Leave room in the received queues for one event of each kind per neighbor
+	for (i = 0; i < count; i++)
+	{
+		if (!(shards[i].recvQueue = newFifoQueue(LS_RECV_CAPACITY, 5 * neighbors->size))) {
+			printf("Malloc failed.\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int startNetworkThreads()
+{
+	int i, err;
+	pthread_t network_thread;
+	// Start a network thread for each shard
+	for (i = 0; i < shardCount; i++)
+	{
+		if ((err = pthread_create(&network_thread, NULL, &networkThread, &shards[i]))) {
+			fprintf(stderr, "Can't create Network Thread: [%s]\n", strerror(err));
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void removeRings(int sig)
+{
+	int i, j;
+
+	for (i = 0; i < shardCount; i++)
+		for (j = 0; j < shards[i].ringCount; j++)
+			shm_unlink(shards[i].rings[j]->name);
+
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+int startCommandThread()
+{
+	int err;
+	pthread_t command_thread;
 
-	// Start dynamic thread
-	if ((err = pthread_create(&dynamic_thread, NULL, &dynamicThread, label))) {
-		fprintf(stderr, "Can't create Dynamic Thread: [%s]\n", strerror(err));
+	if ((err = pthread_create(&command_thread, NULL, &commandThread, NULL))) {
+		fprintf(stderr, "Can't create Command Thread: [%s]\n", strerror(err));
 		return -1;
 	}
 
@@ -0,0 +1,318 @@
+/**
+ * This file implements a replay of the datagrams a router recorded in a capture log
+ * through the path a router takes to process them, without sockets or threads, to
+ * measure how many link-state packets and shortest path calculations it can handle.
+ *
+ * The log is read into memory before the replay starts. Each pass replays it into an
+ * empty graph of the recorded router's size: the link-state packets of every update
+ * datagram are applied to the graph, and after every batch of datagrams the unreachable
+ * routers are removed and the shortest paths recalculated if the graph changed, as a
+ * router does once its received queue is empty. Other datagrams only count towards the
+ * datagrams replayed.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <time.h>
+
+#include "lsCapture.h"
+#include "lsDijkstra.h"
+#include "lsGraph.h"
+#include "lsPacket.h"
+
+// Default number of passes over the log
+#define REPLAY_PASSES 5
+// Default number of datagrams applied between shortest path calculations
+#define REPLAY_BATCH 1
+
+struct ReplayResult
+{
+	long long accepted;
+	long long spfRuns;
+	// Nanoseconds spent applying packets and calculating shortest paths
+	long long ingestTime;
+	long long spfTime;
+};
+
+/**
+ * Reads every datagram of a capture log into memory.
+ *
+ * @param filename - path of log
+ *
+ * @return - 0 if success, -1 if error
+ */
+int loadCapture(const char *filename);
+/**
+ * Replays the datagrams into an empty graph.
+ *
+ * @param batch  - number of datagrams applied between shortest path calculations
+ * @param result - where the results will be stored
+ *
+ * @return - 0 if success, -1 if error
+ */
+int replay(int batch, struct ReplayResult *result);
+/**
+ * Gets the current time of a monotonic clock.
+ *
+ * @return - time in nanoseconds
+ */
+long long nanoTime();
+/**
+ * Parses the command line arguments and stores the results in the parameters.
+ *
+ * @param argc     - number of arguments
+ * @param argv     - argument vector
+ * @param filename - path of capture log
+ * @param passes   - number of passes over the log
+ * @param batch    - number of datagrams applied between shortest path calculations
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, char **filename, int *passes, int *batch);
+
+// Recorded router and the size of its graph
+uint16_t router;
+int graphSize;
+// Recorded datagrams, back to back, and where each starts
+char *datagrams;
+int *offsets;
+int datagramCount;
+// Number of update datagrams and the link-state packets they carry
+int updateCount;
+long long packetCount;
+// Microseconds from the first recorded datagram to the last
+long long duration;
+// Results of the last shortest path calculation
+int *spfCost;
+int *spfHop;
+
+int main(int argc, char **argv)
+{
+	int i, passes, batch, best;
+	char *filename, label[LS_ID_LENGTH];
+	double seconds;
+	struct ReplayResult *results;
+
+	if (parseCommandLine(argc, argv, &filename, &passes, &batch) < 0)
+		exit(EXIT_FAILURE);
+
+	if (loadCapture(filename) < 0)
+		exit(EXIT_FAILURE);
+
+	spfCost = (int *) malloc(graphSize * sizeof(int));
+	spfHop = (int *) malloc(graphSize * sizeof(int));
+	results = (struct ReplayResult *) malloc(passes * sizeof(struct ReplayResult));
+
+	if (!spfCost || !spfHop || !results)
+	{
+		printf("Malloc failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	printf("Capture of router %s: %d datagrams, %d updates carrying %lld link-state packets, over %.3f s\n\n",
+	       formatRouterID(router, label), datagramCount, updateCount, packetCount, duration / 1000000.0);
+	printf("%-5s %10s %10s %12s %10s %10s %10s\n", "pass", "accepted", "SPF runs", "packets/s", "SPF/s", "ingest ms", "SPF ms");
+
+	best = 0;
+	for (i = 0; i < passes; i++)
+	{
+		if (replay(batch, &results[i]) < 0)
+		{
+			printf("Malloc failed.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		seconds = (results[i].ingestTime + results[i].spfTime) / 1e9;
+		printf("%-5d %10lld %10lld %12.0f %10.0f %10.3f %10.3f\n", i + 1, results[i].accepted, results[i].spfRuns,
+		       packetCount / seconds, results[i].spfRuns / seconds, results[i].ingestTime / 1e6, results[i].spfTime / 1e6);
+
+		if (results[i].ingestTime + results[i].spfTime < results[best].ingestTime + results[best].spfTime)
+			best = i;
+	}
+
+	// Ingest and calculations are rated on their own time in the best pass
+	printf("\nBest pass: %.0f packets/s applied, %.0f SPF/s, %.1f times faster than recorded\n",
+	       packetCount / (results[best].ingestTime / 1e9),
+	       results[best].spfRuns ? results[best].spfRuns / (results[best].spfTime / 1e9) : 0,
+	       duration * 1000.0 / (results[best].ingestTime + results[best].spfTime));
+
+	exit(EXIT_SUCCESS);
+}
+
+int loadCapture(const char *filename)
+{
+	int length, size, used, offsetSize;
+	long long time;
+	char datagram[LS_DATAGRAM_SIZE];
+	struct Capture *capture;
+
+	if (!(capture = openCapture(filename)))
+		return -1;
+
+	router = capture->router;
+	graphSize = capture->graphSize;
+
+	size = used = offsetSize = 0;
+	time = 0;
+
+	while ((length = readCaptured(capture, datagram, &time)) > 0)
+	{
+		if (used + length > size)
+		{
+			size = size ? 2 * size : 1 << 20;
+			if (!(datagrams = (char *) realloc(datagrams, size)))
+				break;
+		}
+
+		if (datagramCount == offsetSize)
+		{
+			offsetSize = offsetSize ? 2 * offsetSize : 4096;
+			if (!(offsets = (int *) realloc(offsets, (offsetSize + 1) * sizeof(int))))
+				break;
+		}
+
+		memcpy(datagrams + used, datagram, length);
+		offsets[datagramCount++] = used;
+		used += length;
+
+		if (isValidDatagram(datagram, length) && getType(datagram) == LS_TYPE_UPDATE)
+		{
+			updateCount++;
+			packetCount += getCount(datagram);
+		}
+	}
+
+	closeCapture(capture);
+	duration = time;
+
+	if (length < 0)
+	{
+		fprintf(stderr, "%s is corrupt after %d datagrams\n", filename, datagramCount);
+		return -1;
+	}
+
+	if ((used && !datagrams) || (datagramCount && !offsets))
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	if (!datagramCount)
+	{
+		fprintf(stderr, "%s holds no datagrams\n", filename);
+		return -1;
+	}
+
+	// The end of the last datagram
+	offsets[datagramCount] = used;
+
+	return 0;
+}
+
+int replay(int batch, struct ReplayResult *result)
+{
+	int i, j, count, length;
+	long long start;
+	char *datagram, *packet;
+	struct Graph *graph;
+
+	if (!(graph = newGraph(graphSize, 0)))
+		return -1;
+
+	memset(result, 0, sizeof(struct ReplayResult));
+
+	for (i = 0; i < datagramCount; i++)
+	{
+		datagram = datagrams + offsets[i];
+		length = offsets[i + 1] - offsets[i];
+
+		start = nanoTime();
+
+		if (isValidDatagram(datagram, length) && getType(datagram) == LS_TYPE_UPDATE)
+		{
+			count = getCount(datagram);
+			for (j = 0; j < count; j++)
+			{
+				packet = datagram + LS_HEADER_SIZE + j * LS_PACKET_SIZE;
+
+				// A packet at the maximum age is being flushed and is not installed again
+				if (getAge(packet) < LS_MAX_AGE && addEdgeFromPacket(graph, packet) > 0)
+					result->accepted++;
+			}
+		}
+
+		result->ingestTime += nanoTime() - start;
+
+		if (((i + 1) % batch && i + 1 < datagramCount) || !graph->updated)
+			continue;
+
+		start = nanoTime();
+		removeUnreachable(graph, router);
+		if (shortestPaths(graph, router, spfCost, spfHop) < 0)
+		{
+			freeGraph(graph);
+			return -1;
+		}
+		result->spfTime += nanoTime() - start;
+		result->spfRuns++;
+	}
+
+	freeGraph(graph);
+
+	return 0;
+}
+
+long long nanoTime()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int parseCommandLine(int argc, char **argv, char **filename, int *passes, int *batch)
+{
+	int i;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Not enough arguments. Use format:\n"
+		                "captureFile [-passes n] [-batch datagrams]\n");
+		return -1;
+	}
+
+	*filename = argv[1];
+	*passes = REPLAY_PASSES;
+	*batch = REPLAY_BATCH;
+
+	for (i = 2; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "Missing value of %s\n", argv[i]);
+			return -1;
+		}
+
+		if (!strcmp(argv[i], "-passes"))
+			*passes = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-batch"))
+			*batch = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (*passes < 1 || *batch < 1)
+	{
+		fprintf(stderr, "At least one pass and one datagram per batch are needed\n");
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,807 @@
+/**
+ * This file implements a simulator that runs a whole network of routers in one process
+ * to measure how quickly their databases and shortest paths converge.
+ *
+ * Every simulated router has its own graph, received queue and shortest path calculation
+ * as a router node does. The routers are connected by an in-memory transport delivering
+ * each datagram after the delay of its link, and time is kept by a virtual clock that is
+ * advanced one tick at a time, so a topology and seed always give the same results.
+ *
+ * A router processes its received queue on the tick after a datagram arrives, floods
+ * every newer packet to its other neighbors, packets flooded together sharing datagrams,
+ * and recalculates its shortest paths the SPF delay after its graph changed. Packets its
+ * received queue refuses are delivered again after the initial retransmission timeout,
+ * as unacknowledged packets would be retransmitted. Hellos, acknowledgements and database
+ * exchanges are not simulated, every router starts with an empty database at time 0.
+ *
+ * The topology is read from a directory holding the neighbor file of every router,
+ * named after its label (A.txt, 17.txt, ...) and in the format read by a router node.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <dirent.h>
+
+#include "lsDijkstra.h"
+#include "lsFlood.h"
+#include "lsGraph.h"
+#include "lsNetwork.h"
+#include "lsPacket.h"
+#include "lsTimer.h"
+
+// Microseconds of virtual time in a tick of the simulation
+#define LS_SIM_TICK 10
+// Default one-way delay of a link in microseconds
+#define LS_SIM_DELAY 1000
+// Default microseconds from a change to a router's graph to its shortest path calculation
+#define LS_SIM_SPF_DELAY 0
+// Entries in the received queue of each simulated router
+#define LS_SIM_QUEUE_CAPACITY 1024
+
+// Nothing is changed after the network has converged
+#define SIM_EVENT_NONE 0
+// The cost of a random link is changed after the network has converged
+#define SIM_EVENT_CHANGE 1
+// A random link fails after the network has converged
+#define SIM_EVENT_FAIL 2
+
+struct SimLink
+{
+	// Index of the router at the other end
+	int router;
+	int cost;
+	int up;
+	// Datagram being filled with the packets flooded over the link
+	struct SimMessage *outgoing;
+};
+
+struct SimRouter
+{
+	uint16_t label;
+	struct Graph *graph;
+	struct FifoQueue *queue;
+	struct SimLink *links;
+	int linkCount;
+	struct Timer processTimer;
+	struct Timer spfTimer;
+	// Counted from the start of the current phase
+	long long messages;
+	long long packets;
+	long long spfRuns;
+	// Virtual time of the last shortest path calculation, -1 if none this phase
+	long long lastSpf;
+};
+
+struct SimFile
+{
+	uint16_t label;
+	char name[NAME_MAX + 1];
+};
+
+struct SimMessage
+{
+	struct Timer timer;
+	int from;
+	int to;
+	int length;
+	char datagram[LS_DATAGRAM_SIZE];
+};
+
+/**
+ * Reads the neighbor file of every router in a directory and creates the routers.
+ *
+ * @param directory - directory holding the neighbor files
+ *
+ * @return - 0 if success, -1 if error
+ */
+int loadTopology(const char *directory);
+/**
+ * Compares the labels of two neighbor files, used to sort the routers.
+ *
+ * @param a - pointer to first file
+ * @param b - pointer to second file
+ *
+ * @return - negative, zero or positive as a is less than, equal to or greater than b
+ */
+int compareFiles(const void *a, const void *b);
+/**
+ * Originates a link-state packet for a link of a router by pushing it to the router's
+ * own received queue, as the router node does.
+ *
+ * @param router - originating router
+ * @param dest   - label of the router at the other end of the link
+ * @param cost   - cost of the link, LS_WITHDRAW_COST to withdraw it
+ * @param seqN   - sequence number of the packet
+ */
+void originate(struct SimRouter *router, uint16_t dest, int cost, int32_t seqN);
+/**
+ * Starts the timer processing a router's received queue on the next tick.
+ *
+ * @param router - router with a non-empty received queue
+ */
+void scheduleProcess(struct SimRouter *router);
+/**
+ * Timer callback applying the packets in a router's received queue to its graph and
+ * flooding the newer ones. Starts the shortest path calculation if the graph changed.
+ *
+ * @param arg - router being processed
+ */
+void processTimeout(void *arg);
+/**
+ * Adds a packet to the datagram being filled for a link, sending the datagram once full.
+ *
+ * @param router - sending router
+ * @param link   - link the packet is flooded over
+ * @param packet - link-state packet
+ */
+void floodToLink(struct SimRouter *router, struct SimLink *link, const char *packet);
+/**
+ * Allocates a message for a datagram sent between two routers.
+ *
+ * @param from - index of sending router
+ * @param to   - index of receiving router
+ *
+ * @return - pointer to message with an empty update datagram
+ */
+struct SimMessage *newMessage(int from, int to);
+/**
+ * Hands a message to the transport, which delivers it after a delay.
+ *
+ * @param message - message being sent
+ * @param delay   - microseconds until the message is delivered
+ */
+void sendMessage(struct SimMessage *message, long long delay);
+/**
+ * Timer callback delivering a message to the received queue of its receiver.
+ *
+ * @param arg - message being delivered
+ */
+void deliverTimeout(void *arg);
+/**
+ * Timer callback calculating the shortest paths of a router.
+ *
+ * @param arg - router whose paths are calculated
+ */
+void spfTimeout(void *arg);
+/**
+ * Advances the virtual clock until no message, queue or calculation is pending.
+ */
+void runUntilQuiet();
+/**
+ * Resets the counters of every router at the start of a phase.
+ */
+void resetCounters();
+/**
+ * Changes the cost of a random link or fails it.
+ *
+ * @param event - SIM_EVENT_CHANGE or SIM_EVENT_FAIL
+ */
+void changeRandomLink(int event);
+/**
+ * Finds the link of a router to another router.
+ *
+ * @param router - router whose links are searched
+ * @param other  - index of router at the other end
+ *
+ * @return - pointer to link, NULL if the routers are not neighbors
+ */
+struct SimLink *findLink(struct SimRouter *router, int other);
+/**
+ * Gets the sequence number of the last packet a router originated for a link.
+ *
+ * @param router - originating router
+ * @param dest   - label of router at the other end of the link
+ *
+ * @return - sequence number, LS_SEQUENCE_NONE if the router has no record of the link
+ */
+int32_t ownSequence(struct SimRouter *router, uint16_t dest);
+/**
+ * Counts the routers whose database holds every router's latest packets.
+ *
+ * @return - number of synchronized routers
+ */
+int countSynchronized();
+/**
+ * Prints the results of a phase of the simulation.
+ *
+ * @param phase     - name of the phase
+ * @param start     - virtual time the phase started
+ * @param perRouter - 1 if the counters of every router are printed as well
+ */
+void printReport(const char *phase, long long start, int perRouter);
+/**
+ * Parses the command line arguments and stores the results in the parameters.
+ *
+ * @param argc      - number of arguments
+ * @param argv      - argument vector
+ * @param directory - directory holding the neighbor files
+ * @param seed      - seed of the random number generator
+ * @param event     - change made after the network converges (SIM_EVENT_*)
+ * @param perRouter - flag indicating whether the routers' counters are printed
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, char **directory, unsigned int *seed, int *event, int *perRouter);
+
+// Simulated routers, sorted by label
+struct SimRouter *routers;
+int routerCount;
+// Number of links between two routers
+int linkCount;
+// Index of the router with each label, -1 if there is none
+int routerIndex[LS_MAX_ROUTER_ID + 1];
+// Timer wheel driven by the virtual clock
+struct TimerWheel *wheel;
+// Virtual time in microseconds
+long long now;
+// Number of messages in transit and timers started for processing or calculations
+long long pending;
+// One-way delay of each link and the most added to it at random, in microseconds
+long long delay;
+long long jitter;
+// Microseconds from a change to a router's graph to its shortest path calculation
+long long spfDelay;
+// Results of the last shortest path calculation
+int *spfCost;
+int *spfHop;
+
+int main(int argc, char **argv)
+{
+	int event, perRouter;
+	unsigned int seed;
+	char *directory;
+	struct SimRouter *router;
+	struct SimLink *link;
+	long long start;
+
+	if (parseCommandLine(argc, argv, &directory, &seed, &event, &perRouter) < 0)
+		exit(EXIT_FAILURE);
+
+	srand(seed);
+
+	if (loadTopology(directory) < 0)
+		exit(EXIT_FAILURE);
+
+	printf("Routers: %d\nLinks:   %d\n\n", routerCount, linkCount);
+
+	// Every router starts at time 0 by originating its links
+	resetCounters();
+	for (router = routers; router < routers + routerCount; router++)
+		for (link = router->links; link < router->links + router->linkCount; link++)
+			originate(router, routers[link->router].label, link->cost, LS_INITIAL_SEQUENCE);
+
+	runUntilQuiet();
+	printReport("Startup", 0, perRouter);
+
+	if (event == SIM_EVENT_NONE)
+		exit(EXIT_SUCCESS);
+
+	resetCounters();
+	start = now;
+	changeRandomLink(event);
+
+	runUntilQuiet();
+	printReport(event == SIM_EVENT_FAIL ? "Link failure" : "Cost change", start, perRouter);
+
+	exit(EXIT_SUCCESS);
+}
+
+int loadTopology(const char *directory)
+{
+	int i, count, size;
+	uint16_t label;
+	char name[NAME_MAX + 1], path[PATH_MAX];
+	struct SimFile *files;
+	DIR *dir;
+	struct dirent *entry;
+	struct NeighborList *neighbors;
+	struct Neighbor *neighbor, *next;
+	struct SimRouter *router;
+
+	if (!(dir = opendir(directory)))
+	{
+		perror("Error");
+		return -1;
+	}
+
+	// Collect the label of every neighbor file
+	count = size = 0;
+	files = NULL;
+	while ((entry = readdir(dir)))
+	{
+		strcpy(name, entry->d_name);
+		i = strlen(name) - 4;
+		if (i < 1 || strcmp(name + i, ".txt"))
+			continue;
+
+		name[i] = '\0';
+		if (!(label = parseRouterID(name)))
+			continue;
+
+		if (count == size)
+		{
+			size = size ? 2 * size : 64;
+			if (!(files = (struct SimFile *) realloc(files, size * sizeof(struct SimFile))))
+			{
+				printf("Malloc failed.\n");
+				return -1;
+			}
+		}
+		files[count].label = label;
+		strcpy(files[count++].name, entry->d_name);
+	}
+	closedir(dir);
+
+	if (!count)
+	{
+		fprintf(stderr, "No neighbor files in %s\n", directory);
+		return -1;
+	}
+
+	// Readdir order depends on the file system, sorting keeps the simulation repeatable
+	qsort(files, count, sizeof(struct SimFile), compareFiles);
+
+	for (i = 1; i < count; i++)
+	{
+		if (files[i].label == files[i - 1].label)
+		{
+			fprintf(stderr, "%s and %s are files of the same router\n", files[i - 1].name, files[i].name);
+			return -1;
+		}
+	}
+
+	routers = (struct SimRouter *) calloc(count, sizeof(struct SimRouter));
+	spfCost = (int *) malloc(count * sizeof(int));
+	spfHop = (int *) malloc(count * sizeof(int));
+	wheel = newTimerWheel(LS_SIM_TICK, 0);
+
+	if (!routers || !spfCost || !spfHop || !wheel)
+	{
+		printf("Malloc failed.\n");
+		return -1;
+	}
+
+	for (i = 0; i <= LS_MAX_ROUTER_ID; i++)
+		routerIndex[i] = -1;
+
+	routerCount = count;
+	for (i = 0; i < count; i++)
+		routerIndex[files[i].label] = i;
+
+	linkCount = 0;
+	for (i = 0; i < count; i++)
+	{
+		router = &routers[i];
+		router->label = files[i].label;
+		router->graph = newGraph(count, 0);
+		router->queue = newFifoQueue(LS_SIM_QUEUE_CAPACITY, 0);
+		initTimer(&router->processTimer, processTimeout, router);
+		initTimer(&router->spfTimer, spfTimeout, router);
+
+		if (!router->graph || !router->queue || !(neighbors = newNeighborList()))
+		{
+			printf("Malloc failed.\n");
+			return -1;
+		}
+
+		snprintf(path, PATH_MAX, "%s/%s", directory, files[i].name);
+		if (processTextFile(path, neighbors) < 0)
+			return -1;
+
+		if (!(router->links = (struct SimLink *) calloc(neighbors->size, sizeof(struct SimLink))) && neighbors->size)
+		{
+			printf("Malloc failed.\n");
+			return -1;
+		}
+
+		// Only the address of a neighbor is left out, the transport finds routers by label
+		for (neighbor = neighbors->head; neighbor; neighbor = next)
+		{
+			next = neighbor->next;
+
+			if (routerIndex[neighbor->label] < 0 || routerIndex[neighbor->label] == i)
+				fprintf(stderr, "Ignoring link from %s to a router without a neighbor file\n", path);
+			else
+			{
+				router->links[router->linkCount].router = routerIndex[neighbor->label];
+				router->links[router->linkCount].cost = neighbor->cost;
+				router->links[router->linkCount].up = 1;
+				router->linkCount++;
+				// Each link is listed in the files of both of its routers
+				if (routerIndex[neighbor->label] > i)
+					linkCount++;
+			}
+
+			free(neighbor);
+		}
+		free(neighbors);
+	}
+
+	free(files);
+
+	return 0;
+}
+
+int compareFiles(const void *a, const void *b)
+{
+	return ((const struct SimFile *) a)->label - ((const struct SimFile *) b)->label;
+}
+
+void originate(struct SimRouter *router, uint16_t dest, int cost, int32_t seqN)
+{
+	char packet[LS_PACKET_SIZE];
+
+	buildLSPacket(packet, seqN, router->label, dest, cost);
+	push(router->queue, QUEUE_UPDATE, router->label, packet, PRIORITY_BULK);
+	scheduleProcess(router);
+}
+
+void scheduleProcess(struct SimRouter *router)
+{
+	if (isTimerPending(&router->processTimer))
+		return;
+
+	addTimer(wheel, &router->processTimer, 0);
+	pending++;
+}
+
+void processTimeout(void *arg)
+{
+	uint16_t peer;
+	char packet[LS_PACKET_SIZE];
+	struct SimRouter *router = (struct SimRouter *) arg;
+	struct SimLink *link;
+
+	pending--;
+
+	while (!isEmptyQueue(router->queue))
+	{
+		pop(router->queue, packet, &peer);
+
+		if (addEdgeFromPacket(router->graph, packet) <= 0)
+			continue;
+
+		// Flood the newer packet to every neighbor except the one it came from
+		setAge(packet, getAge(packet) + LS_TRANSIT_AGE);
+		for (link = router->links; link < router->links + router->linkCount; link++)
+		{
+			if (link->up && routers[link->router].label != peer)
+				floodToLink(router, link, packet);
+		}
+	}
+
+	// Everything flooded while processing the queue is sent together
+	for (link = router->links; link < router->links + router->linkCount; link++)
+	{
+		if (link->outgoing)
+		{
+			sendMessage(link->outgoing, delay + (jitter ? rand() % (jitter + 1) : 0));
+			link->outgoing = NULL;
+		}
+	}
+
+	if (router->graph->updated && !isTimerPending(&router->spfTimer))
+	{
+		addTimer(wheel, &router->spfTimer, spfDelay);
+		pending++;
+	}
+}
+
+void floodToLink(struct SimRouter *router, struct SimLink *link, const char *packet)
+{
+	struct SimMessage *message;
+
+	if (!link->outgoing && !(link->outgoing = newMessage(router - routers, link->router)))
+		return;
+
+	message = link->outgoing;
+	memcpy(message->datagram + message->length, packet, LS_PACKET_SIZE);
+	message->length += LS_PACKET_SIZE;
+	buildHeader(message->datagram, LS_TYPE_UPDATE, router->label, (message->length - LS_HEADER_SIZE) / LS_PACKET_SIZE);
+
+	if (getCount(message->datagram) == LS_MAX_PACKETS)
+	{
+		sendMessage(message, delay + (jitter ? rand() % (jitter + 1) : 0));
+		link->outgoing = NULL;
+	}
+}
+
+struct SimMessage *newMessage(int from, int to)
+{
+	struct SimMessage *message = (struct SimMessage *) malloc(sizeof(struct SimMessage));
+
+	if (!message)
+		return NULL;
+
+	initTimer(&message->timer, deliverTimeout, message);
+	message->from = from;
+	message->to = to;
+	message->length = LS_HEADER_SIZE;
+	buildHeader(message->datagram, LS_TYPE_UPDATE, routers[from].label, 0);
+
+	return message;
+}
+
+void sendMessage(struct SimMessage *message, long long delay)
+{
+	routers[message->from].messages++;
+	routers[message->from].packets += getCount(message->datagram);
+
+	addTimer(wheel, &message->timer, delay);
+	pending++;
+}
+
+void deliverTimeout(void *arg)
+{
+	int i, count;
+	char *packet;
+	struct SimMessage *message = (struct SimMessage *) arg;
+	struct SimMessage *retry = NULL;
+	struct SimRouter *router = &routers[message->to];
+
+	pending--;
+
+	count = getCount(message->datagram);
+	for (i = 0; i < count; i++)
+	{
+		packet = message->datagram + LS_HEADER_SIZE + i * LS_PACKET_SIZE;
+
+		if (push(router->queue, QUEUE_UPDATE, getSenderID(message->datagram), packet, PRIORITY_BULK) >= 0)
+			continue;
+
+		// A refused packet is not acknowledged, so the sender retransmits it
+		if (!retry && !(retry = newMessage(message->from, message->to)))
+			continue;
+
+		memcpy(retry->datagram + retry->length, packet, LS_PACKET_SIZE);
+		retry->length += LS_PACKET_SIZE;
+		buildHeader(retry->datagram, LS_TYPE_UPDATE, getSenderID(message->datagram), (retry->length - LS_HEADER_SIZE) / LS_PACKET_SIZE);
+	}
+
+	if (retry)
+		sendMessage(retry, LS_INITIAL_RTO);
+
+	if (!isEmptyQueue(router->queue))
+		scheduleProcess(router);
+
+	free(message);
+}
+
+void spfTimeout(void *arg)
+{
+	struct SimRouter *router = (struct SimRouter *) arg;
+
+	pending--;
+
+	removeUnreachable(router->graph, router->label);
+	shortestPaths(router->graph, router->label, spfCost, spfHop);
+
+	router->spfRuns++;
+	router->lastSpf = now;
+}
+
+void runUntilQuiet()
+{
+	while (pending > 0)
+	{
+		now += LS_SIM_TICK;
+		advanceWheel(wheel, now);
+	}
+}
+
+void resetCounters()
+{
+	int i;
+
+	for (i = 0; i < routerCount; i++)
+	{
+		routers[i].messages = 0;
+		routers[i].packets = 0;
+		routers[i].spfRuns = 0;
+		routers[i].lastSpf = -1;
+	}
+}
+
+void changeRandomLink(int event)
+{
+	int cost;
+	char label[LS_ID_LENGTH], otherLabel[LS_ID_LENGTH];
+	struct SimRouter *router, *other;
+	struct SimLink *link, *reverse;
+
+	if (!linkCount)
+		return;
+
+	// Pick a random link that is listed by both of its routers
+	do
+	{
+		router = &routers[rand() % routerCount];
+		link = router->linkCount ? &router->links[rand() % router->linkCount] : NULL;
+	} while (!link || !(reverse = findLink(&routers[link->router], router - routers)));
+
+	other = &routers[link->router];
+	snprintf(label, sizeof(label), "%u", router->label);
+	snprintf(otherLabel, sizeof(otherLabel), "%u", other->label);
+
+	if (event == SIM_EVENT_FAIL)
+	{
+		printf("Failing link between %s and %s\n\n", label, otherLabel);
+
+		// Both routers notice the failure and withdraw their side of the link
+		link->up = reverse->up = 0;
+		originate(router, other->label, LS_WITHDRAW_COST, nextSequence(ownSequence(router, other->label)));
+		originate(other, router->label, LS_WITHDRAW_COST, nextSequence(ownSequence(other, router->label)));
+		return;
+	}
+
+	// Add a random number between -4 and +4 to get the new cost, as the churn engine's walk pattern does
+	cost = link->cost + (rand() % 9) - 4;
+	cost = cost < 1 ? 1 : cost;
+	printf("Changing cost of link between %s and %s from %d to %d\n\n", label, otherLabel, link->cost, cost);
+
+	// Both routers are configured with the new cost and advertise it
+	link->cost = reverse->cost = cost;
+	originate(router, other->label, cost, nextSequence(ownSequence(router, other->label)));
+	originate(other, router->label, cost, nextSequence(ownSequence(other, router->label)));
+}
+
+struct SimLink *findLink(struct SimRouter *router, int other)
+{
+	struct SimLink *link;
+
+	for (link = router->links; link < router->links + router->linkCount; link++)
+		if (link->router == other)
+			return link;
+
+	return NULL;
+}
+
+int32_t ownSequence(struct SimRouter *router, uint16_t dest)
+{
+	int srcI = findIndex(router->graph, router->label);
+	int destI = findIndex(router->graph, dest);
+	struct AdjListNode *edge;
+
+	if (srcI < 0 || destI < 0 || !(edge = findEdge(router->graph, srcI, destI)))
+		return LS_SEQUENCE_NONE;
+
+	return edge->seqN;
+}
+
+int countSynchronized()
+{
+	int i, j, synchronized, srcI, destI;
+	struct SimRouter *router, *origin;
+	struct SimLink *link;
+	struct AdjListNode *edge;
+
+	synchronized = 0;
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		// Every router's database must hold the packet each router last originated for its links
+		for (i = 0; i < routerCount; i++)
+		{
+			origin = &routers[i];
+			srcI = findIndex(router->graph, origin->label);
+
+			for (j = 0; j < origin->linkCount; j++)
+			{
+				link = &origin->links[j];
+				destI = findIndex(router->graph, routers[link->router].label);
+
+				if (srcI < 0 || destI < 0 || !(edge = findEdge(router->graph, srcI, destI)) ||
+				    edge->seqN != ownSequence(origin, routers[link->router].label))
+					break;
+			}
+
+			if (j < origin->linkCount)
+				break;
+		}
+
+		if (i == routerCount)
+			synchronized++;
+	}
+
+	return synchronized;
+}
+
+void printReport(const char *phase, long long start, int perRouter)
+{
+	long long converged, messages, packets, spfRuns, maxMessages, maxSpfRuns;
+	struct SimRouter *router;
+
+	converged = start;
+	messages = packets = spfRuns = maxMessages = maxSpfRuns = 0;
+
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		if (router->lastSpf > converged)
+			converged = router->lastSpf;
+
+		messages += router->messages;
+		packets += router->packets;
+		spfRuns += router->spfRuns;
+
+		if (router->messages > maxMessages)
+			maxMessages = router->messages;
+		if (router->spfRuns > maxSpfRuns)
+			maxSpfRuns = router->spfRuns;
+	}
+
+	printf("%s\n"
+	       "Time to convergence: %.3f ms\n"
+	       "Messages sent:       %lld (%.1f per router, at most %lld)\n"
+	       "Packets sent:        %lld\n"
+	       "SPF runs:            %lld (%.1f per router, at most %lld)\n"
+	       "Synchronized:        %d of %d routers\n\n",
+	       phase, (converged - start) / 1000.0,
+	       messages, (double) messages / routerCount, maxMessages,
+	       packets,
+	       spfRuns, (double) spfRuns / routerCount, maxSpfRuns,
+	       countSynchronized(), routerCount);
+
+	if (!perRouter)
+		return;
+
+	printf("Router | Messages | Packets  | SPF runs | Last SPF (ms)\n");
+	for (router = routers; router < routers + routerCount; router++)
+	{
+		printf("%-6u | %-8lld | %-8lld | %-8lld | ", router->label,
+		       router->messages, router->packets, router->spfRuns);
+
+		if (router->lastSpf < 0)
+			printf("-\n");
+		else
+			printf("%.3f\n", (router->lastSpf - start) / 1000.0);
+	}
+
+	printf("\n");
+}
+
+int parseCommandLine(int argc, char **argv, char **directory, unsigned int *seed, int *event, int *perRouter)
+{
+	int i;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Not enough arguments. Use format:\n"
+		                "topologyDirectory [-delay usec] [-jitter usec] [-spf-delay usec] [-seed n] [-change | -fail] [-routers]\n");
+		return -1;
+	}
+
+	*directory = argv[1];
+	*seed = 1;
+	*event = SIM_EVENT_NONE;
+	*perRouter = 0;
+	delay = LS_SIM_DELAY;
+	jitter = 0;
+	spfDelay = LS_SIM_SPF_DELAY;
+
+	for (i = 2; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-change"))
+			*event = SIM_EVENT_CHANGE;
+		else if (!strcmp(argv[i], "-fail"))
+			*event = SIM_EVENT_FAIL;
+		else if (!strcmp(argv[i], "-routers"))
+			*perRouter = 1;
+		else if (i + 1 < argc && !strcmp(argv[i], "-delay"))
+			delay = atoll(argv[++i]);
+		else if (i + 1 < argc && !strcmp(argv[i], "-jitter"))
+			jitter = atoll(argv[++i]);
+		else if (i + 1 < argc && !strcmp(argv[i], "-spf-delay"))
+			spfDelay = atoll(argv[++i]);
+		else if (i + 1 < argc && !strcmp(argv[i], "-seed"))
+			*seed = strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,342 @@
+/**
+ * This file implements a converter writing the binary topology file a router maps in
+ * SPF-only mode, from either a text edge list or the neighbor files of a network.
+ *
+ * Edge list - one edge per line as source, destination and cost, separated by spaces,
+ *             tabs or commas. Blank lines and lines starting with # are skipped. With
+ *             -undirected each line also adds the edge back from the destination.
+ * Neighbors - the neighbor file of a router, in the label,host,port,cost format read by
+ *             a router node. The files of its neighbors are looked for in the same
+ *             directory, named after their labels, and crawled until every router
+ *             reached has been read. The cost of an edge is the one in the file of the
+ *             router it leaves.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <libgen.h>
+#include <limits.h>
+
+#include "lsNetwork.h"
+#include "lsPacket.h"
+#include "lsTopology.h"
+
+// Characters separating the fields of an edge list
+#define EDGE_DELIM " \t,\r\n"
+
+/**
+ * Adds an edge to the list being converted.
+ *
+ * @param source - label of router the edge leaves
+ * @param dest   - label of router the edge leads to
+ * @param cost   - cost of edge
+ *
+ * @return - 0 if success, -1 if error
+ */
+int appendEdge(uint16_t source, uint16_t dest, int32_t cost);
+/**
+ * Reads a text edge list.
+ *
+ * @param filename   - path of edge list
+ * @param undirected - 1 if each line also adds the edge back, 0 if not
+ *
+ * @return - 0 if success, -1 if error
+ */
+int readEdgeList(const char *filename, int undirected);
+/**
+ * Reads the neighbor file of a router and the files of every router reachable from it.
+ *
+ * @param filename - path of first neighbor file, named after its router's label
+ *
+ * @return - 0 if success, -1 if error
+ */
+int crawlNeighborFiles(const char *filename);
+/**
+ * Reads the links in the neighbor file of a router.
+ *
+ * @param fp     - open neighbor file
+ * @param router - label of router the file belongs to
+ * @param queue  - routers waiting to be read, the neighbors not yet seen are added to it
+ * @param tail   - number of routers in the queue
+ * @param seen   - flags of routers already queued, indexed by label
+ *
+ * @return - 0 if success, -1 if error
+ */
+int readNeighborFile(FILE *fp, uint16_t router, uint16_t *queue, int *tail, char *seen);
+/**
+ * Parses the command line arguments and stores the results in the parameters.
+ *
+ * @param argc       - number of arguments
+ * @param argv       - argument vector
+ * @param output     - path of topology file written
+ * @param edgeList   - path of edge list, NULL if crawling neighbor files
+ * @param neighbors  - path of first neighbor file, NULL if reading an edge list
+ * @param undirected - flag indicating whether each edge is also added back
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, char **output, char **edgeList, char **neighbors, int *undirected);
+
+// Edges read so far
+uint16_t *sources;
+uint16_t *dests;
+int32_t *costs;
+int edgeCount;
+int edgeSize;
+
+int main(int argc, char **argv)
+{
+	int undirected, result, written;
+	char *output, *edgeList, *neighbors;
+	long long start;
+
+	if (parseCommandLine(argc, argv, &output, &edgeList, &neighbors, &undirected) < 0)
+		exit(EXIT_FAILURE);
+
+	start = currentTime();
+
+	if (edgeList)
+		result = readEdgeList(edgeList, undirected);
+	else
+		result = crawlNeighborFiles(neighbors);
+
+	if (result < 0)
+		exit(EXIT_FAILURE);
+
+	if (!edgeCount)
+	{
+		fprintf(stderr, "No edges were read\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if ((written = writeTopologyFile(output, edgeCount, sources, dests, costs)) < 0)
+		exit(EXIT_FAILURE);
+
+	printf("Wrote %d edges of %d read to %s in %.1f ms\n", written, edgeCount, output, (currentTime() - start) / 1000.0);
+
+	exit(EXIT_SUCCESS);
+}
+
+int appendEdge(uint16_t source, uint16_t dest, int32_t cost)
+{
+	if (edgeCount == edgeSize)
+	{
+		edgeSize = edgeSize ? 2 * edgeSize : 4096;
+
+		if (edgeSize > INT_MAX / 2 ||
+		    !(sources = (uint16_t *) realloc(sources, edgeSize * sizeof(uint16_t))) ||
+		    !(dests = (uint16_t *) realloc(dests, edgeSize * sizeof(uint16_t))) ||
+		    !(costs = (int32_t *) realloc(costs, edgeSize * sizeof(int32_t))))
+		{
+			printf("Malloc failed.\n");
+			return -1;
+		}
+	}
+
+	sources[edgeCount] = source;
+	dests[edgeCount] = dest;
+	costs[edgeCount++] = cost;
+
+	return 0;
+}
+
+int readEdgeList(const char *filename, int undirected)
+{
+	int lineNumber, cost;
+	uint16_t source, dest;
+	char line[256];
+	char *tokens[3];
+	FILE *fp;
+
+	if (!(fp = fopen(filename, "r")))
+	{
+		perror(filename);
+		return -1;
+	}
+
+	lineNumber = 0;
+	while (fgets(line, sizeof(line), fp))
+	{
+		lineNumber++;
+
+		if (!(tokens[0] = strtok(line, EDGE_DELIM)) || tokens[0][0] == '#')
+			continue;
+
+		tokens[1] = strtok(NULL, EDGE_DELIM);
+		tokens[2] = tokens[1] ? strtok(NULL, EDGE_DELIM) : NULL;
+
+		if (!tokens[2] || !(source = parseRouterID(tokens[0])) || !(dest = parseRouterID(tokens[1])) ||
+		    source == dest || (cost = atoi(tokens[2])) <= 0)
+		{
+			fprintf(stderr, "Skipping line %d of %s\n", lineNumber, filename);
+			continue;
+		}
+
+		if (appendEdge(source, dest, cost) < 0 || (undirected && appendEdge(dest, source, cost) < 0))
+		{
+			fclose(fp);
+			return -1;
+		}
+	}
+
+	fclose(fp);
+
+	return 0;
+}
+
+int crawlNeighborFiles(const char *filename)
+{
+	int head, tail, result;
+	uint16_t router, *queue;
+	char *seen, *path, *name, *dot, *directory;
+	char label[LS_ID_LENGTH], file[PATH_MAX];
+	FILE *fp;
+
+	// dirname and basename may modify their argument
+	path = strdup(filename);
+	name = strdup(basename(path));
+	strcpy(path, filename);
+	directory = dirname(path);
+
+	if ((dot = strrchr(name, '.')))
+		*dot = '\0';
+
+	if (!(router = parseRouterID(name)))
+	{
+		fprintf(stderr, "%s is not named after a router label\n", filename);
+		free(path);
+		free(name);
+		return -1;
+	}
+
+	queue = (uint16_t *) malloc((LS_MAX_ROUTER_ID + 1) * sizeof(uint16_t));
+	seen = (char *) calloc(LS_MAX_ROUTER_ID + 1, 1);
+
+	if (!queue || !seen)
+	{
+		printf("Malloc failed.\n");
+		free(path);
+		free(name);
+		return -1;
+	}
+
+	head = tail = 0;
+	queue[tail++] = router;
+	seen[router] = 1;
+	result = 0;
+
+	while (head < tail && result == 0)
+	{
+		router = queue[head++];
+
+		// A router is looked for under the label it is read as, then by its number
+		snprintf(file, PATH_MAX, "%s/%s.txt", directory, formatRouterID(router, label));
+		if (!(fp = fopen(file, "r")))
+		{
+			snprintf(file, PATH_MAX, "%s/%u.txt", directory, router);
+			fp = fopen(file, "r");
+		}
+
+		if (!fp)
+		{
+			fprintf(stderr, "No neighbor file for router %s, only the edges to it are known\n", label);
+			continue;
+		}
+
+		result = readNeighborFile(fp, router, queue, &tail, seen);
+		fclose(fp);
+	}
+
+	printf("Crawled %d routers from %s\n", tail, filename);
+
+	free(path);
+	free(name);
+	free(queue);
+	free(seen);
+
+	return result;
+}
+
+int readNeighborFile(FILE *fp, uint16_t router, uint16_t *queue, int *tail, char *seen)
+{
+	int i, cost;
+	uint16_t neighbor;
+	char line[128];
+	char *tokens[4];
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		tokens[0] = strtok(line, DELIM);
+		for (i = 1; i < 4; i++)
+			tokens[i] = tokens[i - 1] ? strtok(NULL, DELIM) : NULL;
+
+		if (!tokens[0] || !tokens[3] || !(neighbor = parseRouterID(tokens[0])) || neighbor == router ||
+		    (cost = atoi(tokens[3])) <= 0)
+			continue;
+
+		if (appendEdge(router, neighbor, cost) < 0)
+			return -1;
+
+		if (!seen[neighbor])
+		{
+			seen[neighbor] = 1;
+			queue[(*tail)++] = neighbor;
+		}
+	}
+
+	return 0;
+}
+
+int parseCommandLine(int argc, char **argv, char **output, char **edgeList, char **neighbors, int *undirected)
+{
+	int i;
+
+	if (argc < 4)
+	{
+		fprintf(stderr, "Not enough arguments. Use format:\n"
+		                "outputFile -edges edgeListFile [-undirected]\n"
+		                "outputFile -neighbors neighborFile\n");
+		return -1;
+	}
+
+	*output = argv[1];
+	*edgeList = NULL;
+	*neighbors = NULL;
+	*undirected = 0;
+
+	for (i = 2; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-undirected"))
+		{
+			*undirected = 1;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "Missing value of %s\n", argv[i]);
+			return -1;
+		}
+
+		if (!strcmp(argv[i], "-edges"))
+			*edgeList = argv[++i];
+		else if (!strcmp(argv[i], "-neighbors"))
+			*neighbors = argv[++i];
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (!*edgeList == !*neighbors)
+	{
+		fprintf(stderr, "Convert either an edge list or neighbor files\n");
+		return -1;
+	}
+
+	return 0;
+}
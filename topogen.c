@@ -0,0 +1,495 @@
+/**
+ * This file implements a generator of network topologies for benchmarking. It writes the
+ * neighbor file of every router to a directory, named after the router's label, in the
+ * label,host,port,cost format read by a router node. Routers are labelled 1 to n and the
+ * router labelled i listens on the base port plus i. Every link gets a random cost.
+ *
+ * Topologies:
+ * ring    - n routers in a cycle
+ * grid    - n routers in rows of about the square root of n, linked to the routers beside them
+ * fattree - k-ary fat tree of 5k^2/4 switches, where size is the even number of ports k
+ * er      - Erdos-Renyi random graph of n routers with the given average degree, kept
+ *           connected by a random spanning tree the random links are added to
+ * ba      - Barabasi-Albert preferential attachment, each new router linking to degree/2
+ *           existing routers
+ * lan     - n routers on one broadcast segment, each linked to every other, with the
+ *           multicast group given by -group written for every link, sent to on the base port
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lsPacket.h"
+
+// Default first port, the router labelled i listens on this port plus i
+#define TOPO_BASE_PORT 60000
+// Default largest random cost of a link
+#define TOPO_MAX_COST 10
+// Default average number of links of a router in the random topologies
+#define TOPO_DEGREE 4
+// Default multicast group of the segment of a lan
+#define TOPO_GROUP "239.255.0.1"
+
+struct TopoRouter
+{
+	int *links;
+	int *costs;
+	int count;
+	int size;
+};
+
+/**
+ * Links two routers with a random cost unless they are already linked.
+ *
+ * @param a - index of first router
+ * @param b - index of second router
+ *
+ * @return - 1 if linked, 0 if already linked or the same router, -1 if error
+ */
+int addLink(int a, int b);
+/**
+ * Checks if two routers are linked.
+ *
+ * @param a - index of first router
+ * @param b - index of second router
+ *
+ * @return - 1 if linked, 0 if not
+ */
+int isLinked(int a, int b);
+/**
+ * Generates a ring.
+ *
+ * @return - 0 if success, -1 if error
+ */
+int generateRing();
+/**
+ * Generates a grid.
+ *
+ * @return - 0 if success, -1 if error
+ */
+int generateGrid();
+/**
+ * Generates a fat tree. Core switches come first, then the aggregation and edge
+ * switches of each pod.
+ *
+ * @param k - number of ports of every switch
+ *
+ * @return - 0 if success, -1 if error
+ */
+int generateFatTree(int k);
+/**
+ * Generates an Erdos-Renyi random graph around a random spanning tree.
+ *
+ * @param degree - average number of links of a router
+ *
+ * @return - 0 if success, -1 if error
+ */
+int generateErdosRenyi(int degree);
+/**
+ * Generates a Barabasi-Albert preferential attachment graph.
+ *
+ * @param degree - average number of links of a router
+ *
+ * @return - 0 if success, -1 if error
+ */
+int generateBarabasiAlbert(int degree);
+/**
+ * Generates a broadcast segment, every router linked to every other.
+ *
+ * @return - 0 if success, -1 if error
+ */
+int generateLan();
+/**
+ * Writes the neighbor file of every router.
+ *
+ * @param directory - directory the files are written to, created if missing
+ * @param host      - host name written for every router
+ * @param basePort  - port the label of a router is added to for its port
+ *
+ * @return - 0 if success, -1 if error
+ */
+int writeTopology(const char *directory, const char *host, int basePort);
+/**
+ * Parses the command line arguments and stores the results in the parameters.
+ *
+ * @param argc      - number of arguments
+ * @param argv      - argument vector
+ * @param type      - name of the topology
+ * @param size      - number of routers, or ports for a fat tree
+ * @param directory - directory the files are written to
+ * @param host      - host name written for every router
+ * @param basePort  - port the label of a router is added to for its port
+ * @param degree    - average number of links of a router in the random topologies
+ * @param seed      - seed of the random number generator
+ * @param group     - multicast group of the segment of a lan
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, char **type, int *size, char **directory, char **host, int *basePort, int *degree, unsigned int *seed, char **group);
+
+// Routers being generated, the router at index i is labelled i + 1
+struct TopoRouter *routers;
+int routerCount;
+// Number of links generated
+int linkCount;
+// Largest random cost of a link
+int maxCost;
+// Multicast group written for every link, NULL if the links are point to point
+char *segmentGroup;
+
+int main(int argc, char **argv)
+{
+	int size, basePort, degree, result;
+	unsigned int seed;
+	char *type, *directory, *host, *group;
+
+	if (parseCommandLine(argc, argv, &type, &size, &directory, &host, &basePort, &degree, &seed, &group) < 0)
+		exit(EXIT_FAILURE);
+
+	srand(seed);
+
+	routerCount = !strcmp(type, "fattree") ? 5 * size * size / 4 : size;
+
+	if (routerCount < 2 || routerCount > LS_MAX_ROUTER_ID || basePort + routerCount > 65535)
+	{
+		fprintf(stderr, "Cannot label %d routers with ports from %d\n", routerCount, basePort + 1);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!(routers = (struct TopoRouter *) calloc(routerCount, sizeof(struct TopoRouter))))
+	{
+		printf("Malloc failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!strcmp(type, "ring"))
+		result = generateRing();
+	else if (!strcmp(type, "grid"))
+		result = generateGrid();
+	else if (!strcmp(type, "fattree"))
+		result = size % 2 ? -1 : generateFatTree(size);
+	else if (!strcmp(type, "er"))
+		result = generateErdosRenyi(degree);
+	else if (!strcmp(type, "ba"))
+		result = generateBarabasiAlbert(degree);
+	else if (!strcmp(type, "lan"))
+	{
+		segmentGroup = group;
+		result = generateLan();
+	}
+	else
+	{
+		fprintf(stderr, "Unknown topology %s\n", type);
+		exit(EXIT_FAILURE);
+	}
+
+	if (result < 0 || writeTopology(directory, host, basePort) < 0)
+	{
+		fprintf(stderr, "Could not generate %s topology of size %d\n", type, size);
+		exit(EXIT_FAILURE);
+	}
+
+	printf("Wrote %d routers and %d links to %s\n", routerCount, linkCount, directory);
+
+	exit(EXIT_SUCCESS);
+}
+
+int addLink(int a, int b)
+{
+	int i, cost, index[2] = { a, b };
+	struct TopoRouter *router;
+
+	if (a == b || isLinked(a, b))
+		return 0;
+
+	cost = 1 + rand() % maxCost;
+
+	for (i = 0; i < 2; i++)
+	{
+		router = &routers[index[i]];
+
+		if (router->count == router->size)
+		{
+			router->size = router->size ? 2 * router->size : 4;
+			router->links = (int *) realloc(router->links, router->size * sizeof(int));
+			router->costs = (int *) realloc(router->costs, router->size * sizeof(int));
+
+			if (!router->links || !router->costs)
+				return -1;
+		}
+
+		router->links[router->count] = index[1 - i];
+		router->costs[router->count] = cost;
+		router->count++;
+	}
+
+	linkCount++;
+
+	return 1;
+}
+
+int isLinked(int a, int b)
+{
+	int i;
+
+	// Search the router with fewer links, as hubs may have thousands
+	if (routers[b].count < routers[a].count)
+		return isLinked(b, a);
+
+	for (i = 0; i < routers[a].count; i++)
+		if (routers[a].links[i] == b)
+			return 1;
+
+	return 0;
+}
+
+int generateRing()
+{
+	int i;
+
+	for (i = 0; i < routerCount; i++)
+		if (addLink(i, (i + 1) % routerCount) < 0)
+			return -1;
+
+	return 0;
+}
+
+int generateGrid()
+{
+	int i, columns;
+
+	for (columns = 1; columns * columns < routerCount; columns++)
+		;
+
+	for (i = 0; i < routerCount; i++)
+	{
+		if ((i + 1) % columns && i + 1 < routerCount && addLink(i, i + 1) < 0)
+			return -1;
+		if (i + columns < routerCount && addLink(i, i + columns) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+int generateFatTree(int k)
+{
+	int pod, i, j, core, aggregation, edge, half = k / 2;
+
+	// k^2/4 core switches, then k pods of k/2 aggregation and k/2 edge switches each
+	for (pod = 0; pod < k; pod++)
+	{
+		for (i = 0; i < half; i++)
+		{
+			aggregation = half * half + pod * k + i;
+
+			// Aggregation switch i of every pod links to core switches i*k/2 to i*k/2 + k/2 - 1
+			for (j = 0; j < half; j++)
+			{
+				core = i * half + j;
+				if (addLink(aggregation, core) < 0)
+					return -1;
+			}
+
+			for (j = 0; j < half; j++)
+			{
+				edge = half * half + pod * k + half + j;
+				if (addLink(aggregation, edge) < 0)
+					return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int generateErdosRenyi(int degree)
+{
+	int i, j;
+	double p;
+
+	for (i = 1; i < routerCount; i++)
+		if (addLink(i, rand() % i) < 0)
+			return -1;
+
+	// The tree already gives an average degree of nearly 2
+	p = (double) (degree - 2) / (routerCount - 1);
+
+	for (i = 0; i < routerCount; i++)
+		for (j = i + 1; j < routerCount; j++)
+			if ((double) rand() / RAND_MAX < p && addLink(i, j) < 0)
+				return -1;
+
+	return 0;
+}
+
+int generateBarabasiAlbert(int degree)
+{
+	int i, j, m, ends, result;
+	int *endpoints;
+
+	m = degree / 2 > 0 ? degree / 2 : 1;
+	if (m >= routerCount)
+		m = routerCount - 1;
+
+	// Every link adds both of its routers, so a router appears once per link it has
+	if (!(endpoints = (int *) malloc(2 * ((long long) m * routerCount + m * m) * sizeof(int))))
+		return -1;
+
+	ends = 0;
+
+	// Start from a clique of m + 1 routers
+	for (i = 0; i <= m; i++)
+	{
+		for (j = 0; j < i; j++)
+		{
+			if (addLink(i, j) < 0)
+			{
+				free(endpoints);
+				return -1;
+			}
+			endpoints[ends++] = i;
+			endpoints[ends++] = j;
+		}
+	}
+
+	// Each new router links to m routers picked in proportion to their number of links
+	for (i = m + 1; i < routerCount; i++)
+	{
+		j = 0;
+		while (j < m)
+		{
+			if ((result = addLink(i, endpoints[rand() % ends])) < 0)
+			{
+				free(endpoints);
+				return -1;
+			}
+			j += result;
+		}
+
+		for (j = 0; j < m; j++)
+		{
+			endpoints[ends++] = i;
+			endpoints[ends++] = routers[i].links[j];
+		}
+	}
+
+	free(endpoints);
+
+	return 0;
+}
+
+int generateLan()
+{
+	int i, j;
+
+	for (i = 0; i < routerCount; i++)
+		for (j = i + 1; j < routerCount; j++)
+			if (addLink(i, j) < 0)
+				return -1;
+
+	return 0;
+}
+
+int writeTopology(const char *directory, const char *host, int basePort)
+{
+	int i, j;
+	char path[PATH_MAX];
+	FILE *fp;
+
+	if (mkdir(directory, 0755) < 0 && errno != EEXIST)
+	{
+		perror("Error");
+		return -1;
+	}
+
+	for (i = 0; i < routerCount; i++)
+	{
+		snprintf(path, PATH_MAX, "%s/%d.txt", directory, i + 1);
+
+		if (!(fp = fopen(path, "w")))
+		{
+			perror("Error");
+			return -1;
+		}
+
+		for (j = 0; j < routers[i].count; j++)
+		{
+			fprintf(fp, "%d,%s,%d,%d", routers[i].links[j] + 1, host, basePort + routers[i].links[j] + 1, routers[i].costs[j]);
+			// Routers on the segment all send to its group on the base port
+			if (segmentGroup)
+				fprintf(fp, ",%s:%d", segmentGroup, basePort);
+			fprintf(fp, "\n");
+		}
+
+		fclose(fp);
+	}
+
+	return 0;
+}
+
+int parseCommandLine(int argc, char **argv, char **type, int *size, char **directory, char **host, int *basePort, int *degree, unsigned int *seed, char **group)
+{
+	int i;
+
+	if (argc < 4)
+	{
+		fprintf(stderr, "Not enough arguments. Use format:\n"
+		                "ring|grid|fattree|er|ba|lan size directory [-seed n] [-host name] [-port base] [-max-cost n] [-degree n] [-group address]\n");
+		return -1;
+	}
+
+	*type = argv[1];
+	*size = atoi(argv[2]);
+	*directory = argv[3];
+	*host = "127.0.0.1";
+	*basePort = TOPO_BASE_PORT;
+	*degree = TOPO_DEGREE;
+	*seed = 1;
+	*group = TOPO_GROUP;
+	maxCost = TOPO_MAX_COST;
+
+	for (i = 4; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "Missing value of %s\n", argv[i]);
+			return -1;
+		}
+
+		if (!strcmp(argv[i], "-seed"))
+			*seed = strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-host"))
+			*host = argv[++i];
+		else if (!strcmp(argv[i], "-port"))
+			*basePort = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-max-cost"))
+			maxCost = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-degree"))
+			*degree = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-group"))
+			*group = argv[++i];
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (maxCost < 1 || *degree < 2)
+	{
+		fprintf(stderr, "The largest cost must be at least 1 and the degree at least 2\n");
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,508 @@
+/**
+ * This file implements a tool that merges the trace files written by routers built with
+ * tracing into a timeline of each link-state packet, and reports the time packets spent
+ * in each stage of a router and on each hop between routers.
+ *
+ * Only the path of a packet through the routers that accepted it is measured. At each of
+ * them, the stages are:
+ * recv queue - first receipt of the packet to its last removal from the received queue
+ *              before it was applied
+ * apply      - removal from the received queue, or origination, to application to the graph
+ * send queue - application to the graph to removal from the send queue
+ * flood      - removal from the send queue to being put on the retransmission lists
+ * transmit   - being put on the retransmission lists to first being sent to a neighbor
+ * hop        - first being sent to a neighbor to first being received by it
+ * spread     - first event of a packet to the last router applying it
+ *
+ * The routers' counters are converted to microseconds with the rate of the first file,
+ * as routers on one host read the same counter.
+ *
+ * @author Jeffrey Bromen
+ * @date 10/19/26
+ * @info Systems and Networks II
+ * @info Project 3
+ */
+
+#include "lsPacket.h"
+#include "lsTrace.h"
+
+// Stages whose time is reported
+#define DUMP_RECV_QUEUE 0
+#define DUMP_APPLY 1
+#define DUMP_SEND_QUEUE 2
+#define DUMP_FLOOD 3
+#define DUMP_TRANSMIT 4
+#define DUMP_HOP 5
+#define DUMP_SPREAD 6
+#define DUMP_STAGES 7
+
+struct DumpEvent
+{
+	// Microseconds on the monotonic clock of the first file
+	double time;
+	int32_t seqN;
+	uint16_t source;
+	uint16_t dest;
+	uint16_t router;
+	uint16_t peer;
+	int stage;
+};
+
+struct DumpSamples
+{
+	double *values;
+	int count;
+	int size;
+};
+
+/**
+ * Reads the events of a trace file into the merged events.
+ *
+ * @param filename - path of trace file
+ *
+ * @return - 0 if success, -1 if error
+ */
+int loadTraceFile(const char *filename);
+/**
+ * Compares two events by packet, then router, then time, used to sort the merged events.
+ *
+ * @param a - pointer to first event
+ * @param b - pointer to second event
+ *
+ * @return - negative, zero or positive as a is less than, equal to or greater than b
+ */
+int compareEvents(const void *a, const void *b);
+/**
+ * Compares two events by time alone, used to sort the timeline of a packet.
+ *
+ * @param a - pointer to first event
+ * @param b - pointer to second event
+ *
+ * @return - negative, zero or positive as a happened before, with or after b
+ */
+int compareTimes(const void *a, const void *b);
+/**
+ * Checks if two events are for the same link-state packet.
+ *
+ * @param a - first event
+ * @param b - second event
+ *
+ * @return - 1 if same packet, 0 if not
+ */
+int isSamePacket(struct DumpEvent *a, struct DumpEvent *b);
+/**
+ * Measures the stages of a packet at every router that accepted it.
+ *
+ * @param first - first event of the packet
+ * @param count - number of events of the packet
+ *
+ * @return - 0 if success, -1 if error
+ */
+int measurePacket(struct DumpEvent *first, int count);
+/**
+ * Finds when a router first received a packet from a neighbor after a time.
+ *
+ * @param first  - first event of the packet
+ * @param count  - number of events of the packet
+ * @param router - label of receiving router
+ * @param peer   - label of sending neighbor
+ * @param after  - time in microseconds
+ *
+ * @return - time in microseconds, -1 if never
+ */
+double findReceipt(struct DumpEvent *first, int count, uint16_t router, uint16_t peer, double after);
+/**
+ * Prints the events of a packet in the order they happened.
+ *
+ * @param first - first event of the packet
+ * @param count - number of events of the packet
+ */
+void printTimeline(struct DumpEvent *first, int count);
+/**
+ * Adds a sample to a stage.
+ *
+ * @param stage - stage (DUMP_*)
+ * @param value - microseconds spent in stage
+ *
+ * @return - 0 if success, -1 if error
+ */
+int addSample(int stage, double value);
+/**
+ * Compares two doubles, used to sort the samples.
+ *
+ * @param a - pointer to first double
+ * @param b - pointer to second double
+ *
+ * @return - negative, zero or positive as a is less than, equal to or greater than b
+ */
+int compareDoubles(const void *a, const void *b);
+/**
+ * Prints the count, mean and percentiles of the samples of every stage.
+ */
+void printStages();
+/**
+ * Parses the command line arguments and stores the results in the parameters.
+ *
+ * @param argc      - number of arguments
+ * @param argv      - argument vector
+ * @param timelines - set if timelines are printed
+ * @param source    - source of the only link whose timelines are printed, LS_ROUTER_NONE for all
+ * @param dest      - destination of that link
+ * @param first     - index of first trace file argument
+ *
+ * @return - 0 if success, -1 if error
+ */
+int parseCommandLine(int argc, char **argv, int *timelines, uint16_t *source, uint16_t *dest, int *first);
+
+const char *stageNames[TRACE_STAGES] = { "", "originated", "received", "dequeued", "applied", "flood dequeued", "flooded", "sent" };
+const char *sampleNames[DUMP_STAGES] = { "recv queue", "apply", "send queue", "flood", "transmit", "hop", "spread" };
+
+// Events of every file
+struct DumpEvent *events;
+int eventCount;
+int eventSize;
+// Conversion of the counters to microseconds, taken from the first file
+double ticksPerMicrosecond;
+uint64_t referenceTicks;
+int64_t referenceTime;
+// Samples of every stage
+struct DumpSamples samples[DUMP_STAGES];
+
+int main(int argc, char **argv)
+{
+	int i, start, first, timelines, packets;
+	uint16_t source, dest;
+
+	if (parseCommandLine(argc, argv, &timelines, &source, &dest, &first) < 0)
+		exit(EXIT_FAILURE);
+
+	for (i = first; i < argc; i++)
+		if (loadTraceFile(argv[i]) < 0)
+			exit(EXIT_FAILURE);
+
+	qsort(events, eventCount, sizeof(struct DumpEvent), compareEvents);
+
+	packets = 0;
+	for (start = 0; start < eventCount; start = i)
+	{
+		for (i = start + 1; i < eventCount && isSamePacket(&events[start], &events[i]); i++)
+			;
+
+		packets++;
+
+		if (measurePacket(&events[start], i - start) < 0)
+		{
+			printf("Malloc failed.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		if (timelines && (source == LS_ROUTER_NONE || (events[start].source == source && events[start].dest == dest)))
+			printTimeline(&events[start], i - start);
+	}
+
+	printf("Events: %d from %d files, %d link-state packets\n\n", eventCount, argc - first, packets);
+	printStages();
+
+	exit(EXIT_SUCCESS);
+}
+
+int loadTraceFile(const char *filename)
+{
+	uint64_t i, head, oldest;
+	struct TraceRing ring;
+	struct TraceEvent *event;
+	struct DumpEvent *merged;
+
+	if (mapTraceFile(filename, &ring) < 0)
+		return -1;
+
+	if (!ticksPerMicrosecond)
+	{
+		ticksPerMicrosecond = ring.header->ticksPerMicrosecond;
+		referenceTicks = ring.header->referenceTicks;
+		referenceTime = ring.header->referenceTime;
+	}
+
+	head = __atomic_load_n(&ring.header->head, __ATOMIC_ACQUIRE);
+	oldest = head > ring.header->capacity ? head - ring.header->capacity : 0;
+
+	for (i = oldest; i < head; i++)
+	{
+		if (eventCount == eventSize)
+		{
+			eventSize = eventSize ? 2 * eventSize : 65536;
+			if (!(events = (struct DumpEvent *) realloc(events, eventSize * sizeof(struct DumpEvent))))
+			{
+				printf("Malloc failed.\n");
+				return -1;
+			}
+		}
+
+		event = &ring.events[i % ring.header->capacity];
+		merged = &events[eventCount++];
+
+		merged->time = referenceTime + ((double) event->ticks - (double) referenceTicks) / ticksPerMicrosecond;
+		merged->seqN = event->seqN;
+		merged->source = event->source;
+		merged->dest = event->dest;
+		merged->router = ring.header->router;
+		merged->peer = event->peer;
+		merged->stage = event->stage < TRACE_STAGES ? event->stage : 0;
+	}
+
+	return 0;
+}
+
+int compareEvents(const void *a, const void *b)
+{
+	const struct DumpEvent *x = (const struct DumpEvent *) a, *y = (const struct DumpEvent *) b;
+
+	if (x->source != y->source)
+		return x->source - y->source;
+	if (x->dest != y->dest)
+		return x->dest - y->dest;
+	if (x->seqN != y->seqN)
+		return x->seqN < y->seqN ? -1 : 1;
+	if (x->router != y->router)
+		return x->router - y->router;
+
+	return (x->time > y->time) - (x->time < y->time);
+}
+
+int compareTimes(const void *a, const void *b)
+{
+	const struct DumpEvent *x = (const struct DumpEvent *) a, *y = (const struct DumpEvent *) b;
+
+	return (x->time > y->time) - (x->time < y->time);
+}
+
+int isSamePacket(struct DumpEvent *a, struct DumpEvent *b)
+{
+	return a->source == b->source && a->dest == b->dest && a->seqN == b->seqN;
+}
+
+int measurePacket(struct DumpEvent *first, int count)
+{
+	int i, j, k;
+	double received, dequeued, originated, applied, floodDequeued, flooded, arrival, start, spread;
+	struct DumpEvent *event;
+
+	start = first->time;
+	spread = -1;
+
+	for (i = 0; i < count; i = j)
+	{
+		received = dequeued = originated = applied = floodDequeued = flooded = -1;
+
+		// The events of one router are together, in the order they happened
+		for (j = i; j < count && first[j].router == first[i].router; j++)
+		{
+			event = &first[j];
+
+			if (event->time < start)
+				start = event->time;
+
+			switch (event->stage)
+			{
+				case TRACE_RECEIVED:
+					if (received < 0)
+						received = event->time;
+					break;
+				case TRACE_DEQUEUED:
+					if (applied < 0)
+						dequeued = event->time;
+					break;
+				case TRACE_ORIGINATED:
+					if (applied < 0)
+						originated = event->time;
+					break;
+				case TRACE_APPLIED:
+					if (applied >= 0)
+						break;
+					applied = event->time;
+					if (received >= 0 && dequeued >= 0 && addSample(DUMP_RECV_QUEUE, dequeued - received) < 0)
+						return -1;
+					if ((originated >= 0 || dequeued >= 0) &&
+					    addSample(DUMP_APPLY, applied - (originated >= 0 ? originated : dequeued)) < 0)
+						return -1;
+					if (applied > spread)
+						spread = applied;
+					break;
+				case TRACE_FLOOD_DEQUEUED:
+					if (applied < 0 || floodDequeued >= 0)
+						break;
+					floodDequeued = event->time;
+					if (addSample(DUMP_SEND_QUEUE, floodDequeued - applied) < 0)
+						return -1;
+					break;
+				case TRACE_FLOODED:
+					if (floodDequeued < 0 || flooded >= 0)
+						break;
+					flooded = event->time;
+					if (addSample(DUMP_FLOOD, flooded - floodDequeued) < 0)
+						return -1;
+					break;
+				case TRACE_SENT:
+					// Retransmissions and replies to requests are not part of the flood
+					if (flooded < 0)
+						break;
+					for (k = i; k < j; k++)
+						if (first[k].stage == TRACE_SENT && first[k].peer == event->peer && first[k].time >= flooded)
+							break;
+					if (k < j)
+						break;
+					if (addSample(DUMP_TRANSMIT, event->time - flooded) < 0)
+						return -1;
+					if ((arrival = findReceipt(first, count, event->peer, event->router, event->time)) >= 0 &&
+					    addSample(DUMP_HOP, arrival - event->time) < 0)
+						return -1;
+					break;
+			}
+		}
+	}
+
+	if (spread >= 0 && addSample(DUMP_SPREAD, spread - start) < 0)
+		return -1;
+
+	return 0;
+}
+
+double findReceipt(struct DumpEvent *first, int count, uint16_t router, uint16_t peer, double after)
+{
+	int low, high, middle;
+
+	// The events are sorted by router, find the first of the receiving router
+	low = 0;
+	high = count;
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		if (first[middle].router < router)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (; low < count && first[low].router == router; low++)
+		if (first[low].stage == TRACE_RECEIVED && first[low].peer == peer && first[low].time >= after)
+			return first[low].time;
+
+	return -1;
+}
+
+void printTimeline(struct DumpEvent *first, int count)
+{
+	int i;
+	char source[LS_ID_LENGTH], dest[LS_ID_LENGTH], router[LS_ID_LENGTH], peer[LS_ID_LENGTH];
+	struct DumpEvent *ordered;
+
+	// The events are grouped by router, the timeline interleaves them
+	if (!(ordered = (struct DumpEvent *) malloc(count * sizeof(struct DumpEvent))))
+		return;
+
+	memcpy(ordered, first, count * sizeof(struct DumpEvent));
+	qsort(ordered, count, sizeof(struct DumpEvent), compareTimes);
+
+	printf("Link %s -> %s, sequence %u\n", formatRouterID(first->source, source), formatRouterID(first->dest, dest),
+	       (uint32_t) ((int64_t) first->seqN - LS_SEQUENCE_NONE));
+
+	for (i = 0; i < count; i++)
+	{
+		printf("  %10.3f ms  %-6s %-15s", (ordered[i].time - ordered[0].time) / 1000,
+		       formatRouterID(ordered[i].router, router), stageNames[ordered[i].stage]);
+		if (ordered[i].peer != LS_ROUTER_NONE)
+			printf(" %s %s", ordered[i].stage == TRACE_SENT ? "to" : "from", formatRouterID(ordered[i].peer, peer));
+		printf("\n");
+	}
+	printf("\n");
+
+	free(ordered);
+}
+
+int addSample(int stage, double value)
+{
+	struct DumpSamples *stageSamples = &samples[stage];
+
+	if (stageSamples->count == stageSamples->size)
+	{
+		stageSamples->size = stageSamples->size ? 2 * stageSamples->size : 1024;
+		if (!(stageSamples->values = (double *) realloc(stageSamples->values, stageSamples->size * sizeof(double))))
+			return -1;
+	}
+
+	stageSamples->values[stageSamples->count++] = value;
+
+	return 0;
+}
+
+int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+void printStages()
+{
+	int i, j, count;
+	double sum, *values;
+
+	printf("%-11s %8s %10s %10s %10s %10s %10s\n", "stage", "count", "mean us", "p50 us", "p90 us", "p99 us", "max us");
+
+	for (i = 0; i < DUMP_STAGES; i++)
+	{
+		count = samples[i].count;
+		values = samples[i].values;
+
+		if (!count)
+		{
+			printf("%-11s %8d\n", sampleNames[i], 0);
+			continue;
+		}
+
+		qsort(values, count, sizeof(double), compareDoubles);
+
+		sum = 0;
+		for (j = 0; j < count; j++)
+			sum += values[j];
+
+		printf("%-11s %8d %10.1f %10.1f %10.1f %10.1f %10.1f\n", sampleNames[i], count, sum / count,
+		       values[(count - 1) / 2], values[(int) (0.9 * (count - 1))], values[(int) (0.99 * (count - 1))], values[count - 1]);
+	}
+}
+
+int parseCommandLine(int argc, char **argv, int *timelines, uint16_t *source, uint16_t *dest, int *first)
+{
+	int i;
+	char *comma;
+
+	*timelines = 0;
+	*source = LS_ROUTER_NONE;
+	*dest = LS_ROUTER_NONE;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (!strcmp(argv[i], "-timelines"))
+			*timelines = 1;
+		else if (!strcmp(argv[i], "-link") && i + 1 < argc && (comma = strchr(argv[i + 1], ',')))
+		{
+			*comma = '\0';
+			*source = parseRouterID(argv[++i]);
+			*dest = parseRouterID(comma + 1);
+			*timelines = 1;
+		}
+		else
+			break;
+	}
+
+	if (i >= argc || argv[i][0] == '-')
+	{
+		fprintf(stderr, "Use format:\n"
+		                "[-timelines] [-link source,destination] traceFile...\n");
+		return -1;
+	}
+
+	*first = i;
+
+	return 0;
+}